@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <cstring> // memcpy
 #include <stdexcept> // exception
+#include <utility> // move
 #include <stdlib.h> // atoi
 #include <map>
 #include <list>
@@ -63,6 +64,9 @@ public:
     Parse(const std::string& pathToWorkflowFile) = 0;
   void CheckCorrectnessModuleInfos(
     const std::vector<TModuleInfo>& modules);
+  const TSymbolTable& GetSymbolTable() const;
+protected:
+  TSymbolTable symbolTable;
 };
 
 struct TTagHandlers
@@ -281,7 +285,9 @@ public:
 private:
   XML_Parser parser;
 
-  std::map<std::string, TModuleId::TWorkflowId> moduleName2WorkflowId;
+  std::vector<TModuleId::TWorkflowId> moduleSymbol2WorkflowId;
+
+  TModuleId::TWorkflowId GetWorkflowId(TSymbolId moduleNameId) const;
 
   /* ,    workflow   .
    * \param[in] pathToWorkflowFile   workflow .
@@ -325,6 +331,8 @@ private:
 
   static const std::string FileTransportTypeStr;
 
+  static const std::string SharedMemoryTransportTypeStr;
+
   void Fill(const TXMLTagInfo* relativeTag, 
     ETransportType::Type& value);
 
@@ -404,6 +412,9 @@ TWrapperXMLParser::~TWrapperXMLParser()
 std::vector<TModuleInfo>
   TWrapperXMLParser::Parse(const std::string& pathToWorkflowFile)
 {
+  /* Symbols of a previously parsed workflow are not reused */
+  symbolTable.Clear();
+
   TWorkflowFileContent workflowFileContent;
   ReadWorkflowFile(pathToWorkflowFile, workflowFileContent);
 
@@ -622,7 +633,7 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
     TXMLTagInfo* childTag = *it;
     std::pair<T1, T2> mapElem;
     Fill(childTag, mapElem);
-    value.insert(mapElem);
+    value.emplace(std::move(mapElem));
     ++i;
     ++it;
   }
@@ -686,12 +697,17 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
     {
       value = ETransportType::Pipe;
     }
+    else if (transportTypeStr == SharedMemoryTransportTypeStr)
+    {
+      value = ETransportType::SharedMemory;
+    }
     else
     {
       std::stringstream info;
       info << "Unexpected value of transport type variable. Should be '" <<
-        FileTransportTypeStr << "' or '" << PipeTransportTypeStr <<
-        "' for tag with '" << relativeTag->tagType << "' type.";
+        FileTransportTypeStr << "', '" << PipeTransportTypeStr << "' or '" <<
+        SharedMemoryTransportTypeStr << "' for tag with '" <<
+        relativeTag->tagType << "' type.";
       throw std::runtime_error(info.str());
     }
   }
@@ -747,15 +763,18 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
     TXMLTagInfo::ETagType::SourceChannels);
   CheckFindResult(inputBatchChildTag, TXMLTagInfo::ETagType::SourceChannels,
     relativeTag->tagType);
-  Fill(inputBatchChildTag, value.sourceChannels);
-  for (std::size_t i = 0; i < value.sourceChannels.size(); ++i)
+  std::vector<std::string> channelNames;
+  Fill(inputBatchChildTag, channelNames);
+  value.sourceChannelIds.resize(channelNames.size());
+  for (std::size_t i = 0; i < channelNames.size(); ++i)
   {
-    if (value.sourceChannels[i].empty())
+    if (channelNames[i].empty())
     {
       std::stringstream info;
       info << "Empty source channel name in input batch is forbidden.";
       throw std::runtime_error(info.str());
     }
+    value.sourceChannelIds[i] = symbolTable.Intern(channelNames[i]);
   }
 
   /* Filling of distributor workflow id */
@@ -768,16 +787,14 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
   Fill(inputBatchChildTag, distributorName);
   if (!distributorName.empty())
   {
-    std::map<std::string, TModuleId::TWorkflowId>::iterator it =
-      moduleName2WorkflowId.find(distributorName);
-    if (it == moduleName2WorkflowId.end())
+    value.source = GetWorkflowId(symbolTable.Find(distributorName));
+    if (value.source == TModuleId::WorkflowIdUndefined)
     {
       std::stringstream info;
       info << "Distributor with '" << distributorName << "' name unexisted " <<
         "in granted workflow.";
       throw std::runtime_error(info.str());
     }
-    value.source = it->second;
   }
 
   /* Filling of input batch channels */
@@ -786,15 +803,17 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
     TXMLTagInfo::ETagType::InputBatchChannels);
   CheckFindResult(inputBatchChildTag,
     TXMLTagInfo::ETagType::InputBatchChannels, relativeTag->tagType);
-  Fill(inputBatchChildTag, value.channels);
-  for (std::size_t i = 0; i < value.channels.size(); ++i)
+  Fill(inputBatchChildTag, channelNames);
+  value.channelIds.resize(channelNames.size());
+  for (std::size_t i = 0; i < channelNames.size(); ++i)
   {
-    if (value.channels[i].empty())
+    if (channelNames[i].empty())
     {
       std::stringstream info;
       info << "Empty input batch channel name in input batch is forbidden.";
       throw std::runtime_error(info.str());
     }
+    value.channelIds[i] = symbolTable.Intern(channelNames[i]);
   }
 
   /* Filling of input batch type */
@@ -853,16 +872,14 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
   Fill(outputMessageChannelInfoChildTag, receiverName);
   if (!receiverName.empty())
   {
-    std::map<std::string, TModuleId::TWorkflowId>::iterator it =
-      moduleName2WorkflowId.find(receiverName);
-    if (it == moduleName2WorkflowId.end())
+    value.receiver = GetWorkflowId(symbolTable.Find(receiverName));
+    if (value.receiver == TModuleId::WorkflowIdUndefined)
     {
       std::stringstream info;
       info << "Receiver module with '" << receiverName <<
         "' name unexisted in granted workflow.";
       throw std::runtime_error(info.str());
     }
-    value.receiver = it->second;
   }
   else
   {
@@ -877,13 +894,15 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
       TXMLTagInfo::ETagType::ChannelName);
   CheckFindResult(outputMessageChannelInfoChildTag,
     TXMLTagInfo::ETagType::ChannelName, relativeTag->tagType);
-  Fill(outputMessageChannelInfoChildTag, value.name);
-  if (value.name.empty())
+  std::string channelName;
+  Fill(outputMessageChannelInfoChildTag, channelName);
+  if (channelName.empty())
   {
     std::stringstream info;
     info << "Empty channel name in output batch is forbidden.";
     throw std::runtime_error(info.str());
   }
+  value.nameId = symbolTable.Intern(channelName);
 
   /* Filling of converted channel name */
   outputMessageChannelInfoChildTag =
@@ -891,13 +910,14 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
       TXMLTagInfo::ETagType::ChannelConvertedName);
   CheckFindResult(outputMessageChannelInfoChildTag,
     TXMLTagInfo::ETagType::ChannelConvertedName, relativeTag->tagType);
-  Fill(outputMessageChannelInfoChildTag, value.convertedName);
-  if (value.convertedName.empty())
+  Fill(outputMessageChannelInfoChildTag, channelName);
+  if (channelName.empty())
   {
     std::stringstream info;
     info << "Empty converted channel name in output batch is forbidden.";
     throw std::runtime_error(info.str());
   }
+  value.convertedNameId = symbolTable.Intern(channelName);
 }
 
 void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
@@ -913,16 +933,14 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
   Fill(outputBatchChildTag, collectorName);
   if (!collectorName.empty())
   {
-    std::map<std::string, TModuleId::TWorkflowId>::iterator it =
-      moduleName2WorkflowId.find(collectorName);
-    if (it == moduleName2WorkflowId.end())
+    value.receiver = GetWorkflowId(symbolTable.Find(collectorName));
+    if (value.receiver == TModuleId::WorkflowIdUndefined)
     {
       std::stringstream info;
       info << "Collector with '" << collectorName << "' name unexisted " <<
         "in granted workflow.";
       throw std::runtime_error(info.str());
     }
-    value.receiver = it->second;
   }
 
   /* Filling of information about output channels */
@@ -955,6 +973,7 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
     info << "Empty module name is forbidden.";
     throw std::runtime_error(info.str());
   }
+  value.nameId = symbolTable.Intern(value.name);
 
   /* Filling of execution type */
   moduleChildTag = TXMLWorkflowTree::FindTagAmongChilds(relativeTag,
@@ -1003,6 +1022,11 @@ void TWrapperXMLParser::Fill(const TXMLTagInfo* relativeTag,
   CheckFindResult(moduleChildTag, TXMLTagInfo::ETagType::ModuleParameters,
     relativeTag->tagType);
   Fill(moduleChildTag, value.parameters);
+  value.parameterNameIds.resize(value.parameters.size());
+  for (std::size_t i = 0; i < value.parameters.size(); ++i)
+  {
+    value.parameterNameIds[i] = symbolTable.Intern(value.parameters[i].first);
+  }
 
   /* Filling of environment variables */
   moduleChildTag = TXMLWorkflowTree::FindTagAmongChilds(relativeTag,
@@ -1141,18 +1165,27 @@ void TWrapperXMLParser::FillModules(const TXMLWorkflowTree* XMLTree,
     throw std::runtime_error(info.str());
   }
 
-  /* Creating map for converting module name to module workflow id */
-  moduleName2WorkflowId.clear();
-  for (TModuleId::TWorkflowId i = 0; i < count; ++i)
+  /* Creating table for converting module name symbol to module workflow id */
+  for (std::size_t i = 0; i < modules.size(); ++i)
   {
-    moduleName2WorkflowId.insert(std::pair<std::string,
-      TModuleId::TWorkflowId>(modules[i].name, i + 1));
+    modules[i].nameId = symbolTable.Intern(modules[i].name);
+  }
+  moduleSymbol2WorkflowId.assign(symbolTable.Size(),
+    TModuleId::WorkflowIdUndefined);
+  for (std::size_t i = 0; i < modules.size(); ++i)
+  {
+    TModuleId::TWorkflowId& workflowId =
+      moduleSymbol2WorkflowId[modules[i].nameId];
+    if (workflowId == TModuleId::WorkflowIdUndefined)
+    {
+      workflowId = i + 1;
+    }
   }
 
   /* Filling module id for each module */
   for (std::size_t i = 0; i < modules.size(); ++i)
   {
-    modules[i].id = TModuleId(moduleName2WorkflowId[modules[i].name]);
+    modules[i].id = TModuleId(moduleSymbol2WorkflowId[modules[i].nameId]);
   }
 
   /* Filling full information about each module */
@@ -1168,6 +1201,21 @@ void TWrapperXMLParser::FillModules(const TXMLWorkflowTree* XMLTree,
   }
 }
 
+TModuleId::TWorkflowId TWrapperXMLParser::GetWorkflowId(
+  TSymbolId moduleNameId) const
+{
+  if (moduleNameId >= moduleSymbol2WorkflowId.size())
+  {
+    return TModuleId::WorkflowIdUndefined;
+  }
+  return moduleSymbol2WorkflowId[moduleNameId];
+}
+
+const TSymbolTable& TWrapperParser::GetSymbolTable() const
+{
+  return symbolTable;
+}
+
 void TWrapperParser::CheckCorrectnessModuleInfos(
   const std::vector<TModuleInfo>& modules)
 {
@@ -1179,7 +1227,8 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
     if (!((execType == EExecutionType::External) &&
       (transportType == ETransportType::File)) &&
       !((execType == EExecutionType::Internal) &&
-      (transportType == ETransportType::Pipe))) /* Invalid mixes */
+      ((transportType == ETransportType::Pipe) ||
+      (transportType == ETransportType::SharedMemory)))) /* Invalid mixes */
     {
       std::stringstream info;
       info << "Mix of '" << execType << "' execution type and '" <<
@@ -1282,16 +1331,15 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
       if (inputBatch.type == EInputBatchType::Collector)
       {
         /* Checking source channels */
-        for (std::size_t k = 0; k < inputBatch.sourceChannels.size(); ++k)
+        for (std::size_t k = 0; k < inputBatch.sourceChannelIds.size(); ++k)
         {
           const std::string& lhSourceChannelName =
-            inputBatch.sourceChannels[k];
-          for (std::size_t l = k + 1; l < inputBatch.sourceChannels.size();
+            symbolTable.GetString(inputBatch.sourceChannelIds[k]);
+          for (std::size_t l = k + 1; l < inputBatch.sourceChannelIds.size();
             ++l)
           {
-            const std::string& rhSourceChannelName =
-              inputBatch.sourceChannels[l];
-            if (lhSourceChannelName == rhSourceChannelName)
+            if (inputBatch.sourceChannelIds[k] ==
+              inputBatch.sourceChannelIds[l])
             {
               std::stringstream info;
               info << "Source channels in input batch must be unique. " <<
@@ -1304,14 +1352,14 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
       }
 
       /* Checking channels */
-      for (std::size_t k = 0; k < inputBatch.channels.size(); ++k)
+      for (std::size_t k = 0; k < inputBatch.channelIds.size(); ++k)
       {
-        const std::string& lhChannelName = inputBatch.channels[k];
-        for (std::size_t l = k + 1; l < inputBatch.channels.size();
+        const std::string& lhChannelName =
+          symbolTable.GetString(inputBatch.channelIds[k]);
+        for (std::size_t l = k + 1; l < inputBatch.channelIds.size();
           ++l)
         {
-          const std::string& rhChannelName = inputBatch.channels[l];
-          if (lhChannelName == rhChannelName)
+          if (inputBatch.channelIds[k] == inputBatch.channelIds[l])
           {
             std::stringstream info;
             info << "Channels in input batch must be unique. " <<
@@ -1333,15 +1381,14 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
       for (std::size_t k = 0; k < outputBatch.channels.size(); ++k)
       {
         const std::string& lhOutputChannelName =
-          outputBatch.channels[k].name;
+          symbolTable.GetString(outputBatch.channels[k].nameId);
         TModuleId::TWorkflowId lhWorkflowId = outputBatch.channels[k].receiver;
         for (std::size_t l = k + 1; l < outputBatch.channels.size(); ++l)
         {
-          const std::string& rhOutputChannelName =
-            outputBatch.channels[l].name;
           TModuleId::TWorkflowId rhWorkflowId =
             outputBatch.channels[l].receiver;
-          if ((lhOutputChannelName == rhOutputChannelName) &&
+          if ((outputBatch.channels[k].nameId ==
+            outputBatch.channels[l].nameId) &&
             (lhWorkflowId == rhWorkflowId))
           {
             std::stringstream info;
@@ -1410,18 +1457,16 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
          * (outputChannelName == sourceChannel in input batch)
          */
         TModuleId collectorId = outputBatch.receiver;
-        TModuleInfo collectorModule;
-        bool collectorModuleFound = false;
+        const TModuleInfo* collectorModule = NULL;
         for (std::size_t k = 0; k < modules.size(); ++k)
         {
           if (modules[k].id == collectorId)
           {
-            collectorModule = modules[k];
-            collectorModuleFound = true;
+            collectorModule = &modules[k];
             break;
           }
         }
-        if (!collectorModuleFound)
+        if (collectorModule == NULL)
         {
           std::stringstream info;
           info << "Collector module with '" << collectorId.workflowId << "'" <<
@@ -1430,11 +1475,11 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
           throw std::runtime_error(info.str());
         }
         bool channelsIsCorrect = false;
-        for (std::size_t k = 0; k < collectorModule.inputBatches.size(); ++k)
+        for (std::size_t k = 0; k < collectorModule->inputBatches.size(); ++k)
         {
-          const TInputBatchInfo& inputBatch = collectorModule.inputBatches[k];
+          const TInputBatchInfo& inputBatch = collectorModule->inputBatches[k];
           if ((inputBatch.type == EInputBatchType::Collector) &&
-            (inputBatch.sourceChannels.size() == outputBatch.channels.size()))
+            (inputBatch.sourceChannelIds.size() == outputBatch.channels.size()))
           {
             /* Checking channels */
             std::size_t l;
@@ -1443,11 +1488,10 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
               const TOutputBatchInfo::TOutputMessageChannelInfo& channelInfo =
                 outputBatch.channels[l];
               bool sourceChannelFound = false;
-              for (std::size_t s = 0; s < inputBatch.sourceChannels.size(); ++s)
+              for (std::size_t s = 0; s < inputBatch.sourceChannelIds.size();
+                ++s)
               {
-                const std::string& sourceChannel =
-                  inputBatch.sourceChannels[s];
-                if (channelInfo.name == sourceChannel)
+                if (channelInfo.nameId == inputBatch.sourceChannelIds[s])
                 {
                   sourceChannelFound = true;
                   break;
@@ -1471,7 +1515,7 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
           info << "There is no much between output channels of distributor " <<
             " output batch in module with '" << modules[i].name << "' and " <<
             "source channels in some input batch of module with '" <<
-            collectorModule.name << "' name.";
+            collectorModule->name << "' name.";
           throw std::runtime_error(info.str());
         }
       }
@@ -1492,18 +1536,16 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
          * (channelConvertedName == channelName in input batch)
          */
         TModuleId receiverId = outputChannelInfo.receiver;
-        TModuleInfo receiverModule;
-        bool receiverModuleFound = false;
+        const TModuleInfo* receiverModule = NULL;
         for (std::size_t l = 0; l < modules.size(); ++l)
         {
           if (modules[l].id == receiverId)
           {
-            receiverModule = modules[l];
-            receiverModuleFound = true;
+            receiverModule = &modules[l];
             break;
           }
         }
-        if (!receiverModuleFound)
+        if (receiverModule == NULL)
         {
           std::stringstream info;
           info << "Receiver module with '" << receiverId.workflowId << "'" <<
@@ -1512,13 +1554,12 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
           throw std::runtime_error(info.str());
         }
         bool channelFound = false;
-        for (std::size_t l = 0; l < receiverModule.inputBatches.size(); ++l)
+        for (std::size_t l = 0; l < receiverModule->inputBatches.size(); ++l)
         {
-          const TInputBatchInfo& inputBatch = receiverModule.inputBatches[l];
-          for (std::size_t s = 0; s < inputBatch.channels.size(); ++s)
+          const TInputBatchInfo& inputBatch = receiverModule->inputBatches[l];
+          for (std::size_t s = 0; s < inputBatch.channelIds.size(); ++s)
           {
-            const std::string& channelName = inputBatch.channels[s];
-            if (outputChannelInfo.convertedName == channelName)
+            if (outputChannelInfo.convertedNameId == inputBatch.channelIds[s])
             {
               channelFound = true;
               break;
@@ -1529,10 +1570,10 @@ void TWrapperParser::CheckCorrectnessModuleInfos(
         {
           std::stringstream info;
           info << "Converted channel name with '" <<
-            outputChannelInfo.convertedName <<
+            symbolTable.GetString(outputChannelInfo.convertedNameId) <<
             "' name in output batch of '" << modules[i].name << "' module " <<
             " was not found among channels of input batches of '" <<
-            receiverModule.name << "' module.";
+            receiverModule->name << "' module.";
           throw std::runtime_error(info.str());
         }
       }
@@ -2414,6 +2455,9 @@ const std::string TWrapperXMLParser::PipeTransportTypeStr = "Pipe";
 
 const std::string TWrapperXMLParser::FileTransportTypeStr = "File";
 
+const std::string TWrapperXMLParser::SharedMemoryTransportTypeStr =
+  "SharedMemory";
+
 const std::string TWrapperXMLParser::BoolTrueStr = "yes";
 
 const std::string TWrapperXMLParser::BoolFalseStr = "no";
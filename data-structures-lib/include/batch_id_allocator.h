@@ -0,0 +1,142 @@
+#ifndef BATCH_ID_ALLOCATOR_H_
+#define BATCH_ID_ALLOCATOR_H_
+
+#include <atomic>
+#include <cstddef>
+
+#include "data_message.h"
+
+
+namespace wrp
+{
+
+/** Непрерывный блок идентификаторов комплектов [firstId, lastId].
+ *
+ */
+struct TBatchIdBlock
+{
+  TBatchInstanceId firstId;
+  TBatchInstanceId lastId;
+
+  TBatchIdBlock();
+  TBatchIdBlock(TBatchInstanceId firstId, TBatchInstanceId lastId);
+
+  std::size_t Size() const;
+};
+
+/** Выдаёт идентификаторы комплектов одного модуля блоками.
+ * Блок выделяется одной атомарной операцией над общим счётчиком, поэтому
+ * потоки-производители обращаются к счётчику один раз на блок.
+ * Идентификаторы выдаются начиная с единицы: BatchInstanceIdUndefined
+ * не выдаётся никогда.
+ */
+class TBatchIdAllocator
+{
+public:
+  /** Размер блока по умолчанию.
+   *
+   */
+  static const std::size_t DefaultBlockSize = 4096;
+
+  /** Конструктор.
+   * \param[in] blockSize Размер блока, выдаваемого потоку
+   */
+  explicit TBatchIdAllocator(std::size_t blockSize = DefaultBlockSize);
+
+  /** Выделяет блок из count идентификаторов.
+   * \param[in] count Количество идентификаторов
+   */
+  TBatchIdBlock AllocateBlock(std::size_t count);
+
+  /** Выделяет блок размера по умолчанию для данного распределителя.
+   *
+   */
+  TBatchIdBlock AllocateBlock();
+
+  /** Выделяет count идентификаторов и записывает их диапазон
+   *  в поля firstId и lastId последовательности.
+   * \param[in] count Количество идентификаторов
+   * \param[in/out] sequence Последовательность комплектов
+   */
+  void AllocateSequence(std::size_t count, TBatchSequence& sequence);
+
+  std::size_t BlockSize() const;
+
+private:
+  /** Следующий невыданный идентификатор.
+   * Выровнен по строке кэша, чтобы не разделять её с другими данными.
+   */
+  alignas(64) std::atomic<TBatchInstanceId> nextId;
+
+  /** Выровнен по строке кэша, чтобы не попасть в строку nextId.
+   *
+   */
+  alignas(64) std::size_t blockSize;
+
+  TBatchIdAllocator(const TBatchIdAllocator&);
+  TBatchIdAllocator& operator=(const TBatchIdAllocator&);
+};
+
+/** Получатель последовательностей комплектов, выделенных
+ *  курсором TBatchIdCursor.
+ */
+class TBatchSequenceSink
+{
+public:
+  virtual ~TBatchSequenceSink();
+
+  /** Записывает последовательность, соответствующую новому блоку курсора.
+   * Вызывается в потоке курсора до выдачи первого идентификатора блока.
+   * \param[in] sequence Последовательность комплектов блока
+   */
+  virtual void Record(const TBatchSequence& sequence) = 0;
+};
+
+/** Выдаёт идентификаторы по одному из блоков, полученных от
+ *  TBatchIdAllocator. Используется одним потоком.
+ * Блоки разных курсоров чередуются, поэтому выданные курсором
+ * идентификаторы не образуют одного непрерывного диапазона. Каждый
+ * полученный блок записывается получателю (TBatchSequenceSink) как
+ * отдельная последовательность TBatchSequence, так что любой выданный
+ * идентификатор принадлежит одной из записанных последовательностей.
+ */
+class TBatchIdCursor
+{
+public:
+  /** Конструктор.
+   * \param[in] allocator Распределитель идентификаторов
+   * \param[in] sink Получатель последовательностей блоков
+   * \param[in] prototype Последовательность, метки и выходные каналы
+   *  которой копируются в последовательности блоков
+   */
+  TBatchIdCursor(TBatchIdAllocator& allocator, TBatchSequenceSink& sink,
+    const TBatchSequence& prototype = TBatchSequence());
+
+  /** Возвращает следующий идентификатор, при необходимости получая
+   *  новый блок и записывая его последовательность.
+   */
+  TBatchInstanceId Next();
+
+  /** Текущий блок. Идентификаторы блока до возвращённого последним
+   *  вызовом Next() включительно уже выданы.
+   */
+  const TBatchIdBlock& Block() const;
+
+private:
+  TBatchIdAllocator& allocator;
+  TBatchSequenceSink& sink;
+
+  /** Последовательность текущего блока.
+   *
+   */
+  TBatchSequence sequence;
+  TBatchIdBlock block;
+  TBatchInstanceId nextId;
+
+  TBatchIdCursor(const TBatchIdCursor&);
+  TBatchIdCursor& operator=(const TBatchIdCursor&);
+};
+
+} // namespace wrp
+
+#endif // BATCH_ID_ALLOCATOR_H_
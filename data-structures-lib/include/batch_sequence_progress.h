@@ -0,0 +1,83 @@
+#ifndef BATCH_SEQUENCE_PROGRESS_H_
+#define BATCH_SEQUENCE_PROGRESS_H_
+
+#include <cstddef>
+#include <map>
+
+#include "data_message.h"
+
+
+namespace wrp
+{
+
+/** Отслеживает обработанные комплекты последовательности TBatchSequence.
+ * Обработанные идентификаторы хранятся как набор непересекающихся
+ * интервалов [первый, последний]; соседние интервалы объединяются.
+ * Для плотно обработанной последовательности требуется один интервал
+ * независимо от её длины.
+ */
+class TBatchSequenceProgress
+{
+public:
+  /** Конструктор.
+   * \param[in] sequence Последовательность комплектов
+   */
+  explicit TBatchSequenceProgress(const TBatchSequence& sequence);
+
+  /** Отмечает комплект как обработанный.
+   * Возвращает false, если комплект уже был отмечен.
+   * \param[in] id Идентификатор комплекта
+   */
+  bool MarkCompleted(TBatchInstanceId id);
+
+  /** Отмечает диапазон комплектов [firstId, lastId] как обработанный.
+   * Возвращает количество впервые отмеченных комплектов.
+   * \param[in] firstId Идентификатор первого комплекта диапазона
+   * \param[in] lastId Идентификатор последнего комплекта диапазона
+   */
+  std::size_t MarkCompleted(TBatchInstanceId firstId,
+    TBatchInstanceId lastId);
+
+  /** Проверяет, обработан ли комплект. Выполняется за O(log n),
+   *  где n - количество интервалов.
+   * \param[in] id Идентификатор комплекта
+   */
+  bool IsCompleted(TBatchInstanceId id) const;
+
+  /** Проверяет, обработана ли вся последовательность. Выполняется за O(1).
+   *
+   */
+  bool IsSequenceCompleted() const;
+
+  /** Возвращает идентификатор первого необработанного комплекта или
+   *  BatchInstanceIdUndefined, если обработана вся последовательность.
+   */
+  TBatchInstanceId FirstMissing() const;
+
+  /** Количество обработанных комплектов.
+   *
+   */
+  std::size_t CompletedCount() const;
+
+  /** Количество интервалов, которыми представлены обработанные комплекты.
+   *
+   */
+  std::size_t IntervalCount() const;
+
+  TBatchInstanceId FirstId() const;
+  TBatchInstanceId LastId() const;
+
+private:
+  TBatchInstanceId firstId;
+  TBatchInstanceId lastId;
+  std::size_t completedCount;
+
+  /** Интервалы обработанных комплектов: первый -> последний.
+   *
+   */
+  std::map<TBatchInstanceId, TBatchInstanceId> intervals;
+};
+
+} // namespace wrp
+
+#endif // BATCH_SEQUENCE_PROGRESS_H_
@@ -0,0 +1,102 @@
+#ifndef BLOCK_CODEC_H_
+#define BLOCK_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace wrp
+{
+
+/** Быстрое сжатие блоков данных без внешних зависимостей.
+ * Используется формат блока LZ4: последовательности из литералов и
+ * ссылок на совпадения в пределах 64 КиБ. Распаковка проверяет границы
+ * и не выходит за пределы входного и выходного буферов.
+ */
+class TBlockCodec
+{
+public:
+  /** Максимальный размер сжатых данных для входа размером size.
+   * \param[in] size Размер исходных данных в байтах
+   */
+  static std::size_t MaxCompressedSize(std::size_t size);
+
+  /** Сжимает данные. Возвращает размер сжатых данных или 0, если они не
+   *  помещаются в буфер.
+   * \param[in] source Исходные данные
+   * \param[in] size Размер исходных данных в байтах
+   * \param[out] destination Буфер для сжатых данных
+   * \param[in] capacity Размер буфера в байтах
+   */
+  static std::size_t Compress(const char* source, std::size_t size,
+    char* destination, std::size_t capacity);
+
+  /** Распаковывает данные. Возвращает размер распакованных данных.
+   * Выбрасывает исключение, если данные повреждены или не помещаются
+   * в буфер.
+   * \param[in] source Сжатые данные
+   * \param[in] size Размер сжатых данных в байтах
+   * \param[out] destination Буфер для распакованных данных
+   * \param[in] capacity Размер буфера в байтах
+   */
+  static std::size_t Decompress(const char* source, std::size_t size,
+    char* destination, std::size_t capacity);
+};
+
+/** Выбирает, сжимать ли блоки данных канала.
+ * Сжимаемость оценивается по нескольким выборкам блока, размер которых
+ * мал по сравнению с блоком. Оценка обновляется не для каждого блока,
+ * а через sampleInterval блоков, и уточняется по результатам сжатия
+ * целых блоков. Несжимаемые данные не сжимаются, поэтому затраты на них
+ * ограничены редкими выборками.
+ * Объект не потокобезопасен, для каждого канала создаётся свой объект.
+ */
+class TCompressionSelector
+{
+public:
+  /** Конструктор.
+   * \param[in] maxRatio Максимальное отношение размера сжатых данных к
+   * исходному, при котором сжатие выгодно
+   * \param[in] sampleInterval Количество блоков между выборками
+   */
+  explicit TCompressionSelector(double maxRatio = 0.9,
+    std::size_t sampleInterval = 16);
+
+  /** Проверяет, следует ли сжимать блок.
+   * \param[in] data Данные блока
+   * \param[in] size Размер блока в байтах
+   */
+  bool ShouldCompress(const char* data, std::size_t size);
+
+  /** Учитывает результат сжатия блока.
+   * \param[in] size Размер исходных данных в байтах
+   * \param[in] compressedSize Размер сжатых данных или 0, если данные
+   * не удалось сжать
+   */
+  void Report(std::size_t size, std::size_t compressedSize);
+
+  /** Проверяет, выгоден ли результат сжатия.
+   * \param[in] size Размер исходных данных в байтах
+   * \param[in] compressedSize Размер сжатых данных
+   */
+  bool IsWorthwhile(std::size_t size, std::size_t compressedSize) const;
+
+  /** Текущая оценка отношения размера сжатых данных к исходному.
+   *
+   */
+  double EstimatedRatio() const;
+
+private:
+  double maxRatio;
+  std::size_t sampleInterval;
+  double estimatedRatio;
+  std::size_t blocksSinceSample;
+  std::vector<char> scratch;
+
+  double Sample(const char* data, std::size_t size);
+};
+
+} // namespace wrp
+
+#endif // BLOCK_CODEC_H_
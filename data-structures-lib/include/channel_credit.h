@@ -0,0 +1,203 @@
+#ifndef CHANNEL_CREDIT_H_
+#define CHANNEL_CREDIT_H_
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "data_message.h"
+#include "module_info.h"
+#include "symbol_table.h"
+#include "workflow_model.h"
+
+
+namespace wrp
+{
+
+/** Ограничения канала: объём и количество сообщений, отправленных
+ *  производителем и ещё не обработанных получателем.
+ */
+struct TChannelBudget
+{
+  static const std::size_t DefaultMaxSize = 64 * 1024 * 1024;
+  static const std::size_t DefaultMaxCount = 1024;
+
+  /** Максимальный объём данных в канале, байт.
+   *
+   */
+  std::size_t maxSize;
+
+  /** Максимальное количество сообщений в канале.
+   *
+   */
+  std::size_t maxCount;
+
+  TChannelBudget(std::size_t maxSize = DefaultMaxSize,
+    std::size_t maxCount = DefaultMaxCount);
+};
+
+/** Таблица кредитов каналов между модулями-производителями и
+ *  модулями-получателями.
+ * Каналы берутся из выходных комплектов модулей workflow
+ * (TOutputBatchInfo): каждому сочетанию производителя, получателя и
+ * имени канала соответствует один канал, общий для всех копий модулей.
+ * Перед отправкой сообщения производитель получает кредит канала
+ * (Acquire или TryAcquire), получатель возвращает его после обработки
+ * сообщения (Release). Когда кредит исчерпан, производитель ожидает,
+ * поэтому объём данных в канале не превышает его ограничений.
+ * Кредит хранится в одном атомарном слове, блокировка канала
+ * используется только при ожидании.
+ */
+class TChannelCreditTable
+{
+public:
+  /** Индекс канала, возвращаемый при его отсутствии.
+   *
+   */
+  static const std::size_t ChannelNotFound = static_cast<std::size_t>(-1);
+
+  /** Конструктор. Строит таблицу каналов модели workflow.
+   * \param[in] model Модель workflow
+   * \param[in] budget Ограничения, устанавливаемые всем каналам
+   */
+  explicit TChannelCreditTable(const TWorkflowModel& model,
+    const TChannelBudget& budget = TChannelBudget());
+
+  /** Деструктор.
+   *
+   */
+  ~TChannelCreditTable();
+
+  /** Возвращает индекс канала по имени на стороне производителя
+   *  (TOutputMessageChannelInfo::name) или ChannelNotFound.
+   * \param[in] source Идентификатор модуля-производителя в workflow
+   * \param[in] receiver Идентификатор модуля-получателя в workflow
+   * \param[in] nameId Идентификатор имени выходного канала
+   */
+  std::size_t FindOutput(TModuleId::TWorkflowId source,
+    TModuleId::TWorkflowId receiver, TSymbolId nameId) const;
+
+  /** Возвращает индекс канала по имени на стороне получателя
+   *  (TInputBatchInfo::channels) или ChannelNotFound.
+   * \param[in] source Идентификатор модуля-производителя в workflow
+   * \param[in] receiver Идентификатор модуля-получателя в workflow
+   * \param[in] channelId Идентификатор имени входного канала
+   */
+  std::size_t FindInput(TModuleId::TWorkflowId source,
+    TModuleId::TWorkflowId receiver, TSymbolId channelId) const;
+
+  /** Устанавливает ограничения канала. Вызывается до начала передачи
+   *  данных по каналу.
+   * \param[in] channel Индекс канала
+   * \param[in] budget Ограничения канала
+   */
+  void SetBudget(std::size_t channel, const TChannelBudget& budget);
+
+  /** Ограничения канала.
+   * \param[in] channel Индекс канала
+   */
+  const TChannelBudget& Budget(std::size_t channel) const;
+
+  /** Получает кредит на отправку сообщения размером size без ожидания.
+   * Сообщение, превышающее ограничение объёма, получает кредит только
+   * в пустом канале. Возвращает false, если кредита недостаточно.
+   * \param[in] channel Индекс канала
+   * \param[in] size Размер сообщения, байт
+   */
+  bool TryAcquire(std::size_t channel, std::size_t size);
+
+  /** Получает кредит на отправку сообщения, ожидая его возврата
+   *  получателем. Возвращает false, если таблица остановлена.
+   * \param[in] channel Индекс канала
+   * \param[in] size Размер сообщения, байт
+   */
+  bool Acquire(std::size_t channel, std::size_t size);
+
+  /** Возвращает кредит обработанного сообщения.
+   * \param[in] channel Индекс канала
+   * \param[in] size Размер сообщения, указанный при получении кредита
+   */
+  void Release(std::size_t channel, std::size_t size);
+
+  /** Останавливает таблицу: ожидающие производители освобождаются,
+   *  Acquire больше не ожидает и возвращает false.
+   */
+  void Shutdown();
+
+  /** Размер данных сообщения: сумма размеров фрагментов всех входов.
+   * \param[in] message Сообщение
+   */
+  static std::size_t MessageSize(const TDataMessage& message);
+
+  std::size_t ChannelCount() const;
+
+  /** Объём данных в канале, байт.
+   * \param[in] channel Индекс канала
+   */
+  std::size_t InFlightSize(std::size_t channel) const;
+
+  /** Количество сообщений в канале.
+   * \param[in] channel Индекс канала
+   */
+  std::size_t InFlightCount(std::size_t channel) const;
+
+  /** Количество ожиданий производителей из-за нехватки кредита.
+   * \param[in] channel Индекс канала
+   */
+  std::size_t WaitCount(std::size_t channel) const;
+
+private:
+  /** Ключ поиска канала.
+   *
+   */
+  struct TChannelKey
+  {
+    TModuleId::TWorkflowId source;
+    TModuleId::TWorkflowId receiver;
+    TSymbolId nameId;
+    std::size_t channel;
+
+    bool operator<(const TChannelKey& other) const;
+  };
+
+  struct TChannel
+  {
+    /** Занятый кредит: количество сообщений в старших битах, объём
+     *  в младших.
+     */
+    std::atomic<std::uint64_t> used;
+
+    /** Количество производителей, ожидающих кредит.
+     *
+     */
+    std::atomic<std::size_t> waiterCount;
+
+    std::atomic<std::size_t> waitCount;
+    TChannelBudget budget;
+    std::mutex mutex;
+    std::condition_variable released;
+
+    TChannel();
+  };
+
+  std::vector<std::unique_ptr<TChannel> > channels;
+  std::vector<TChannelKey> outputKeys;
+  std::vector<TChannelKey> inputKeys;
+  std::atomic<bool> stopped;
+
+  TChannel& Channel(std::size_t channel) const;
+
+  static std::size_t Find(const std::vector<TChannelKey>& keys,
+    const TChannelKey& key);
+
+  TChannelCreditTable(const TChannelCreditTable&);
+  TChannelCreditTable& operator=(const TChannelCreditTable&);
+};
+
+} // namespace wrp
+
+#endif // CHANNEL_CREDIT_H_
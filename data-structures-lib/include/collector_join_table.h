@@ -0,0 +1,177 @@
+#ifndef COLLECTOR_JOIN_TABLE_H_
+#define COLLECTOR_JOIN_TABLE_H_
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "data_message.h"
+#include "module_info.h"
+#include "symbol_table.h"
+#include "token_path_map.h"
+
+
+namespace wrp
+{
+
+/** Результат добавления сообщения в TCollectorJoinTable.
+ *
+ */
+struct ECollectorJoinStatus
+{
+  enum Type
+  {
+    _undefined = 0,
+
+    Pending,
+    Duplicate,
+    Completed
+  };
+};
+
+/** Набор сообщений, собранный для входного комплекта типа Collector.
+ *
+ */
+struct TCollectedBatch
+{
+  /** Путь сообщения до модуля-распределителя: lastModuleToken - метка
+   *  распределителя, tokens - предшествующие ей метки. Общий для всех
+   *  сообщений набора.
+   */
+  TDataMessageTokens distributorId;
+
+  /** Сообщения в порядке каналов-источников комплекта
+   *  (TInputBatchInfo::sourceChannels).
+   */
+  std::vector<TDataMessage> messages;
+};
+
+/** Таблица сбора сообщений для входного комплекта типа Collector.
+ * Сообщения, порождённые одним комплектом модуля-распределителя,
+ * определяются общим началом пути до метки распределителя. Набор
+ * считается собранным, когда пришли сообщения по всем каналам-источникам
+ * комплекта.
+ * Таблица разделена на сегменты со своими блокировками, поэтому
+ * сообщения могут добавляться из нескольких потоков одновременно.
+ * Количество незавершённых наборов ограничено, при превышении удаляются
+ * самые старые наборы.
+ * Ключи недавно собранных наборов запоминаются (не более
+ * completedCapacity), поэтому опоздавшее или повторное сообщение
+ * собранного набора отбрасывается как дубликат и не открывает новый
+ * набор, вытесняющий незавершённые.
+ */
+class TCollectorJoinTable
+{
+public:
+  typedef std::chrono::steady_clock TClock;
+
+  /** Количество сегментов таблицы по умолчанию.
+   *
+   */
+  static const std::size_t DefaultShardCount = 16;
+
+  static const std::size_t DefaultCompletedCapacity = 4096;
+
+  /** Конструктор.
+   * \param[in] inputBatch Входной комплект типа Collector
+   * \param[in] maxPendingCount Максимальное количество незавершённых
+   * наборов
+   * \param[in] shardCount Количество сегментов таблицы
+   * \param[in] completedCapacity Количество запоминаемых ключей собранных
+   * наборов
+   */
+  TCollectorJoinTable(const TInputBatchInfo& inputBatch,
+    std::size_t maxPendingCount,
+    std::size_t shardCount = DefaultShardCount,
+    std::size_t completedCapacity = DefaultCompletedCapacity);
+
+  /** Добавляет сообщение, пришедшее по ветви канала-источника.
+   * \param[in] message Сообщение. Перемещается в таблицу.
+   * \param[in] sourceChannelId Идентификатор канала-источника
+   * \param[out] batch Собранный набор, заполняется только при возврате
+   * ECollectorJoinStatus::Completed
+   */
+  ECollectorJoinStatus::Type Add(TDataMessage&& message,
+    TSymbolId sourceChannelId, TCollectedBatch& batch);
+
+  /** Удаляет незавершённые наборы, начатые раньше момента time.
+   * Возвращает количество удалённых наборов.
+   * \param[in] time Момент времени
+   */
+  std::size_t EvictOlderThan(const TClock::time_point& time);
+
+  /** Количество незавершённых наборов.
+   *
+   */
+  std::size_t PendingCount() const;
+
+  /** Количество наборов, удалённых незавершёнными.
+   *
+   */
+  std::size_t EvictedCount() const;
+
+private:
+  struct TPendingBatch
+  {
+    std::vector<TDataMessage> messages;
+    std::vector<bool> arrived;
+    std::size_t arrivedCount;
+    TClock::time_point created;
+    std::list<const TDataMessageTokens*>::iterator agePosition;
+
+    TPendingBatch();
+  };
+
+  typedef std::unordered_map<TDataMessageTokens, TPendingBatch,
+    TDataMessageTokensHash> TPendingBatches;
+
+  typedef std::unordered_set<TDataMessageTokens, TDataMessageTokensHash>
+    TCompletedKeys;
+
+  struct TShard
+  {
+    std::mutex mutex;
+    TPendingBatches pendingBatches;
+
+    /** Незавершённые наборы в порядке создания.
+     *
+     */
+    std::list<const TDataMessageTokens*> ageOrder;
+
+    /** Ключи недавно собранных наборов и порядок их добавления.
+     *
+     */
+    TCompletedKeys completedKeys;
+    std::list<const TDataMessageTokens*> completedOrder;
+  };
+
+  TModuleId::TWorkflowId distributor;
+  std::vector<TSymbolId> sourceChannelIds;
+  std::size_t maxPendingCountPerShard;
+  std::size_t completedCapacityPerShard;
+  std::vector<std::unique_ptr<TShard> > shards;
+  std::atomic<std::size_t> pendingCount;
+  std::atomic<std::size_t> evictedCount;
+
+  /** Возвращает путь сообщения до метки модуля-распределителя
+   *  включительно. Узлы пути разделяются с id и не создаются.
+   */
+  TDataMessageTokens FindDistributorId(const TDataMessageTokens& id) const;
+
+  void Erase(TShard& shard, TPendingBatches::iterator it);
+
+  void Remember(TShard& shard, const TDataMessageTokens& key);
+
+  TCollectorJoinTable(const TCollectorJoinTable&);
+  TCollectorJoinTable& operator=(const TCollectorJoinTable&);
+};
+
+} // namespace wrp
+
+#endif // COLLECTOR_JOIN_TABLE_H_
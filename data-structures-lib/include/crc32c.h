@@ -0,0 +1,46 @@
+#ifndef CRC32C_H_
+#define CRC32C_H_
+
+#include <cstddef>
+#include <cstdint>
+
+
+namespace wrp
+{
+
+/** Вычисляет контрольную сумму CRC32C (полином Кастаньоли).
+ * Используются инструкции процессора (SSE4.2 на x86, расширение CRC
+ * на ARMv8), если они доступны, иначе - табличный алгоритм slice-by-8.
+ * Суммы соседних участков данных объединяются без повторного чтения
+ * данных (Combine).
+ */
+class TCrc32c
+{
+public:
+  /** Возвращает контрольную сумму данных.
+   * \param[in] data Данные
+   * \param[in] size Размер данных в байтах
+   * \param[in] crc Контрольная сумма предшествующих данных. Позволяет
+   * вычислять сумму по частям.
+   */
+  static std::uint32_t Compute(const void* data, std::size_t size,
+    std::uint32_t crc = 0);
+
+  /** Возвращает контрольную сумму последовательности из двух участков
+   *  данных по их контрольным суммам. Выполняется за O(log secondSize).
+   * \param[in] first Контрольная сумма первого участка
+   * \param[in] second Контрольная сумма второго участка
+   * \param[in] secondSize Размер второго участка в байтах
+   */
+  static std::uint32_t Combine(std::uint32_t first, std::uint32_t second,
+    std::uint64_t secondSize);
+
+  /** Проверяет, используются ли инструкции процессора.
+   *
+   */
+  static bool IsAccelerated();
+};
+
+} // namespace wrp
+
+#endif // CRC32C_H_
@@ -2,11 +2,14 @@
 #define DATA_MESSAGE_H_
 
 #include <cstddef>
+#include <cstdint>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include "message.h"
 #include "module_info.h"
+#include "payload_buffer.h"
 
 
 namespace wrp
@@ -53,24 +56,48 @@ struct TDataMessageEntranceInfo
   std::string entranceId;
 
   /** Фрагмент данных сообщения.
-   * Владеет указателем.
+   * Ссылается на участок разделяемого буфера, поэтому копирование
+   * структуры не копирует данные. Размер среза равен fragmentSize.
    */
-  char* data;
+  TPayloadSlice data;
+
+  /** Контрольная сумма CRC32C фрагмента данных. Действительна, только
+   *  если установлен флаг hasChecksum.
+   */
+  std::uint32_t checksum;
+
+  /** Признак наличия контрольной суммы. Сбрасывается при установке
+   *  нового фрагмента (SetFragment).
+   */
+  bool hasChecksum;
 
   /** Конструктор по умолчанию.
    *
    */
   TDataMessageEntranceInfo();
 
-  /** Конструктор копирования.
-   *
+  TDataMessageEntranceInfo(const TDataMessageEntranceInfo& other) = default;
+  TDataMessageEntranceInfo(TDataMessageEntranceInfo&& other) noexcept =
+    default;
+  TDataMessageEntranceInfo& operator=(
+    const TDataMessageEntranceInfo& other) = default;
+  TDataMessageEntranceInfo& operator=(
+    TDataMessageEntranceInfo&& other) noexcept = default;
+
+  /** Устанавливает фрагмент данных и его размер.
+   * \param[in] fragment Срез разделяемого буфера с данными фрагмента
    */
-  TDataMessageEntranceInfo(const TDataMessageEntranceInfo& other);
+  void SetFragment(const TPayloadSlice& fragment);
 
-  /** Деструктор.
+  /** Вычисляет контрольную сумму фрагмента данных.
    *
    */
-  ~TDataMessageEntranceInfo();
+  void ComputeChecksum();
+
+  /** Проверяет контрольную сумму фрагмента данных. Возвращает true,
+   *  если сумма совпадает или отсутствует.
+   */
+  bool VerifyChecksum() const;
 };
 
 /** Представляет метку модуля, через который прошло сообщение.
@@ -88,6 +115,12 @@ struct TDataMessageToken
    */
   TBatchInstanceId batchId;
 
+  /** Момент прохождения модуля в наносекундах монотонных часов (Now),
+   *  0 - не задан. Устанавливается TDataMessageTokens::Forward.
+   *  Не участвует в сравнении и хэше метки.
+   */
+  std::uint64_t timestamp;
+
   /** Конструктор по умолчанию.
    *
    */
@@ -99,6 +132,144 @@ struct TDataMessageToken
    */
   bool operator==(const TDataMessageToken& other) const;
   bool operator!=(const TDataMessageToken& other) const;
+
+  /** Возвращает 64-битный хэш метки.
+   *
+   */
+  std::uint64_t Hash() const;
+
+  /** Текущий момент монотонных часов в наносекундах. Часы общие для
+   *  процессов одного узла.
+   */
+  static std::uint64_t Now();
+};
+
+/** Неизменяемая последовательность меток модулей.
+ * Хранится как цепочка узлов со ссылками на родителя, узлы разделяются
+ * между путями с общим началом. Добавление метки создаёт один узел и
+ * не изменяет исходный путь, копирование пути не копирует метки.
+ * Узел выделяется в куче (std::make_shared) при каждом добавлении
+ * и освобождается вместе с последним путём, который на него ссылается;
+ * TDataMessagePool узлы не кэширует.
+ */
+class TTokenPath
+{
+  struct TNode;
+
+public:
+  /** Итератор по меткам пути от последней к первой.
+   * Не изменяет счётчики ссылок узлов и действителен, пока существует путь.
+   */
+  class TReverseIterator
+  {
+  public:
+    const TDataMessageToken& operator*() const;
+    const TDataMessageToken* operator->() const;
+    TReverseIterator& operator++();
+    bool operator==(const TReverseIterator& other) const;
+    bool operator!=(const TReverseIterator& other) const;
+
+  private:
+    friend class TTokenPath;
+
+    const TNode* node;
+
+    explicit TReverseIterator(const TNode* node);
+  };
+
+  /** Конструктор по умолчанию. Создаёт пустой путь.
+   *
+   */
+  TTokenPath();
+
+  /** Конструктор. Создаёт путь из последовательности меток.
+   * \param[in] tokens Метки в порядке прохождения модулей
+   */
+  explicit TTokenPath(const std::vector<TDataMessageToken>& tokens);
+
+  TTokenPath(const TTokenPath& other) = default;
+  TTokenPath(TTokenPath&& other) noexcept = default;
+
+  /** Оператор присваивания.
+   * Прежняя цепочка узлов освобождается деструктором временного объекта.
+   */
+  TTokenPath& operator=(TTokenPath other) noexcept;
+
+  /** Деструктор. Освобождает цепочку узлов без рекурсии.
+   *
+   */
+  ~TTokenPath();
+
+  /** Возвращает путь, продолженный меткой token. Выполняется за O(1).
+   * \param[in] token Метка модуля
+   */
+  TTokenPath Append(const TDataMessageToken& token) const;
+
+  /** Возвращает путь без последней метки. Выполняется за O(1).
+   *
+   */
+  TTokenPath Parent() const;
+
+  /** Возвращает начало пути из depth меток.
+   * \param[in] depth Количество меток в начале пути
+   */
+  TTokenPath Prefix(std::size_t depth) const;
+
+  /** Последняя метка пути. Путь не должен быть пустым.
+   *
+   */
+  const TDataMessageToken& Back() const;
+
+  std::size_t Size() const;
+  bool Empty() const;
+
+  /** Хэш пути, поддерживается при добавлении меток.
+   *
+   */
+  std::uint64_t Hash() const;
+
+  /** Итератор на последнюю метку пути.
+   *
+   */
+  TReverseIterator RBegin() const;
+
+  /** Итератор, следующий за первой меткой пути.
+   *
+   */
+  TReverseIterator REnd() const;
+
+  /** Возвращает метки пути в виде вектора (для совместимости).
+   *
+   */
+  std::vector<TDataMessageToken> ToVector() const;
+
+  /** Проверяет, что путь является началом пути other.
+   * \param[in] other Путь
+   */
+  bool IsPrefixOf(const TTokenPath& other) const;
+
+  bool operator==(const TTokenPath& other) const;
+  bool operator!=(const TTokenPath& other) const;
+
+private:
+  struct TNode
+  {
+    TDataMessageToken token;
+    std::shared_ptr<const TNode> parent;
+    std::size_t depth;
+    std::uint64_t hash;
+  };
+
+  std::shared_ptr<const TNode> tail;
+
+  explicit TTokenPath(const std::shared_ptr<const TNode>& tail);
+
+  static const TNode* Ancestor(const TNode* node, std::size_t depth);
+
+  /** Сравнивает цепочки узлов одинаковой длины.
+   *
+   */
+  static bool Equal(const TNode* lhs, const TNode* rhs);
 };
 
 /** Структура с метками модулей, через которые прошли данные.
@@ -108,9 +279,9 @@ struct TDataMessageTokens
 {
   /** Набор меток, определяющих последовательность прохождения данных
    *  через модули-производители.
-   *
+   * Начало пути разделяется с сообщениями, от которых произошло данное.
    */
-  std::vector<TDataMessageToken> tokens;
+  TTokenPath tokens;
 
   /** Метка последнего модуля, через который прошли данные.
    *
@@ -122,9 +293,35 @@ struct TDataMessageTokens
    */
   TDataMessageTokens();
 
-  /** Оператор проверки на равенство.
+  /** Добавляет метку в конец набора tokens за O(1).
+   * Выделяет в куче один узел пути.
+   * \param[in] token Метка модуля
+   */
+  void Append(const TDataMessageToken& token);
+
+  /** Переносит метку последнего модуля в набор tokens и заменяет её
+   *  меткой модуля, через который данные проходят сейчас.
+   *  Если момент прохождения в метке не задан, он отмечается текущим
+   *  моментом (TDataMessageToken::Now).
+   *  Выполняется за O(1) и выделяет в куче один узел пути.
+   * \param[in] token Метка текущего модуля
+   */
+  void Forward(const TDataMessageToken& token);
+
+  /** Очищает набор меток.
+   *
+   */
+  void Clear();
+
+  /** Возвращает хэш всего пути: набора меток и метки последнего модуля.
    *
    */
+  std::uint64_t Hash() const;
+
+  /** Оператор проверки на равенство.
+   * Сначала сравниваются хэши, поэтому различные пути, как правило,
+   * отличаются за O(1).
+   */
   bool operator==(const TDataMessageTokens& other) const;
   bool operator!=(const TDataMessageTokens& other) const;
 };
@@ -153,6 +350,11 @@ struct TDataMessage : public TMessage
     const TModuleId& source = TModuleId(),
     const TModuleId& destination = TModuleId());
 
+  TDataMessage(const TDataMessage& other) = default;
+  TDataMessage(TDataMessage&& other) noexcept = default;
+  TDataMessage& operator=(const TDataMessage& other) = default;
+  TDataMessage& operator=(TDataMessage&& other) noexcept = default;
+
   /** Деструктор.
    *
    */
@@ -187,6 +389,10 @@ struct TBatchSequence
   std::vector<std::string> sourceChannels;
 
   TBatchSequence();
+  TBatchSequence(const TBatchSequence& other) = default;
+  TBatchSequence(TBatchSequence&& other) noexcept = default;
+  TBatchSequence& operator=(const TBatchSequence& other) = default;
+  TBatchSequence& operator=(TBatchSequence&& other) noexcept = default;
   ~TBatchSequence();
 };
 
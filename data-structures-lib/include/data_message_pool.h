@@ -0,0 +1,118 @@
+#ifndef DATA_MESSAGE_POOL_H_
+#define DATA_MESSAGE_POOL_H_
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+#include "data_message.h"
+
+
+namespace wrp
+{
+
+/** Очередь сообщений, освобождённых в других потоках, пула-владельца.
+ *
+ */
+struct TDataMessageReturnQueue;
+
+/** Возвращает сообщение в пул, из которого оно получено. Если пул уже
+ *  удалён, сообщение удаляется.
+ */
+struct TDataMessageRecycler
+{
+  std::shared_ptr<TDataMessageReturnQueue> queue;
+
+  void operator()(TDataMessage* message) const;
+};
+
+/** Указатель на сообщение, полученное из пула.
+ *
+ */
+typedef std::unique_ptr<TDataMessage, TDataMessageRecycler> TDataMessagePtr;
+
+/** Пул объектов TDataMessage.
+ * Освобождённые сообщения не удаляются, а сохраняются в списке свободных
+ * вместе с ёмкостью вектора входов и строками идентификаторов входов.
+ * В установившемся режиме получение и освобождение сообщений
+ * не обращаются к куче. Исключение - путь меток (TTokenPath): каждый
+ * вызов TDataMessageTokens::Forward или Append создаёт один узел пути
+ * в куче, и пул эти узлы не переиспользует, так как они разделяются
+ * между сообщениями с общим началом пути и живут дольше сообщения.
+ * Пул не потокобезопасен: каждый поток использует свой пул (Local()).
+ * Сообщение может быть освобождено в любом потоке: в потоке, создавшем
+ * пул, оно сразу попадает в список свободных, в остальных - в очередь
+ * пула под мьютексом, которая забирается в список свободных, когда он
+ * пуст. Поэтому пул потока, только получающего сообщения, пополняется.
+ */
+class TDataMessagePool
+{
+public:
+  /** Количество свободных сообщений, хранимых пулом по умолчанию.
+   *
+   */
+  static const std::size_t DefaultMaxCachedCount = 1024;
+
+  /** Конструктор.
+   * \param[in] maxCachedCount Максимальное количество свободных сообщений
+   */
+  explicit TDataMessagePool(
+    std::size_t maxCachedCount = DefaultMaxCachedCount);
+
+  /** Деструктор. Удаляет свободные сообщения.
+   *
+   */
+  ~TDataMessagePool();
+
+  /** Возвращает пул текущего потока.
+   *
+   */
+  static TDataMessagePool& Local();
+
+  /** Получает сообщение из пула.
+   * \param[in] type Тип сообщения
+   * \param[in] source Идентификатор модуля-источника сообщения
+   * \param[in] destination Идентификатор модуля-получателя сообщения
+   * \param[in] entranceCount Количество входов в сообщении. Элементы
+   * entrances переиспользуются вместе со строками entranceId.
+   */
+  TDataMessagePtr Acquire(EMessageType::Type type,
+    const TModuleId& source = TModuleId(),
+    const TModuleId& destination = TModuleId(),
+    std::size_t entranceCount = 0);
+
+  /** Возвращает сообщение в пул. Вызывается в потоке, создавшем пул.
+   * Если пул заполнен, сообщение удаляется.
+   * \param[in] message Сообщение. Пул становится его владельцем.
+   */
+  void Release(TDataMessage* message);
+
+  /** Количество свободных сообщений в пуле.
+   *
+   */
+  std::size_t CachedCount() const;
+
+  /** Количество сообщений, созданных пулом в куче.
+   *
+   */
+  std::size_t AllocatedCount() const;
+
+  /** Количество сообщений, выданных повторно.
+   *
+   */
+  std::size_t ReusedCount() const;
+
+private:
+  std::vector<TDataMessage*> freeMessages;
+  std::shared_ptr<TDataMessageReturnQueue> returnQueue;
+  std::size_t maxCachedCount;
+  std::size_t allocatedCount;
+  std::size_t reusedCount;
+
+  TDataMessagePool(const TDataMessagePool&);
+  TDataMessagePool& operator=(const TDataMessagePool&);
+};
+
+} // namespace wrp
+
+#endif // DATA_MESSAGE_POOL_H_
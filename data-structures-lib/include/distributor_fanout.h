@@ -0,0 +1,90 @@
+#ifndef DISTRIBUTOR_FANOUT_H_
+#define DISTRIBUTOR_FANOUT_H_
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "data_message_pool.h"
+#include "module_info.h"
+#include "symbol_table.h"
+
+
+namespace wrp
+{
+
+/** Рассылает сообщение выходного комплекта типа Distributor всем
+ *  получателям комплекта.
+ * Данные сообщения не копируются: фрагменты всех получателей ссылаются
+ * на одни и те же разделяемые буферы, которые освобождаются, когда
+ * последний получатель освобождает своё сообщение. Для каждого получателя
+ * создаётся только заголовок (получатель, метки, идентификаторы входов)
+ * из пула сообщений потока, поэтому затраты памяти на данные не зависят
+ * от количества получателей.
+ */
+class TDistributorFanOut
+{
+public:
+  /** Маршрут сообщения к одному получателю.
+   *
+   */
+  struct TRoute
+  {
+    /** Идентификатор модуля-получателя.
+     *
+     */
+    TModuleId receiver;
+
+    /** Имя канала на стороне модуля-распределителя.
+     *
+     */
+    std::string name;
+
+    /** Имя канала на стороне получателя.
+     *
+     */
+    std::string convertedName;
+
+    TSymbolId nameId;
+    TSymbolId convertedNameId;
+  };
+
+  /** Конструктор.
+   * \param[in] outputBatch Выходной комплект типа Distributor
+   * \param[in] source Идентификатор модуля-распределителя
+   * \param[in] symbols Таблица символов workflow с именами каналов
+   */
+  TDistributorFanOut(const TOutputBatchInfo& outputBatch,
+    const TModuleId& source, const TSymbolTable& symbols);
+
+  /** Создаёт сообщения для всех получателей комплекта.
+   * Сообщения получают метки и фрагменты данных исходного сообщения;
+   * входы с идентификатором, равным имени канала распределителя,
+   * переименовываются в имя канала получателя.
+   * \param[in] message Исходное сообщение
+   * \param[out] messages Сообщения получателей в порядке маршрутов
+   */
+  void Broadcast(const TDataMessage& message,
+    std::vector<TDataMessagePtr>& messages) const;
+
+  /** Создаёт сообщение для получателя с индексом route.
+   * \param[in] message Исходное сообщение
+   * \param[in] route Индекс маршрута
+   */
+  TDataMessagePtr Route(const TDataMessage& message,
+    std::size_t route) const;
+
+  /** Маршруты комплекта в порядке каналов (TOutputBatchInfo::channels).
+   *
+   */
+  const std::vector<TRoute>& Routes() const;
+
+private:
+  TModuleId source;
+  std::vector<TRoute> routes;
+};
+
+} // namespace wrp
+
+#endif // DISTRIBUTOR_FANOUT_H_
@@ -0,0 +1,239 @@
+#ifndef FILE_TRANSPORT_H_
+#define FILE_TRANSPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+
+#include "block_codec.h"
+#include "data_message.h"
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Параметры файлового транспорта (ETransportType::File).
+ *
+ */
+struct TFileTransportOptions
+{
+  /** Максимальное количество одновременно выполняемых операций.
+   *
+   */
+  std::size_t queueDepth;
+
+  /** Размер блока чтения и буфера, в котором накапливаются мелкие
+   *  записи.
+   */
+  std::size_t blockSize;
+
+  /** Максимальный объём данных, запись которых ещё не завершена.
+   *
+   */
+  std::size_t maxWriteBehindSize;
+
+  /** Использовать io_uring для чтения, если он доступен (Linux). Иначе
+   *  операции выполняются синхронно через pread.
+   */
+  bool useIoUringForReading;
+
+  /** Использовать io_uring для записи, если он доступен (Linux). Иначе
+   *  операции выполняются синхронно через pwrite.
+   */
+  bool useIoUringForWriting;
+
+  /** Записывать данные кадрами размера blockSize, сжимая кадры, для
+   *  которых сжатие выгодно (см. TCompressionSelector). Файл, записанный
+   *  с этим параметром, читается только с ним же.
+   */
+  bool compression;
+
+  TFileTransportOptions();
+};
+
+/** Очередь операций ввода-вывода: асинхронных через io_uring (Linux)
+ *  или синхронных через pread/pwrite.
+ */
+class TFileIoQueue;
+
+/** Записывает данные в файл с отложенной записью.
+ * При useIoUringForWriting операции передаются ядру через io_uring и
+ * выполняются, пока модуль продолжает работу; буферы удерживаются до
+ * завершения записи. Мелкие последовательные записи объединяются в блоки
+ * размера blockSize.
+ * Объём незавершённых записей ограничен maxWriteBehindSize.
+ * В режиме сжатия данные записываются кадрами: заголовок кадра хранит
+ * смещение данных в сообщении, их размер и признак сжатия. Заголовок
+ * файла с размером данных записывается при закрытии.
+ */
+class TFileWriter
+{
+public:
+  /** Конструктор. Создаёт файл или очищает существующий.
+   * \param[in] path Путь к файлу
+   * \param[in] options Параметры транспорта
+   */
+  explicit TFileWriter(const std::string& path,
+    const TFileTransportOptions& options = TFileTransportOptions());
+
+  /** Деструктор. Дожидается завершения записей и закрывает файл.
+   *
+   */
+  ~TFileWriter();
+
+  /** Дописывает данные в конец записанной части файла.
+   * \param[in] data Данные
+   */
+  void Write(const TPayloadSlice& data);
+
+  /** Записывает данные по смещению offset.
+   * \param[in] offset Смещение в файле
+   * \param[in] data Данные
+   */
+  void WriteAt(std::uint64_t offset, const TPayloadSlice& data);
+
+  /** Записывает фрагмент сообщения по его смещению startOffset.
+   * \param[in] fragment Фрагмент сообщения
+   */
+  void Write(const TDataMessageEntranceInfo& fragment);
+
+  /** Дожидается завершения всех записей.
+   *
+   */
+  void Flush();
+
+  /** Дожидается завершения всех записей и закрывает файл.
+   *
+   */
+  void Close();
+
+  /** Проверяет, используется ли io_uring.
+   *
+   */
+  bool UsesIoUring() const;
+
+  /** Количество байт, записанных в файл. В режиме сжатия учитываются
+   *  заголовки и сжатые данные.
+   */
+  std::uint64_t StoredSize() const;
+
+private:
+  int fd;
+  TFileTransportOptions options;
+  std::unique_ptr<TFileIoQueue> queue;
+  TCompressionSelector selector;
+
+  /** Буфер, в котором накапливаются мелкие последовательные записи.
+   *
+   */
+  TPayloadBufferPtr staging;
+  std::size_t stagingUsed;
+  std::uint64_t stagingOffset;
+
+  /** Смещение конца последней записи.
+   *
+   */
+  std::uint64_t appendOffset;
+
+  /** Смещение в файле, с которого будет записан следующий кадр (в режиме
+   *  сжатия).
+   */
+  std::uint64_t frameOffset;
+
+  void WriteFrames(std::uint64_t offset, const TPayloadSlice& data);
+  void SubmitStaging();
+  void SubmitFrame(std::uint64_t offset, const TPayloadSlice& data);
+  void Submit(std::uint64_t offset, const TPayloadSlice& data);
+
+  TFileWriter(const TFileWriter&);
+  TFileWriter& operator=(const TFileWriter&);
+};
+
+/** Читает файл последовательными блоками с упреждающим чтением:
+ *  ядру одновременно передаётся до queueDepth запросов.
+ * В режиме сжатия каждый кадр возвращается отдельным фрагментом;
+ * несжатые кадры не копируются, если не пересекают границу блока.
+ */
+class TFileReader
+{
+public:
+  /** Конструктор.
+   * \param[in] path Путь к файлу
+   * \param[in] options Параметры транспорта
+   */
+  explicit TFileReader(const std::string& path,
+    const TFileTransportOptions& options = TFileTransportOptions());
+
+  /** Деструктор. Дожидается завершения запросов и закрывает файл.
+   *
+   */
+  ~TFileReader();
+
+  /** Читает очередной блок как фрагмент сообщения: заполняет поля
+   *  startOffset, totalSize, fragmentSize и data. Данные блока не
+   *  копируются. Возвращает false, если файл прочитан.
+   * \param[out] fragment Фрагмент сообщения
+   */
+  bool Read(TDataMessageEntranceInfo& fragment);
+
+  /** Размер данных файла. В режиме сжатия - размер несжатых данных.
+   *
+   */
+  std::uint64_t FileSize() const;
+
+  /** Проверяет, используется ли io_uring.
+   *
+   */
+  bool UsesIoUring() const;
+
+private:
+  /** Запрос на чтение блока.
+   *
+   */
+  struct TBlockRequest
+  {
+    std::size_t id;
+    TPayloadBufferPtr buffer;
+    std::uint64_t offset;
+  };
+
+  int fd;
+  TFileTransportOptions options;
+  std::unique_ptr<TFileIoQueue> queue;
+  std::uint64_t fileSize;
+
+  /** Размер несжатых данных из заголовка файла (в режиме сжатия).
+   *
+   */
+  std::uint64_t dataSize;
+
+  /** Прочитанные, но ещё не разобранные данные кадров.
+   *
+   */
+  TPayloadSlice input;
+
+  /** Смещение, с которого будет запрошен следующий блок.
+   *
+   */
+  std::uint64_t requestOffset;
+
+  /** Запрошенные блоки в порядке смещений.
+   *
+   */
+  std::deque<TBlockRequest> requests;
+
+  void RequestBlocks();
+  bool NextBlock(TPayloadSlice& block, std::uint64_t& offset);
+  bool Take(std::size_t size, TPayloadSlice& slice);
+  bool ReadFrame(TDataMessageEntranceInfo& fragment);
+
+  TFileReader(const TFileReader&);
+  TFileReader& operator=(const TFileReader&);
+};
+
+} // namespace wrp
+
+#endif // FILE_TRANSPORT_H_
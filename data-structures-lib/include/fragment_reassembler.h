@@ -0,0 +1,198 @@
+#ifndef FRAGMENT_REASSEMBLER_H_
+#define FRAGMENT_REASSEMBLER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <map>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "data_message.h"
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Результат добавления фрагмента в TFragmentReassembler.
+ *
+ */
+struct EReassemblyStatus
+{
+  enum Type
+  {
+    _undefined = 0,
+
+    Incomplete,
+    Duplicate,
+    Completed
+  };
+};
+
+/** Собирает сообщения вычислительных модулей из фрагментов.
+ * Фрагменты одного сообщения определяются метками модулей
+ * (TDataMessageTokens) и идентификатором входа. Фрагменты могут приходить
+ * в любом порядке и повторяться. Под каждое сообщение сразу выделяется
+ * буфер размером totalSize, и каждый байт фрагмента копируется в него
+ * ровно один раз.
+ * Суммарный размер буферов незавершённых сообщений ограничен бюджетом
+ * памяти: при его превышении удаляются давно не обновлявшиеся сообщения.
+ * Контрольные суммы фрагментов проверяются при добавлении. Если все
+ * фрагменты сообщения имеют контрольные суммы и не перекрываются,
+ * контрольная сумма собранного сообщения получается объединением сумм
+ * фрагментов без повторного чтения данных.
+ * Ключи недавно собранных сообщений, в том числе переданных одним
+ * фрагментом, запоминаются (не более completedCapacity), поэтому
+ * повторный фрагмент, пришедший после сборки, отбрасывается как дубликат
+ * и не занимает память под новый буфер.
+ */
+class TFragmentReassembler
+{
+public:
+  typedef std::chrono::steady_clock TClock;
+
+  static const std::size_t DefaultCompletedCapacity = 4096;
+
+  /** Конструктор.
+   * \param[in] memoryBudget Максимальный суммарный размер буферов
+   * незавершённых сообщений в байтах
+   * \param[in] completedCapacity Количество запоминаемых ключей собранных
+   * сообщений
+   */
+  explicit TFragmentReassembler(std::size_t memoryBudget,
+    std::size_t completedCapacity = DefaultCompletedCapacity);
+
+  /** Добавляет фрагмент сообщения.
+   * \param[in] id Метки модулей, через которые прошло сообщение
+   * \param[in] fragment Фрагмент данных
+   * \param[out] message Собранное сообщение, заполняется только при
+   * возврате EReassemblyStatus::Completed. Фрагмент в нём покрывает всё
+   * сообщение.
+   */
+  EReassemblyStatus::Type Add(const TDataMessageTokens& id,
+    const TDataMessageEntranceInfo& fragment,
+    TDataMessageEntranceInfo& message);
+
+  /** Удаляет незавершённые сообщения, не обновлявшиеся с момента time.
+   * Возвращает количество удалённых сообщений.
+   * \param[in] time Момент времени
+   */
+  std::size_t EvictOlderThan(const TClock::time_point& time);
+
+  /** Количество незавершённых сообщений.
+   *
+   */
+  std::size_t PendingCount() const;
+
+  /** Суммарный размер буферов незавершённых сообщений в байтах.
+   *
+   */
+  std::size_t PendingBytes() const;
+
+  /** Количество сообщений, удалённых из-за нехватки памяти или по времени.
+   *
+   */
+  std::size_t EvictedCount() const;
+
+private:
+  struct TKey
+  {
+    TDataMessageTokens tokens;
+    std::string entranceId;
+
+    bool operator==(const TKey& other) const;
+  };
+
+  struct TKeyHash
+  {
+    std::size_t operator()(const TKey& key) const;
+  };
+
+  /** Покрытый фрагментами интервал и контрольная сумма его данных.
+   *
+   */
+  struct TCoveredRange
+  {
+    std::size_t end;
+    std::uint32_t checksum;
+  };
+
+  typedef std::map<std::size_t, TCoveredRange> TCoverage;
+
+  struct TPartialMessage
+  {
+    TPayloadBufferPtr buffer;
+
+    /** Покрытые фрагментами интервалы [начало, конец).
+     * Соседние и пересекающиеся интервалы объединяются.
+     */
+    TCoverage coverage;
+
+    /** Признак того, что контрольные суммы интервалов действительны.
+     *
+     */
+    bool checksummed;
+
+    std::size_t coveredBytes;
+
+    TClock::time_point lastUpdate;
+
+    /** Позиция сообщения в списке lruOrder.
+     *
+     */
+    std::list<const TKey*>::iterator lruPosition;
+
+    TPartialMessage();
+  };
+
+  typedef std::unordered_map<TKey, TPartialMessage, TKeyHash>
+    TPartialMessages;
+
+  typedef std::unordered_set<TKey, TKeyHash> TCompletedKeys;
+
+  std::size_t memoryBudget;
+  std::size_t pendingBytes;
+  std::size_t evictedCount;
+
+  TPartialMessages partialMessages;
+
+  /** Незавершённые сообщения от давно обновлявшихся к недавно обновлённым.
+   *
+   */
+  std::list<const TKey*> lruOrder;
+
+  std::size_t completedCapacity;
+
+  /** Ключи недавно собранных сообщений и порядок их добавления.
+   *
+   */
+  TCompletedKeys completedKeys;
+  std::list<const TKey*> completedOrder;
+
+  /** Копирует непокрытые части фрагмента в буфер сообщения и возвращает
+   *  количество скопированных байт.
+   */
+  static std::size_t Place(TPartialMessage& partialMessage,
+    const TDataMessageEntranceInfo& fragment);
+
+  void Erase(TPartialMessages::iterator it);
+
+  void Complete(TPartialMessages::iterator it);
+
+  /** Запоминает ключ собранного сообщения.
+   *
+   */
+  void Remember(const TKey& key);
+
+  void Reserve(std::size_t size);
+
+  TFragmentReassembler(const TFragmentReassembler&);
+  TFragmentReassembler& operator=(const TFragmentReassembler&);
+};
+
+} // namespace wrp
+
+#endif // FRAGMENT_REASSEMBLER_H_
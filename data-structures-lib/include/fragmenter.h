@@ -0,0 +1,152 @@
+#ifndef FRAGMENTER_H_
+#define FRAGMENTER_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "module_info.h"
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Параметры выбора размера фрагментов.
+ *
+ */
+struct TFragmenterOptions
+{
+  /** Минимальный, максимальный и начальный размеры фрагмента. Размеры
+   *  кратны alignment.
+   */
+  std::size_t minSize;
+  std::size_t maxSize;
+  std::size_t initialSize;
+
+  /** Кратность размера фрагмента (размер страницы).
+   *
+   */
+  std::size_t alignment;
+
+  /** Количество передач фрагментов, по которым оценивается пропускная
+   *  способность при текущем размере.
+   */
+  std::size_t windowSize;
+
+  /** Количество окон, в течение которых размер не изменяется после
+   *  того, как найден лучший размер.
+   */
+  std::size_t holdWindowCount;
+
+  /** Минимальный относительный прирост пропускной способности, при
+   *  котором новый размер считается лучше прежнего.
+   */
+  double tolerance;
+
+  /** Максимальное среднее время передачи фрагмента. При превышении
+   *  размер уменьшается. Нулевое значение снимает ограничение.
+   */
+  std::chrono::nanoseconds maxLatency;
+
+  TFragmenterOptions();
+
+  /** Возвращает параметры для транспорта. Исключение, если кольцевой
+   *  буфер разделяемой памяти не вмещает фрагмент из одной страницы.
+   * \param[in] type Тип транспорта
+   * \param[in] transportSize Ёмкость канала pipe, размер блока файла или
+   * ёмкость кольцевого буфера разделяемой памяти. Нулевое значение
+   * означает размер по умолчанию.
+   */
+  static TFragmenterOptions ForTransport(ETransportType::Type type,
+    std::size_t transportSize = 0);
+};
+
+/** Делит данные сообщений на фрагменты TDataMessageEntranceInfo.
+ * Размер фрагментов подбирается по наблюдаемой пропускной способности
+ * канала: после каждого окна из windowSize передач размер вдвое
+ * увеличивается или уменьшается, пока пропускная способность растёт.
+ * Если изменение не дало прироста, восстанавливается прежний размер и
+ * направление поиска меняется. Среднее время передачи фрагмента
+ * ограничено maxLatency.
+ * Объект не потокобезопасен, для каждого канала создаётся свой объект.
+ */
+class TFragmenter
+{
+public:
+  /** Конструктор.
+   * \param[in] options Параметры выбора размера
+   */
+  explicit TFragmenter(
+    const TFragmenterOptions& options = TFragmenterOptions());
+
+  /** Делит данные на фрагменты текущего размера. Данные не копируются.
+   * Заполняет поля startOffset, totalSize, fragmentSize, entranceId и
+   * data фрагментов. Возвращает количество фрагментов.
+   * \param[in] payload Данные сообщения
+   * \param[in] entranceId Идентификатор входа
+   * \param[out] fragments Фрагменты
+   */
+  std::size_t Split(const TPayloadSlice& payload,
+    const std::string& entranceId,
+    std::vector<TDataMessageEntranceInfo>& fragments) const;
+
+  /** Учитывает передачу фрагмента.
+   * \param[in] size Размер переданного фрагмента, байт
+   * \param[in] elapsed Время передачи
+   */
+  void Observe(std::size_t size, std::chrono::nanoseconds elapsed);
+
+  /** Текущий размер фрагмента.
+   *
+   */
+  std::size_t FragmentSize() const;
+
+  /** Пропускная способность в последнем окне, байт в секунду.
+   *
+   */
+  double Throughput() const;
+
+  const TFragmenterOptions& Options() const;
+
+private:
+  TFragmenterOptions options;
+  std::size_t fragmentSize;
+
+  /** Размер и пропускная способность, с которыми сравнивается текущий
+   *  размер. Нулевой размер означает отсутствие сравнения.
+   */
+  std::size_t previousSize;
+  double previousThroughput;
+
+  /** Направление поиска: 1 - увеличение, -1 - уменьшение размера.
+   *
+   */
+  int direction;
+
+  std::size_t holdWindows;
+
+  /** Накопленные значения текущего окна.
+   *
+   */
+  std::size_t windowTransfers;
+  std::uint64_t windowSize;
+  std::chrono::nanoseconds windowTime;
+
+  double throughput;
+
+  void CompleteWindow(double windowThroughput,
+    std::chrono::nanoseconds latency);
+
+  /** Возвращает соседний размер в направлении step.
+   *
+   */
+  std::size_t Step(std::size_t size, int step) const;
+};
+
+} // namespace wrp
+
+#endif // FRAGMENTER_H_
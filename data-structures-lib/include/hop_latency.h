@@ -0,0 +1,205 @@
+#ifndef HOP_LATENCY_H_
+#define HOP_LATENCY_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "module_info.h"
+#include "symbol_table.h"
+#include "workflow_model.h"
+
+
+namespace wrp
+{
+
+/** Гистограмма задержек с логарифмически-линейными интервалами (как в
+ *  HdrHistogram).
+ * Каждая степень двойки делится на SubBucketCount равных интервалов,
+ * поэтому относительная погрешность значения не превышает
+ * 1 / SubBucketCount (около 3%). Значения до 2^MaxValueBits нс
+ * (около 73 минут), большие значения учитываются в последнем
+ * интервале. Запись выполняется без блокировок атомарными операциями
+ * с ослабленным упорядочиванием и может выполняться из нескольких
+ * потоков.
+ */
+class TLatencyHistogram
+{
+public:
+  static const unsigned int SubBucketBits = 5;
+  static const std::size_t SubBucketCount = std::size_t(1) << SubBucketBits;
+  static const unsigned int MaxValueBits = 42;
+  static const std::size_t BucketCount =
+    (MaxValueBits - SubBucketBits + 1) * SubBucketCount;
+
+  TLatencyHistogram();
+
+  /** Учитывает значение.
+   * \param[in] value Задержка в наносекундах
+   */
+  void Record(std::uint64_t value);
+
+  /** Количество учтённых значений.
+   *
+   */
+  std::uint64_t Count() const;
+
+  /** Среднее значение, нс.
+   *
+   */
+  double Mean() const;
+
+  /** Максимальное значение, нс.
+   *
+   */
+  std::uint64_t Max() const;
+
+  /** Значение, не меньше которого fraction учтённых значений, нс.
+   *  Возвращается верхняя граница интервала, содержащего значение.
+   * \param[in] fraction Доля значений от 0 до 1
+   */
+  std::uint64_t ValueAtFraction(double fraction) const;
+
+  /** Сбрасывает гистограмму. Не должен выполняться одновременно с
+   *  записью значений.
+   */
+  void Reset();
+
+  /** Номер интервала, содержащего значение.
+   * \param[in] value Значение
+   */
+  static std::size_t BucketIndex(std::uint64_t value);
+
+  /** Наибольшее значение интервала.
+   * \param[in] index Номер интервала
+   */
+  static std::uint64_t BucketHighestValue(std::size_t index);
+
+private:
+  std::atomic<std::uint64_t> counts[BucketCount];
+  std::atomic<std::uint64_t> sum;
+  std::atomic<std::uint64_t> max;
+
+  TLatencyHistogram(const TLatencyHistogram&);
+  TLatencyHistogram& operator=(const TLatencyHistogram&);
+};
+
+/** Задержки передачи сообщений между модулями workflow.
+ * Модуль, через который проходят данные, отмечает момент прохождения в
+ * своей метке (TDataMessageToken::timestamp, часы Now): это делает
+ * TDataMessageTokens::Forward. Когда сообщение
+ * поступает в модуль-получатель, разность текущего момента и момента
+ * прохождения предыдущего модуля (TDataMessageTokens::lastModuleToken)
+ * учитывается в гистограмме пары (модуль-получатель, входной канал).
+ * Таким образом задержка участка включает передачу данных и ожидание в
+ * очереди получателя. Разности моментов соседних меток пути дают время
+ * обработки в модулях и могут быть учтены через Record.
+ * Часы монотонные и общие для процессов одного узла; для модулей на
+ * разных узлах задержки не имеют смысла.
+ * Пары строятся по выходным комплектам модулей workflow; запись значений
+ * не требует блокировок, таблица не изменяется после создания.
+ */
+class THopLatencyTable
+{
+public:
+  /** Индекс участка, возвращаемый при его отсутствии.
+   *
+   */
+  static const std::size_t HopNotFound = static_cast<std::size_t>(-1);
+
+  /** Конструктор. Строит таблицу участков модели workflow.
+   * \param[in] model Модель workflow
+   * \param[in] symbols Таблица символов workflow с именами каналов
+   */
+  THopLatencyTable(const TWorkflowModel& model, const TSymbolTable& symbols);
+
+  ~THopLatencyTable();
+
+  /** Текущий момент монотонных часов в наносекундах
+   *  (TDataMessageToken::Now).
+   */
+  static std::uint64_t Now();
+
+  /** Возвращает индекс участка или HopNotFound.
+   * \param[in] receiver Идентификатор модуля-получателя в workflow
+   * \param[in] channelId Идентификатор имени входного канала получателя
+   * (TOutputMessageChannelInfo::convertedNameId)
+   */
+  std::size_t Find(TModuleId::TWorkflowId receiver,
+    TSymbolId channelId) const;
+
+  /** Учитывает задержку участка.
+   * \param[in] hop Индекс участка
+   * \param[in] latency Задержка в наносекундах
+   */
+  void Record(std::size_t hop, std::uint64_t latency);
+
+  /** Учитывает задержку поступившего сообщения: от момента прохождения
+   *  предыдущего модуля до момента now. Возвращает false, если момент
+   *  прохождения не задан или участок не найден.
+   * \param[in] message Сообщение
+   * \param[in] channelId Идентификатор имени входного канала получателя
+   * \param[in] now Момент поступления сообщения
+   */
+  bool RecordArrival(const TDataMessage& message, TSymbolId channelId,
+    std::uint64_t now);
+
+  /** Количество участков.
+   *
+   */
+  std::size_t HopCount() const;
+
+  /** Гистограмма участка.
+   * \param[in] hop Индекс участка
+   */
+  const TLatencyHistogram& Histogram(std::size_t hop) const;
+
+  /** Записывает текстовый снимок гистограмм: по строке на участок с
+   *  количеством значений, средним, процентилями и максимумом в
+   *  микросекундах. Участки без значений пропускаются.
+   * \param[out] output Поток вывода
+   */
+  void WriteSnapshot(std::ostream& output) const;
+
+  /** Записывает текстовый снимок в файл. Файл заменяется целиком, поэтому
+   *  читатель не видит частично записанный снимок.
+   * \param[in] path Путь к файлу
+   */
+  void SaveSnapshot(const std::string& path) const;
+
+private:
+  struct THopKey
+  {
+    TModuleId::TWorkflowId receiver;
+    TSymbolId channelId;
+    std::size_t hop;
+
+    bool operator<(const THopKey& other) const;
+  };
+
+  struct THop
+  {
+    std::string moduleName;
+    std::string channelName;
+    TLatencyHistogram histogram;
+  };
+
+  std::vector<std::unique_ptr<THop> > hops;
+
+  /** Ключи участков, упорядоченные для двоичного поиска.
+   *
+   */
+  std::vector<THopKey> keys;
+
+  THopLatencyTable(const THopLatencyTable&);
+  THopLatencyTable& operator=(const THopLatencyTable&);
+};
+
+} // namespace wrp
+
+#endif // HOP_LATENCY_H_
@@ -0,0 +1,65 @@
+#ifndef MESSAGE_H_
+#define MESSAGE_H_
+
+#include "module_info.h"
+
+
+namespace wrp
+{
+
+/** Представляет тип сообщения.
+ *
+ */
+struct EMessageType
+{
+  enum Type
+  {
+    _undefined = 0,
+
+    Data
+  };
+};
+
+/** Базовая структура для сообщений, которыми обмениваются модули.
+ *
+ */
+struct TMessage
+{
+  /** Тип сообщения.
+   *
+   */
+  EMessageType::Type type;
+
+  /** Идентификатор модуля-источника сообщения.
+   *
+   */
+  TModuleId source;
+
+  /** Идентификатор модуля-получателя сообщения.
+   *
+   */
+  TModuleId destination;
+
+  /** Конструктор.
+   * \param[in] type Тип сообщения
+   * \param[in] source Идентификатор модуля-источника сообщения
+   * \param[in] destination Идентификатор модуля-получателя сообщения
+   */
+  TMessage(EMessageType::Type type = EMessageType::_undefined,
+    const TModuleId& source = TModuleId(),
+    const TModuleId& destination = TModuleId());
+
+  TMessage(const TMessage& other) = default;
+  TMessage(TMessage&& other) noexcept = default;
+  TMessage& operator=(const TMessage& other) = default;
+  TMessage& operator=(TMessage&& other) noexcept = default;
+
+  /** Деструктор.
+   *
+   */
+  virtual ~TMessage();
+};
+
+} // namespace wrp
+
+#endif // MESSAGE_H_
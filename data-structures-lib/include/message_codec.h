@@ -0,0 +1,147 @@
+#ifndef MESSAGE_CODEC_H_
+#define MESSAGE_CODEC_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "data_message.h"
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Заголовок сообщения в двоичном формате передачи.
+ * Формат сообщения (все числа - little-endian):
+ *  - заголовок фиксированного размера (TWireHeader::Size байт);
+ *  - метаданные размера metaSize: идентификаторы модулей источника и
+ *    получателя, путь меток, метка последнего модуля и таблица входов.
+ *    Все целые числа метаданных записываются в формате varint (LEB128),
+ *    строка - как длина и байты. Метка модуля содержит момент
+ *    прохождения модуля (0, если не задан), запись входа - флаги
+ *    (EWireEntranceFlag) и, при наличии, контрольную сумму фрагмента
+ *    (4 байта);
+ *  - данные фрагментов в порядке таблицы входов, общим размером
+ *    payloadSize.
+ */
+struct TWireHeader
+{
+  /** Сигнатура формата.
+   *
+   */
+  static const std::uint32_t Magic = 0x4D505257; /* "WRPM" */
+
+  /** Версия формата.
+   *
+   */
+  static const std::uint16_t Version = 1;
+
+  /** Размер заголовка в байтах.
+   *
+   */
+  static const std::size_t Size = 24;
+
+  std::uint32_t magic;
+  std::uint16_t version;
+
+  /** Тип сообщения (#EMessageType).
+   *
+   */
+  std::uint16_t type;
+
+  /** Размер метаданных в байтах.
+   *
+   */
+  std::uint32_t metaSize;
+
+  /** Количество записей в таблице входов.
+   *
+   */
+  std::uint32_t entranceCount;
+
+  /** Общий размер данных фрагментов в байтах.
+   *
+   */
+  std::uint64_t payloadSize;
+
+  TWireHeader();
+
+  /** Полный размер сообщения: заголовок, метаданные и данные.
+   *
+   */
+  std::size_t MessageSize() const;
+};
+
+/** Флаги записи входа в таблице входов.
+ *
+ */
+struct EWireEntranceFlag
+{
+  enum Type
+  {
+    HasChecksum = 1 << 0
+  };
+};
+
+/** Кодирует сообщения TDataMessage в двоичный формат передачи и
+ *  декодирует их обратно.
+ */
+class TDataMessageCodec
+{
+public:
+  /** Возвращает размер заголовка и метаданных сообщения.
+   * \param[in] message Сообщение
+   */
+  static std::size_t HeadSize(const TDataMessage& message);
+
+  /** Возвращает полный размер закодированного сообщения.
+   * \param[in] message Сообщение
+   */
+  static std::size_t EncodedSize(const TDataMessage& message);
+
+  /** Записывает заголовок и метаданные сообщения без данных фрагментов.
+   * Данные фрагментов могут быть переданы следом без копирования
+   * (например, через writev). Возвращает количество записанных байт.
+   * \param[in] message Сообщение
+   * \param[out] buffer Буфер
+   * \param[in] size Размер буфера, не меньше HeadSize(message)
+   */
+  static std::size_t EncodeHead(const TDataMessage& message, char* buffer,
+    std::size_t size);
+
+  /** Записывает сообщение целиком. Возвращает количество записанных байт.
+   * \param[in] message Сообщение
+   * \param[out] buffer Буфер
+   * \param[in] size Размер буфера, не меньше EncodedSize(message)
+   */
+  static std::size_t Encode(const TDataMessage& message, char* buffer,
+    std::size_t size);
+
+  /** Кодирует сообщение в новый буфер.
+   * \param[in] message Сообщение
+   */
+  static TPayloadSlice Encode(const TDataMessage& message);
+
+  /** Читает заголовок. Возвращает false, если данных меньше
+   *  TWireHeader::Size байт. Сигнатура и версия проверяются.
+   * \param[in] data Данные
+   * \param[in] size Размер данных в байтах
+   * \param[out] header Заголовок
+   */
+  static bool DecodeHeader(const char* data, std::size_t size,
+    TWireHeader& header);
+
+  /** Декодирует сообщение из начала среза. Данные фрагментов сообщения
+   *  ссылаются на буфер среза и не копируются. Контрольные суммы
+   *  фрагментов не проверяются (TDataMessageEntranceInfo::VerifyChecksum).
+   *  Возвращает количество прочитанных байт.
+   * \param[in] input Срез с закодированным сообщением
+   * \param[out] message Сообщение
+   */
+  static std::size_t Decode(const TPayloadSlice& input,
+    TDataMessage& message);
+};
+
+} // namespace wrp
+
+#endif // MESSAGE_CODEC_H_
@@ -0,0 +1,142 @@
+#ifndef MESSAGE_LOG_H_
+#define MESSAGE_LOG_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "data_message.h"
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Журнал сообщений для воспроизведения нагрузки.
+ * Формат журнала (все числа - little-endian):
+ *  - заголовок фиксированного размера (Size байт): сигнатура, версия,
+ *    количество записей и размер записей в байтах;
+ *  - записи: время записи сообщения в наносекундах от первой записи
+ *    (8 байт) и сообщение в двоичном формате передачи (TWireHeader).
+ * Заголовок записывается при закрытии журнала, поэтому незакрытый журнал
+ * не читается.
+ */
+struct TMessageLogHeader
+{
+  static const std::uint32_t Magic = 0x4C505257; /* "WRPL" */
+  static const std::uint32_t Version = 1;
+  static const std::size_t Size = 32;
+
+  /** Размер метки времени перед сообщением.
+   *
+   */
+  static const std::size_t TimestampSize = 8;
+};
+
+/** Записывает сообщения в журнал, отображённый в память.
+ * Сообщение кодируется прямо в отображение файла, без промежуточного
+ * буфера; при нехватке места файл и отображение увеличиваются вдвое.
+ * Объект не потокобезопасен.
+ */
+class TMessageRecorder
+{
+public:
+  typedef std::chrono::steady_clock TClock;
+
+  static const std::size_t DefaultCapacity = 64 * 1024 * 1024;
+
+  /** Конструктор. Создаёт файл журнала или очищает существующий.
+   * \param[in] path Путь к файлу
+   * \param[in] capacity Начальный размер файла в байтах
+   */
+  explicit TMessageRecorder(const std::string& path,
+    std::size_t capacity = DefaultCapacity);
+
+  /** Деструктор. Закрывает журнал.
+   *
+   */
+  ~TMessageRecorder();
+
+  /** Записывает сообщение с текущим временем.
+   * \param[in] message Сообщение
+   */
+  void Record(const TDataMessage& message);
+
+  /** Записывает сообщение с заданным временем.
+   * \param[in] message Сообщение
+   * \param[in] timestamp Время в наносекундах от начала записи
+   */
+  void Record(const TDataMessage& message, std::uint64_t timestamp);
+
+  /** Записывает заголовок, обрезает файл до размера записей и
+   *  закрывает его.
+   */
+  void Close();
+
+  /** Количество записанных сообщений.
+   *
+   */
+  std::uint64_t RecordCount() const;
+
+  /** Размер журнала в байтах.
+   *
+   */
+  std::uint64_t Size() const;
+
+private:
+  int fd;
+  char* mapping;
+  std::size_t capacity;
+  std::size_t used;
+  std::uint64_t recordCount;
+  bool started;
+  TClock::time_point startTime;
+
+  void Reserve(std::size_t size);
+  void CloseFile();
+
+  TMessageRecorder(const TMessageRecorder&);
+  TMessageRecorder& operator=(const TMessageRecorder&);
+};
+
+/** Читает журнал сообщений, отображённый в память.
+ * Данные фрагментов прочитанных сообщений ссылаются на отображение и не
+ * копируются; отображение освобождается, когда освобождены журнал и
+ * все такие сообщения. Отображение доступно только для чтения, поэтому
+ * повторный проход после Rewind читает записанные данные.
+ */
+class TMessageLog
+{
+public:
+  /** Конструктор. Проверяет заголовок журнала.
+   * \param[in] path Путь к файлу
+   */
+  explicit TMessageLog(const std::string& path);
+
+  /** Читает очередное сообщение. Возвращает false, если журнал прочитан.
+   * \param[out] message Сообщение
+   * \param[out] timestamp Время записи сообщения в наносекундах
+   */
+  bool Next(TDataMessage& message, std::uint64_t& timestamp);
+
+  /** Возвращается к первому сообщению.
+   *
+   */
+  void Rewind();
+
+  /** Количество сообщений в журнале.
+   *
+   */
+  std::uint64_t RecordCount() const;
+
+private:
+  TPayloadSlice records;
+  std::uint64_t recordCount;
+  std::size_t position;
+  std::uint64_t readCount;
+};
+
+} // namespace wrp
+
+#endif // MESSAGE_LOG_H_
@@ -0,0 +1,151 @@
+#ifndef MESSAGE_REPLAYER_H_
+#define MESSAGE_REPLAYER_H_
+
+#include <cstddef>
+#include <cstdint>
+
+#include "data_message.h"
+#include "file_transport.h"
+#include "message_log.h"
+#include "pipe_transport.h"
+#include "shared_memory_transport.h"
+
+
+namespace wrp
+{
+
+/** Транспорт, через который воспроизводятся сообщения журнала.
+ *
+ */
+class TReplayTarget
+{
+public:
+  virtual ~TReplayTarget();
+
+  /** Отправляет сообщение.
+   * \param[in] message Сообщение
+   */
+  virtual void Send(const TDataMessage& message) = 0;
+
+  /** Дожидается передачи отправленных сообщений. Вызывается после
+   *  отправки последнего сообщения.
+   */
+  virtual void Flush();
+
+  /** Возвращает true, если транспорт изменяет данные фрагментов. Журнал
+   *  отображается только для чтения, поэтому такому транспорту
+   *  передаются копии данных.
+   */
+  virtual bool ModifiesData() const;
+};
+
+/** Воспроизведение через канал (TPipeWriter).
+ *
+ */
+class TPipeReplayTarget : public TReplayTarget
+{
+public:
+  explicit TPipeReplayTarget(TPipeWriter& writer);
+  virtual void Send(const TDataMessage& message) override;
+  virtual void Flush() override;
+
+private:
+  TPipeWriter& writer;
+};
+
+/** Воспроизведение через кольцевой буфер в разделяемой памяти.
+ *
+ */
+class TSharedMemoryReplayTarget : public TReplayTarget
+{
+public:
+  explicit TSharedMemoryReplayTarget(TSharedMemoryRing& ring);
+  virtual void Send(const TDataMessage& message) override;
+
+private:
+  TSharedMemoryRing& ring;
+};
+
+/** Воспроизведение через файл: фрагменты сообщений дописываются в файл.
+ *
+ */
+class TFileReplayTarget : public TReplayTarget
+{
+public:
+  explicit TFileReplayTarget(TFileWriter& writer);
+  virtual void Send(const TDataMessage& message) override;
+  virtual void Flush() override;
+
+private:
+  TFileWriter& writer;
+};
+
+/** Параметры воспроизведения.
+ *
+ */
+struct TReplayOptions
+{
+  /** Множитель скорости относительно записанной: 1 - с записанными
+   *  интервалами между сообщениями, 2 - вдвое быстрее, 0 - с
+   *  максимальной скоростью.
+   */
+  double speed;
+
+  /** Количество проходов по журналу.
+   *
+   */
+  std::size_t passCount;
+
+  TReplayOptions();
+};
+
+/** Результаты воспроизведения.
+ * Задержка сообщения - время от момента, в который сообщение должно
+ * было быть отправлено по расписанию, до завершения Send. Отсчёт от
+ * расписания, а не от фактического начала отправки, учитывает ожидание
+ * сообщений, задержанных медленным транспортом.
+ */
+struct TReplayReport
+{
+  std::uint64_t messageCount;
+
+  /** Объём данных фрагментов, байт.
+   *
+   */
+  std::uint64_t payloadSize;
+
+  double elapsedSeconds;
+
+  /** Процентили задержки, нс: 50, 90, 99, 99.9 и максимум.
+   *
+   */
+  std::uint64_t latencyP50;
+  std::uint64_t latencyP90;
+  std::uint64_t latencyP99;
+  std::uint64_t latencyP999;
+  std::uint64_t latencyMax;
+
+  TReplayReport();
+
+  double MessagesPerSecond() const;
+  double BytesPerSecond() const;
+};
+
+/** Воспроизводит сообщения журнала через транспорт.
+ *
+ */
+class TMessageReplayer
+{
+public:
+  /** Воспроизводит журнал с начала и возвращает результаты.
+   * \param[in] log Журнал
+   * \param[in] target Транспорт
+   * \param[in] options Параметры воспроизведения
+   */
+  static TReplayReport Replay(TMessageLog& log, TReplayTarget& target,
+    const TReplayOptions& options = TReplayOptions());
+};
+
+} // namespace wrp
+
+#endif // MESSAGE_REPLAYER_H_
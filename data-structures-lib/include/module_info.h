@@ -6,6 +6,8 @@
 #include <string>
 #include <vector>
 
+#include "symbol_table.h"
+
 
 struct TModuleId
 {
@@ -43,7 +45,8 @@ struct ETransportType
     _undefined = 0,
 
     Pipe,
-    File
+    File,
+    SharedMemory
   };
 };
 
@@ -58,11 +61,15 @@ struct EInputBatchType
   };
 };
 
+/** Входной комплект модуля.
+ * Имена каналов хранятся только в таблице символов workflow
+ * (TSymbolTable), комплект содержит их идентификаторы.
+ */
 struct TInputBatchInfo
 {
-  std::vector<std::string> sourceChannels;
+  std::vector<TSymbolId> sourceChannelIds;
   TModuleId::TWorkflowId source;
-  std::vector<std::string> channels;
+  std::vector<TSymbolId> channelIds;
   EInputBatchType::Type type;
 
   TInputBatchInfo();
@@ -79,17 +86,21 @@ struct EOutputBatchType
   };
 };
 
+/** Выходной комплект модуля.
+ * Имена каналов хранятся только в таблице символов workflow
+ * (TSymbolTable), комплект содержит их идентификаторы.
+ */
 struct TOutputBatchInfo
 {
   TModuleId::TWorkflowId receiver;
   struct TOutputMessageChannelInfo
   {
     TModuleId::TWorkflowId receiver;
-    std::string name;
-    std::string convertedName;
+    TSymbolId nameId;
+    TSymbolId convertedNameId;
     TOutputMessageChannelInfo();
     TOutputMessageChannelInfo(const TModuleId::TWorkflowId& receiver,
-      const std::string& name, const std::string& convertedName);
+      TSymbolId nameId, TSymbolId convertedNameId);
   };
   std::vector<TOutputMessageChannelInfo> channels;
   EOutputBatchType::Type type;
@@ -100,6 +111,7 @@ struct TOutputBatchInfo
 struct TModuleInfo
 {
   std::string name;
+  TSymbolId nameId;
   TModuleId id;
   EExecutionType::Type executionType;
   ETransportType::Type transportType;
@@ -107,6 +119,7 @@ struct TModuleInfo
   std::vector<std::string> startCommandLineArgs;
   std::string stopCommandLine;
   std::vector< std::pair<std::string, std::string> > parameters;
+  std::vector<TSymbolId> parameterNameIds;
   std::map<std::string, std::string> environmentVariables;
   std::string inputFileName;
   std::string outputFileName;
@@ -120,6 +133,10 @@ struct TModuleInfo
   bool isFinishing;
 
   TModuleInfo();
+  TModuleInfo(const TModuleInfo& other) = default;
+  TModuleInfo(TModuleInfo&& other) noexcept = default;
+  TModuleInfo& operator=(const TModuleInfo& other) = default;
+  TModuleInfo& operator=(TModuleInfo&& other) noexcept = default;
 };
 
 #endif // MODULE_INFO_H_
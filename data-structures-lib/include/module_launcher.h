@@ -0,0 +1,163 @@
+#ifndef MODULE_LAUNCHER_H_
+#define MODULE_LAUNCHER_H_
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "workflow_model.h"
+
+
+namespace wrp
+{
+
+/** Командная строка и окружение процесса, подготовленные для запуска.
+ * Строки хранятся в одном буфере, массивы argv и envp указывают в него и
+ * завершаются NULL, поэтому повторные запуски не выделяют память.
+ * Окружение - окружение текущего процесса на момент создания объекта,
+ * дополненное переменными модуля; переменные модуля заменяют
+ * одноимённые переменные процесса.
+ */
+class TLaunchCommand
+{
+public:
+  /** Конструктор.
+   * \param[in] executablePath Путь к исполняемому файлу; без '/' файл
+   * ищется в каталогах PATH
+   * \param[in] arguments Аргументы командной строки (без argv[0])
+   * \param[in] environmentVariables Переменные окружения модуля
+   */
+  TLaunchCommand(const std::string& executablePath,
+    const std::vector<std::string>& arguments,
+    const std::map<std::string, std::string>& environmentVariables);
+
+  const char* ExecutablePath() const;
+
+  /** Аргументы командной строки, argv[0] - путь к исполняемому файлу.
+   *
+   */
+  char* const* Argv() const;
+
+  char* const* Envp() const;
+
+private:
+  std::vector<char> strings;
+  std::vector<char*> argv;
+  std::vector<char*> envp;
+
+  TLaunchCommand(const TLaunchCommand&);
+  TLaunchCommand& operator=(const TLaunchCommand&);
+};
+
+/** Результат запуска процесса модуля.
+ *
+ */
+struct TLaunchResult
+{
+  /** Индекс модуля в модели workflow.
+   *
+   */
+  std::size_t module;
+
+  /** Идентификатор процесса или TModuleLauncher::NoProcess при ошибке.
+   *
+   */
+  int processId;
+
+  /** Код ошибки (errno) или 0.
+   *
+   */
+  int error;
+
+  /** Время запуска, с: от начала запуска до загрузки исполняемого
+   *  файла в порождённый процесс.
+   */
+  double startupSeconds;
+
+  TLaunchResult();
+};
+
+/** Запускает процессы внешних модулей (EExecutionType::External).
+ * Командные строки и окружения модулей подготавливаются один раз при
+ * создании объекта по модели workflow. Процессы порождаются через
+ * posix_spawn: порождённый процесс разделяет память родителя до вызова
+ * exec (семантика vfork), поэтому время запуска не зависит от объёма
+ * памяти родителя, в отличие от fork, копирующего таблицы страниц.
+ * Вызывающий поток ожидает только загрузки исполняемого файла, не
+ * завершения процесса; несколько модулей запускаются параллельно из
+ * нескольких потоков. Маска сигналов порождённого процесса сбрасывается,
+ * дескрипторы без FD_CLOEXEC наследуются.
+ */
+class TModuleLauncher
+{
+public:
+  static const int NoProcess = -1;
+
+  static const std::size_t DefaultThreadCount = 4;
+
+  /** Конструктор.
+   * \param[in] model Модель workflow
+   */
+  explicit TModuleLauncher(const TWorkflowModel& model);
+
+  ~TModuleLauncher();
+
+  /** Возвращает true, если модуль запускается отдельным процессом.
+   * \param[in] module Индекс модуля в модели workflow
+   */
+  bool IsLaunchable(std::size_t module) const;
+
+  /** Подготовленная команда запуска модуля.
+   * \param[in] module Индекс модуля в модели workflow
+   */
+  const TLaunchCommand& Command(std::size_t module) const;
+
+  /** Запускает процесс модуля. Ошибка запуска возвращается в результате.
+   * \param[in] module Индекс модуля в модели workflow
+   */
+  TLaunchResult Launch(std::size_t module) const;
+
+  /** Запускает процессы модулей параллельно. Результаты возвращаются в
+   *  порядке модулей.
+   * \param[in] modules Индексы модулей в модели workflow
+   * \param[in] threadCount Количество потоков запуска
+   */
+  std::vector<TLaunchResult> Launch(const std::vector<std::size_t>& modules,
+    std::size_t threadCount = DefaultThreadCount) const;
+
+  /** Запускает процесс по команде.
+   * \param[in] command Команда запуска
+   * \param[out] result Результат запуска
+   */
+  static void Spawn(const TLaunchCommand& command, TLaunchResult& result);
+
+  /** Запускает процесс по команде и передаёт ему дескриптор.
+   * \param[in] command Команда запуска
+   * \param[out] result Результат запуска
+   * \param[in] descriptor Дескриптор текущего процесса
+   * \param[in] childDescriptor Номер дескриптора в порождённом процессе
+   */
+  static void Spawn(const TLaunchCommand& command, TLaunchResult& result,
+    int descriptor, int childDescriptor);
+
+  /** Ожидает завершения процесса и возвращает его код завершения или
+   *  -1, если процесс завершён сигналом.
+   * \param[in] processId Идентификатор процесса
+   */
+  static int Wait(int processId);
+
+private:
+  /** Команды модулей по индексам модели; NULL для внутренних модулей.
+   *
+   */
+  std::vector<std::unique_ptr<TLaunchCommand> > commands;
+
+  TModuleLauncher(const TModuleLauncher&);
+  TModuleLauncher& operator=(const TModuleLauncher&);
+};
+
+} // namespace wrp
+
+#endif // MODULE_LAUNCHER_H_
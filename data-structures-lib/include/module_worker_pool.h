@@ -0,0 +1,199 @@
+#ifndef MODULE_WORKER_POOL_H_
+#define MODULE_WORKER_POOL_H_
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "module_launcher.h"
+#include "workflow_model.h"
+
+
+namespace wrp
+{
+
+/** Задание, получаемое заранее запущенным процессом модуля.
+ * Процесс пула запускается с переменной окружения DescriptorVariable,
+ * содержащей номер дескриптора (Descriptor), и до начала обработки
+ * читает из него задание вызовом Receive. Задание содержит параметры
+ * конкретного запуска модуля, неизвестные при запуске процесса.
+ */
+struct TWarmAssignment
+{
+  /** Имя переменной окружения с номером дескриптора задания.
+   *
+   */
+  static const char* const DescriptorVariable;
+
+  static const int Descriptor = 3;
+
+  std::map<std::string, std::string> environmentVariables;
+  std::string inputFileName;
+  std::string outputFileName;
+
+  TWarmAssignment();
+
+  /** Вызывается модулем при запуске. Если модуль запущен пулом, ожидает
+   *  задание, устанавливает переменные окружения задания и возвращает
+   *  true; иначе (обычный запуск) возвращает false. Исключение, если пул
+   *  закрыл дескриптор без задания.
+   * \param[out] assignment Задание
+   */
+  static bool Receive(TWarmAssignment& assignment);
+};
+
+/** Параметры TModuleWorkerPool.
+ *
+ */
+struct TWorkerPoolOptions
+{
+  static const std::size_t DefaultIdleCount = 1;
+
+  /** Количество ожидающих процессов на исполняемый файл.
+   *
+   */
+  std::size_t idleCount;
+
+  /** Время, с: если процессы исполняемого файла не запрашивались дольше,
+   *  ожидающие процессы завершаются и не запускаются повторно до
+   *  следующего запроса.
+   */
+  double idleSeconds;
+
+  TWorkerPoolOptions(std::size_t idleCount = DefaultIdleCount,
+    double idleSeconds = 60);
+};
+
+/** Пул заранее запущенных процессов внешних модулей.
+ * Процессы модулей с одинаковыми исполняемым файлом и аргументами
+ * командной строки (executablePath, startCommandLineArgs) взаимозаменяемы
+ * и образуют группу. Пул запускает процессы групп заранее; процесс
+ * выполняет загрузку и инициализацию и ожидает задание
+ * (TWarmAssignment). При запуске модуля (Start) ожидающий процесс
+ * получает переменные окружения, имена входного и выходного файлов
+ * модуля и сразу начинает обработку, поэтому время до первого
+ * комплекта не включает запуск процесса. При отсутствии ожидающего
+ * процесса запускается новый.
+ * Ожидающие процессы наследуют окружение текущего процесса, переменные
+ * модуля передаются в задании. Пул используется только для модулей,
+ * читающих задание (TWarmAssignment::Receive).
+ * Процессы пополняются и завершаются в Maintain, который вызывается
+ * периодически: завершившиеся ожидающие процессы удаляются, процессы
+ * групп, не запрашивавшихся дольше idleSeconds, завершаются.
+ * Запущенные через Start процессы принадлежат вызывающему и ожидаются
+ * через TModuleLauncher::Wait. Объект потокобезопасен.
+ */
+class TModuleWorkerPool
+{
+public:
+  /** Конструктор. Процессы не запускаются до вызова Maintain.
+   * \param[in] model Модель workflow
+   * \param[in] modules Индексы внешних модулей, запускаемых через пул
+   * \param[in] options Параметры пула
+   */
+  TModuleWorkerPool(const TWorkflowModel& model,
+    const std::vector<std::size_t>& modules,
+    const TWorkerPoolOptions& options = TWorkerPoolOptions());
+
+  /** Деструктор. Завершает ожидающие процессы.
+   *
+   */
+  ~TModuleWorkerPool();
+
+  /** Возвращает true, если модуль запускается через пул.
+   * \param[in] module Индекс модуля в модели workflow
+   */
+  bool IsPooled(std::size_t module) const;
+
+  /** Запускает модуль с параметрами из модели workflow.
+   * \param[in] module Индекс модуля в модели workflow
+   */
+  TLaunchResult Start(std::size_t module);
+
+  /** Запускает модуль с параметрами запуска assignment. Время запуска в
+   *  результате - время до передачи задания процессу.
+   * \param[in] module Индекс модуля в модели workflow
+   * \param[in] assignment Задание
+   */
+  TLaunchResult Start(std::size_t module,
+    const TWarmAssignment& assignment);
+
+  /** Удаляет завершившиеся процессы, завершает процессы неиспользуемых
+   *  групп и запускает недостающие.
+   *
+   */
+  void Maintain();
+
+  /** Количество ожидающих процессов.
+   *
+   */
+  std::size_t IdleCount() const;
+
+  /** Количество запусков ожидающими процессами.
+   *
+   */
+  std::uint64_t WarmStartCount() const;
+
+  /** Количество запусков новыми процессами.
+   *
+   */
+  std::uint64_t ColdStartCount() const;
+
+private:
+  typedef std::chrono::steady_clock TClock;
+
+  static const std::size_t NoGroup = static_cast<std::size_t>(-1);
+
+  struct TWorker
+  {
+    int processId;
+
+    /** Дескриптор, через который передаётся задание.
+     *
+     */
+    int socket;
+  };
+
+  struct TWorkerGroup
+  {
+    std::unique_ptr<TLaunchCommand> command;
+    std::deque<TWorker> idle;
+    TClock::time_point lastUse;
+  };
+
+  TWorkerPoolOptions options;
+  std::vector<std::unique_ptr<TWorkerGroup> > groups;
+
+  /** Группы по индексам модулей модели; NoGroup - модуль не в пуле.
+   *
+   */
+  std::vector<std::size_t> moduleGroups;
+
+  /** Задания модулей по параметрам из модели workflow.
+   *
+   */
+  std::vector<TWarmAssignment> assignments;
+
+  mutable std::mutex mutex;
+  std::uint64_t warmStartCount;
+  std::uint64_t coldStartCount;
+
+  static bool SpawnWorker(const TLaunchCommand& command, TWorker& worker,
+    int& error);
+  static void StopWorker(const TWorker& worker);
+  static bool Assign(const TWorker& worker,
+    const TWarmAssignment& assignment);
+
+  TModuleWorkerPool(const TModuleWorkerPool&);
+  TModuleWorkerPool& operator=(const TModuleWorkerPool&);
+};
+
+} // namespace wrp
+
+#endif // MODULE_WORKER_POOL_H_
@@ -0,0 +1,122 @@
+#ifndef PAYLOAD_BUFFER_H_
+#define PAYLOAD_BUFFER_H_
+
+#include <cstddef>
+#include <memory>
+
+
+namespace wrp
+{
+
+/** Буфер с данными сообщений, разделяемый несколькими владельцами.
+ * Время жизни управляется счётчиком ссылок (TPayloadBufferPtr).
+ */
+class TPayloadBuffer
+{
+public:
+  /** Функция освобождения внешней памяти буфера.
+   *
+   */
+  typedef void (*TRelease)(char* data, std::size_t size);
+
+  /** Конструктор. Выделяет неинициализированный буфер.
+   * \param[in] size Размер буфера в байтах
+   */
+  explicit TPayloadBuffer(std::size_t size);
+
+  /** Конструктор. Копирует данные в новый буфер.
+   * \param[in] data Данные
+   * \param[in] size Размер данных в байтах
+   */
+  TPayloadBuffer(const char* data, std::size_t size);
+
+  /** Конструктор. Принимает во владение внешнюю память (например,
+   *  отображённый в память участок файла), которая освобождается
+   *  функцией release в деструкторе.
+   * \param[in] data Память
+   * \param[in] size Размер памяти в байтах
+   * \param[in] release Функция освобождения памяти
+   */
+  TPayloadBuffer(char* data, std::size_t size, TRelease release);
+
+  /** Деструктор.
+   *
+   */
+  ~TPayloadBuffer();
+
+  char* Data();
+  const char* Data() const;
+  std::size_t Size() const;
+
+private:
+  char* data;
+  std::size_t size;
+  TRelease release;
+
+  TPayloadBuffer(const TPayloadBuffer&);
+  TPayloadBuffer& operator=(const TPayloadBuffer&);
+};
+
+/** Указатель на разделяемый буфер с данными.
+ *
+ */
+typedef std::shared_ptr<TPayloadBuffer> TPayloadBufferPtr;
+
+/** Представляет непрерывный участок (срез) разделяемого буфера.
+ * Копирование среза и получение вложенного среза не копируют данные.
+ */
+struct TPayloadSlice
+{
+  /** Буфер, которому принадлежит срез.
+   *
+   */
+  TPayloadBufferPtr buffer;
+
+  /** Смещение среза относительно начала буфера.
+   *
+   */
+  std::size_t offset;
+
+  /** Размер среза в байтах.
+   *
+   */
+  std::size_t length;
+
+  /** Конструктор по умолчанию. Создаёт пустой срез.
+   *
+   */
+  TPayloadSlice();
+
+  /** Конструктор.
+   * \param[in] buffer Буфер
+   * \param[in] offset Смещение среза относительно начала буфера
+   * \param[in] length Размер среза в байтах
+   */
+  TPayloadSlice(const TPayloadBufferPtr& buffer, std::size_t offset,
+    std::size_t length);
+
+  /** Конструктор. Создаёт срез на весь буфер.
+   * \param[in] buffer Буфер
+   */
+  explicit TPayloadSlice(const TPayloadBufferPtr& buffer);
+
+  /** Возвращает вложенный срез.
+   * \param[in] offset Смещение относительно начала текущего среза
+   * \param[in] length Размер вложенного среза в байтах
+   */
+  TPayloadSlice Slice(std::size_t offset, std::size_t length) const;
+
+  const char* Data() const;
+  std::size_t Size() const;
+  bool Empty() const;
+
+  /** Создаёт срез на новый буфер с копией данных.
+   * \param[in] data Данные
+   * \param[in] size Размер данных в байтах
+   */
+  static TPayloadSlice Copy(const char* data, std::size_t size);
+};
+
+} // namespace wrp
+
+#endif // PAYLOAD_BUFFER_H_
@@ -0,0 +1,279 @@
+#ifndef PIPE_TRANSPORT_H_
+#define PIPE_TRANSPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <thread>
+
+#include "data_message.h"
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Параметры транспорта через каналы (pipe).
+ *
+ */
+struct TPipeTransportOptions
+{
+  /** Запрашиваемый размер буфера канала (F_SETPIPE_SZ). Если система
+   *  не позволяет установить размер, остаётся размер по умолчанию.
+   */
+  std::size_t pipeSize;
+
+  /** Фрагменты меньшего размера копируются вместе с заголовками, чтобы
+   *  не увеличивать количество элементов в вызове writev.
+   */
+  std::size_t copyThreshold;
+
+  /** Фрагменты не меньшего размера передаются через vmsplice.
+   *
+   */
+  std::size_t spliceThreshold;
+
+  /** Записывать накопленные данные в фоновом потоке писателя, как
+   *  только канал готов их принять. Без него накопленные данные
+   *  отправляются только при вызовах Send(), TryFlush() и Flush().
+   */
+  bool autoFlush;
+
+  /** При большем объёме неотправленных данных Send() ожидает
+   *  готовности канала.
+   */
+  std::size_t maxPendingSize;
+
+  /** Размер блока, которым читатель получает данные из канала.
+   *
+   */
+  std::size_t readChunkSize;
+
+  TPipeTransportOptions();
+};
+
+/** Передаёт сообщения TDataMessage в канал в двоичном формате
+ *  TDataMessageCodec.
+ * Сообщение записывается сразу, если канал готов его принять. Пока канал
+ * заполнен, новые сообщения накапливаются и затем отправляются одним
+ * вызовом writev, поэтому объединение сообщений происходит только под
+ * нагрузкой. При autoFlush накопленные данные записывает фоновый поток
+ * писателя, как только канал становится доступен для записи, поэтому
+ * после серии сообщений без последующих вызовов данные не задерживаются
+ * дольше, чем читатель освобождает канал. Без autoFlush Send() повторяет
+ * запись накопленных данных при каждом вызове.
+ * Ошибка записи в фоновом потоке передаётся следующему вызову Send(),
+ * TryFlush(), Flush() или Close().
+ * Пока существует писатель, дескриптор находится в неблокирующем режиме;
+ * деструктор восстанавливает исходные флаги дескриптора и не закрывает
+ * его. Перед удалением писателя вызывается Close().
+ */
+class TPipeWriter
+{
+public:
+  /** Конструктор.
+   * \param[in] fd Дескриптор записи канала
+   * \param[in] options Параметры транспорта
+   */
+  explicit TPipeWriter(int fd,
+    const TPipeTransportOptions& options = TPipeTransportOptions());
+
+  /** Деструктор. Останавливает фоновый поток и не блокируется: без
+   *  вызова Close() неотправленные данные теряются, а данные, переданные через vmsplice и ещё не
+   *  прочитанные, могут быть изменены при повторном использовании их
+   *  буферов.
+   */
+  ~TPipeWriter();
+
+  /** Отправляет сообщение. Данные фрагментов не копируются, буферы
+   *  удерживаются до их записи в канал.
+   * \param[in] message Сообщение
+   */
+  void Send(const TDataMessage& message);
+
+  /** Записывает накопленные данные, не блокируясь. Возвращает true,
+   *  если все данные записаны.
+   */
+  bool TryFlush();
+
+  /** Записывает накопленные данные, ожидая готовности канала.
+   *
+   */
+  void Flush();
+
+  /** Записывает накопленные данные и дожидается чтения данных,
+   *  переданных через vmsplice, после чего их буферы освобождаются.
+   *  Ожидание прекращается, если читатель закрыл канал. Исключение при
+   *  ошибке записи.
+   */
+  void Close();
+
+  /** Объём накопленных неотправленных данных.
+   *
+   */
+  std::size_t PendingSize() const;
+
+  /** Фактический размер буфера канала.
+   *
+   */
+  std::size_t PipeSize() const;
+
+  /** Количество системных вызовов записи (writev и vmsplice).
+   *
+   */
+  std::size_t WriteCallCount() const;
+
+  /** Объём данных, переданных через vmsplice.
+   *
+   */
+  std::uint64_t SplicedSize() const;
+
+private:
+  /** Буфер, переданный через vmsplice. Страницы буфера остаются в
+   *  канале до чтения, поэтому буфер удерживается, пока позиция
+   *  endPosition не будет прочитана.
+   */
+  struct TSplicedBuffer
+  {
+    TPayloadBufferPtr buffer;
+    std::uint64_t endPosition;
+  };
+
+  int fd;
+
+  /** Флаги дескриптора до перевода в неблокирующий режим.
+   *
+   */
+  int fdFlags;
+
+  TPipeTransportOptions options;
+  std::size_t pipeSize;
+
+  /** Очередь неотправленных участков: заголовков и фрагментов.
+   *
+   */
+  std::deque<TPayloadSlice> pending;
+  std::size_t pendingSize;
+
+  /** Буфер, в который записываются заголовки и мелкие фрагменты.
+   *
+   */
+  TPayloadBufferPtr headChunk;
+  std::size_t headChunkUsed;
+
+  std::deque<TSplicedBuffer> spliced;
+  std::uint64_t writtenSize;
+  std::uint64_t splicedSize;
+  std::size_t writeCallCount;
+
+  /** Защищает состояние писателя от фонового потока.
+   *
+   */
+  mutable std::mutex mutex;
+
+  /** Фоновый поток записи (autoFlush).
+   *
+   */
+  std::thread flusher;
+
+  /** Дескриптор eventfd, которым будится фоновый поток.
+   *
+   */
+  int wakeFd;
+
+  /** Фоновый поток ожидает готовности канала к записи.
+   *
+   */
+  bool flusherWaiting;
+  bool stopping;
+
+  /** Ошибка записи в фоновом потоке.
+   *
+   */
+  std::exception_ptr flushError;
+
+  /** Возвращает место для size байт в буфере заголовков.
+   *
+   */
+  char* ReserveHead(std::size_t size);
+
+  /** Добавляет записанные в буфер заголовков size байт в очередь.
+   *
+   */
+  void CommitHead(std::size_t size);
+
+  /** Записывает накопленные данные, не блокируясь, при захваченном
+   *  мьютексе.
+   */
+  bool TryFlushLocked();
+
+  /** Проверяет ошибку фонового потока при захваченном мьютексе.
+   *
+   */
+  void CheckFlushError();
+
+  /** Будит фоновый поток, если он не ожидает готовности канала, при
+   *  захваченном мьютексе.
+   */
+  void WakeFlusher();
+
+  /** Тело фонового потока записи.
+   *
+   */
+  void RunFlusher();
+
+  void Consume(std::size_t size);
+  void ReleaseSpliced();
+  void WaitWritable();
+
+  TPipeWriter(const TPipeWriter&);
+  TPipeWriter& operator=(const TPipeWriter&);
+};
+
+/** Принимает сообщения TDataMessage из канала.
+ * Данные читаются блоками; данные фрагментов принятых сообщений
+ * ссылаются на блок и не копируются.
+ */
+class TPipeReader
+{
+public:
+  /** Конструктор.
+   * \param[in] fd Дескриптор чтения канала
+   * \param[in] options Параметры транспорта
+   */
+  explicit TPipeReader(int fd,
+    const TPipeTransportOptions& options = TPipeTransportOptions());
+
+  /** Принимает сообщение, ожидая его поступления. Возвращает false,
+   *  если канал закрыт писателем.
+   * \param[out] message Сообщение
+   */
+  bool Receive(TDataMessage& message);
+
+  /** Количество системных вызовов чтения.
+   *
+   */
+  std::size_t ReadCallCount() const;
+
+private:
+  int fd;
+  std::size_t chunkSize;
+  TPayloadBufferPtr chunk;
+  std::size_t begin;
+  std::size_t end;
+  std::size_t readCallCount;
+
+  /** Читает из канала, пока в блоке не окажется size байт.
+   * Возвращает false, если канал закрыт до поступления первого байта.
+   */
+  bool Fill(std::size_t size);
+
+  TPipeReader(const TPipeReader&);
+  TPipeReader& operator=(const TPipeReader&);
+};
+
+} // namespace wrp
+
+#endif // PIPE_TRANSPORT_H_
@@ -0,0 +1,117 @@
+#ifndef SHARED_MEMORY_TRANSPORT_H_
+#define SHARED_MEMORY_TRANSPORT_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+
+#include "data_message.h"
+
+
+namespace wrp
+{
+
+/** Кольцевой буфер в разделяемой памяти для передачи сообщений
+ *  TDataMessage между модулями одного узла (ETransportType::SharedMemory).
+ * Буфер размещается в анонимном файле (memfd), дескриптор которого
+ * передаётся второму процессу. Используется одним писателем и одним
+ * читателем, каждый из которых работает со своим объектом (второй объект
+ * создаётся вызовом Attach()); синхронизация выполняется без блокировок.
+ * Позиции записи и чтения размещены в разных строках кэша. Ожидающая
+ * сторона засыпает на futex, и системный вызов пробуждения выполняется
+ * только если другая сторона действительно ожидает.
+ * Сообщения записываются в формате TDataMessageCodec.
+ */
+class TSharedMemoryRing
+{
+public:
+  /** Ёмкость буфера по умолчанию.
+   *
+   */
+  static const std::size_t DefaultCapacity = 4 * 1024 * 1024;
+
+  /** Создаёт буфер.
+   * \param[in] capacity Ёмкость буфера в байтах (округляется вверх до
+   *  степени двойки)
+   */
+  static std::unique_ptr<TSharedMemoryRing> Create(
+    std::size_t capacity = DefaultCapacity);
+
+  /** Подключается к буферу, созданному другим процессом.
+   * \param[in] fd Дескриптор буфера (см. Descriptor()). Объект
+   *  использует копию дескриптора; fd остаётся открытым и закрывается
+   *  вызывающим
+   */
+  static std::unique_ptr<TSharedMemoryRing> Attach(int fd);
+
+  /** Деструктор. Освобождает отображение и закрывает дескриптор.
+   *
+   */
+  ~TSharedMemoryRing();
+
+  /** Записывает сообщение, если в буфере есть место.
+   * \param[in] message Сообщение
+   */
+  bool TrySend(const TDataMessage& message);
+
+  /** Записывает сообщение, ожидая освобождения места.
+   * \param[in] message Сообщение
+   */
+  void Send(const TDataMessage& message);
+
+  /** Сообщает читателю, что сообщений больше не будет.
+   *
+   */
+  void Close();
+
+  /** Принимает сообщение, если оно есть. Данные фрагментов копируются
+   *  из разделяемой памяти в один буфер сообщения.
+   * \param[out] message Сообщение
+   */
+  bool TryReceive(TDataMessage& message);
+
+  /** Принимает сообщение, ожидая его поступления. Возвращает false,
+   *  если буфер пуст и писатель вызвал Close().
+   * \param[out] message Сообщение
+   */
+  bool Receive(TDataMessage& message);
+
+  /** Дескриптор разделяемой памяти для передачи другому процессу.
+   *
+   */
+  int Descriptor() const;
+
+  std::size_t Capacity() const;
+
+  /** Количество системных вызовов пробуждения, выполненных данной
+   *  стороной.
+   */
+  std::size_t WakeCount() const;
+
+private:
+  struct TControl;
+
+  int fd;
+  char* mapping;
+  std::size_t mappingSize;
+  TControl* control;
+  char* data;
+  std::size_t capacity;
+
+  /** Последние прочитанные значения позиций другой стороны. Позволяют
+   *  не обращаться к чужой строке кэша при каждой операции.
+   */
+  std::uint64_t cachedTail;
+  std::uint64_t cachedHead;
+
+  std::size_t wakeCount;
+
+  TSharedMemoryRing(int fd, std::size_t mappingSize);
+
+  TSharedMemoryRing(const TSharedMemoryRing&);
+  TSharedMemoryRing& operator=(const TSharedMemoryRing&);
+};
+
+} // namespace wrp
+
+#endif // SHARED_MEMORY_TRANSPORT_H_
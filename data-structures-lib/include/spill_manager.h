@@ -0,0 +1,208 @@
+#ifndef SPILL_MANAGER_H_
+#define SPILL_MANAGER_H_
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+/** Параметры TSpillManager.
+ *
+ */
+struct TSpillOptions
+{
+  static const std::size_t DefaultMemoryBudget = 1024 * 1024 * 1024;
+  static const std::size_t DefaultMinSpillSize = 64 * 1024;
+
+  /** Максимальный объём данных в памяти, байт.
+   *
+   */
+  std::size_t memoryBudget;
+
+  /** Минимальный размер данных, выгружаемых на диск (для буфера -
+   *  суммарный размер ссылающихся на него данных). Более мелкие данные
+   *  остаются в памяти.
+   */
+  std::size_t minSpillSize;
+
+  TSpillOptions(std::size_t memoryBudget = DefaultMemoryBudget,
+    std::size_t minSpillSize = DefaultMinSpillSize);
+};
+
+/** Хранит данные сообщений, ожидающих получателя, с ограничением объёма
+ *  памяти.
+ * Данные помещаются в хранилище (Put) и получаются по выданному номеру
+ * (Get). Пока объём данных в памяти не превышает бюджета, хранилище не
+ * обращается к диску. При превышении бюджета данные, к которым дольше
+ * всего не обращались, записываются во временный файл в каталоге
+ * модуля (TModuleInfo::tempDirectoryPath) и освобождаются в памяти.
+ * Выгруженные данные возвращаются отображением участка файла в память
+ * без копирования; страницы отображения принадлежат страничному кэшу и
+ * могут быть вытеснены ядром, поэтому в бюджете не учитываются.
+ * В бюджете учитывается полный размер буферов данных, а не размер
+ * срезов; буфер, на который ссылаются несколько срезов в хранилище
+ * (например, фрагменты одного сообщения), учитывается один раз.
+ * Выгружаются все срезы буфера вместе и только если буфер не
+ * используется вне хранилища, иначе выгрузка не освободила бы память.
+ * Файл удаляется из каталога сразу после создания, место освобождается
+ * при удалении данных из хранилища (Remove). Объект потокобезопасен.
+ */
+class TSpillManager
+{
+public:
+  typedef std::uint64_t TTicket;
+
+  /** Конструктор.
+   * \param[in] directoryPath Каталог для временного файла
+   * \param[in] options Параметры хранилища
+   */
+  explicit TSpillManager(const std::string& directoryPath,
+    const TSpillOptions& options = TSpillOptions());
+
+  /** Деструктор. Закрывает временный файл; отображения, полученные
+   *  через Get, остаются действительными.
+   */
+  ~TSpillManager();
+
+  /** Помещает данные в хранилище и возвращает их номер.
+   * \param[in] data Данные
+   */
+  TTicket Put(const TPayloadSlice& data);
+
+  /** Возвращает данные по номеру. Выгруженные данные отображаются из
+   *  файла в память только для чтения; запись в них недопустима.
+   * \param[in] ticket Номер данных
+   */
+  TPayloadSlice Get(TTicket ticket);
+
+  /** Удаляет данные из хранилища.
+   * \param[in] ticket Номер данных
+   */
+  void Remove(TTicket ticket);
+
+  /** Объём буферов данных в памяти, байт.
+   *
+   */
+  std::size_t MemorySize() const;
+
+  /** Объём выгруженных данных, байт.
+   *
+   */
+  std::uint64_t SpilledSize() const;
+
+  /** Количество выгрузок данных на диск.
+   *
+   */
+  std::size_t SpillCount() const;
+
+private:
+  struct TEntry
+  {
+    /** Данные в памяти; пустой срез, если данные выгружены или пусты.
+     *
+     */
+    TPayloadSlice data;
+
+    std::size_t size;
+
+    bool spilled;
+
+    /** Смещение выгруженных данных в файле.
+     *
+     */
+    std::uint64_t fileOffset;
+
+    /** Последнее отображение выгруженных данных.
+     *
+     */
+    std::weak_ptr<TPayloadBuffer> mapping;
+
+    TEntry();
+  };
+
+  /** Буфер в памяти, на который ссылаются данные хранилища.
+   *
+   */
+  struct TBufferUse
+  {
+    /** Номера данных, ссылающихся на буфер.
+     *
+     */
+    std::vector<TTicket> tickets;
+
+    /** Суммарный размер данных, ссылающихся на буфер.
+     *
+     */
+    std::size_t dataSize;
+
+    /** Позиция в списке lruOrder; действительна, если inLru.
+     *
+     */
+    std::list<const TPayloadBuffer*>::iterator lruPosition;
+
+    bool inLru;
+
+    TBufferUse();
+  };
+
+  /** Участок файла удалённых данных, отображение которого ещё
+   *  используется.
+   */
+  struct TRetiredRange
+  {
+    std::uint64_t fileOffset;
+    std::size_t size;
+    std::weak_ptr<TPayloadBuffer> mapping;
+  };
+
+  typedef std::unordered_map<TTicket, TEntry> TEntries;
+  typedef std::unordered_map<const TPayloadBuffer*, TBufferUse> TBuffers;
+
+  mutable std::mutex mutex;
+  std::string directoryPath;
+  TSpillOptions options;
+  int fd;
+  std::uint64_t fileEnd;
+  std::size_t pageSize;
+
+  TTicket nextTicket;
+  std::size_t memorySize;
+  std::uint64_t spilledSize;
+  std::size_t spilledCount;
+  std::size_t spillCount;
+
+  TEntries entries;
+  TBuffers buffers;
+
+  /** Буферы, данные которых можно выгрузить (не меньше minSpillSize),
+   *  от давно использованных к недавно использованным.
+   */
+  std::list<const TPayloadBuffer*> lruOrder;
+
+  std::vector<TRetiredRange> retiredRanges;
+
+  void SpillCold();
+  void Spill(TBuffers::iterator use);
+  void Touch(TBuffers::iterator use);
+  TPayloadSlice Map(TEntry& entry);
+  void ReleaseRange(std::uint64_t fileOffset, std::size_t size);
+  void ReleaseRetiredRanges();
+  void OpenFile();
+
+  TSpillManager(const TSpillManager&);
+  TSpillManager& operator=(const TSpillManager&);
+};
+
+} // namespace wrp
+
+#endif // SPILL_MANAGER_H_
@@ -0,0 +1,87 @@
+#ifndef SYMBOL_TABLE_H_
+#define SYMBOL_TABLE_H_
+
+#include <cstddef>
+#include <deque>
+#include <string>
+#include <unordered_map>
+
+
+/** Представляет идентификатор строки в таблице символов.
+ * Идентификаторы плотные: выдаются подряд начиная с единицы.
+ */
+typedef unsigned int TSymbolId;
+
+/** Значение по умолчанию для объектов типа TSymbolId.
+ * Соответствует пустой строке.
+ */
+const TSymbolId SymbolIdUndefined = 0;
+
+/** Таблица символов, общая для всего workflow.
+ * Хранит единственную копию каждого имени (модуля, канала, параметра),
+ * что позволяет сравнивать имена и искать по ним как по целым числам.
+ */
+class TSymbolTable
+{
+public:
+  /** Конструктор по умолчанию.
+   *
+   */
+  TSymbolTable();
+
+  /** Возвращает идентификатор строки, добавляя её в таблицу при отсутствии.
+   * \param[in] str Строка
+   */
+  TSymbolId Intern(const std::string& str);
+
+  /** Возвращает идентификатор строки или SymbolIdUndefined,
+   *  если строка в таблицу не добавлялась.
+   * \param[in] str Строка
+   */
+  TSymbolId Find(const std::string& str) const;
+
+  /** Возвращает строку по её идентификатору.
+   * \param[in] id Идентификатор строки
+   */
+  const std::string& GetString(TSymbolId id) const;
+
+  /** Количество идентификаторов в таблице, включая SymbolIdUndefined.
+   *
+   */
+  std::size_t Size() const;
+
+  /** Удаляет все строки из таблицы.
+   *
+   */
+  void Clear();
+
+private:
+  struct TStringPtrHash
+  {
+    std::size_t operator()(const std::string* str) const;
+  };
+
+  struct TStringPtrEqual
+  {
+    bool operator()(const std::string* lhs, const std::string* rhs) const;
+  };
+
+  typedef std::unordered_map<const std::string*, TSymbolId, TStringPtrHash,
+    TStringPtrEqual> TIndex;
+
+  /** Пул строк. Индекс в пуле совпадает с идентификатором строки.
+   * std::deque не перемещает элементы при добавлении, поэтому указатели
+   * на строки пула остаются действительными.
+   */
+  std::deque<std::string> pool;
+
+  /** Индекс для поиска идентификатора по строке без копирования ключей.
+   *
+   */
+  TIndex index;
+
+  TSymbolTable(const TSymbolTable&);
+  TSymbolTable& operator=(const TSymbolTable&);
+};
+
+#endif // SYMBOL_TABLE_H_
@@ -0,0 +1,44 @@
+#ifndef TOKEN_PATH_MAP_H_
+#define TOKEN_PATH_MAP_H_
+
+#include <cstddef>
+#include <unordered_map>
+
+#include "data_message.h"
+
+
+namespace wrp
+{
+
+/** Хэш-функция для путей сообщений (TDataMessageTokens).
+ * Вычисляется за O(1) по хэшу, который путь поддерживает сам.
+ */
+struct TDataMessageTokensHash
+{
+  std::size_t operator()(const TDataMessageTokens& tokens) const
+  {
+    return static_cast<std::size_t>(tokens.Hash());
+  }
+};
+
+/** Хэш-функция для последовательностей меток (TTokenPath).
+ *
+ */
+struct TTokenPathHash
+{
+  std::size_t operator()(const TTokenPath& path) const
+  {
+    return static_cast<std::size_t>(path.Hash());
+  }
+};
+
+/** Хэш-таблица, ключом которой является путь сообщения.
+ *
+ */
+template <class T>
+using TTokenPathMap =
+  std::unordered_map<TDataMessageTokens, T, TDataMessageTokensHash>;
+
+} // namespace wrp
+
+#endif // TOKEN_PATH_MAP_H_
@@ -0,0 +1,145 @@
+#ifndef WORKFLOW_MODEL_H_
+#define WORKFLOW_MODEL_H_
+
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "module_info.h"
+#include "symbol_table.h"
+
+
+/** Флаги вычислительного модуля, упакованные в один байт.
+ *
+ */
+struct EModuleFlag
+{
+  enum Type
+  {
+    IsTransferable = 1 << 0,
+    HasState = 1 << 1,
+    IsStarting = 1 << 2,
+    IsFinishing = 1 << 3
+  };
+};
+
+/** Редко используемые поля вычислительного модуля.
+ * Хранятся отдельно от часто просматриваемых полей TWorkflowModel.
+ */
+struct TModuleColdInfo
+{
+  std::string name;
+  std::string executablePath;
+  std::vector<std::string> startCommandLineArgs;
+  std::string stopCommandLine;
+  std::vector< std::pair<std::string, std::string> > parameters;
+  std::vector<TSymbolId> parameterNameIds;
+  std::map<std::string, std::string> environmentVariables;
+  std::string inputFileName;
+  std::string outputFileName;
+  std::string stateFileName;
+  std::string tempDirectoryPath;
+  std::vector<TInputBatchInfo> inputBatches;
+  std::vector<TOutputBatchInfo> outputBatches;
+
+  TModuleColdInfo();
+};
+
+/** Компактная модель workflow.
+ * Часто просматриваемые поля модулей хранятся по столбцам
+ * (structure of arrays), i-й элемент каждого столбца относится к i-му модулю.
+ * Остальные поля вынесены в столбец cold.
+ */
+struct TWorkflowModel
+{
+  typedef unsigned char TModuleFlags;
+
+  typedef unsigned int TBatchCount;
+
+  /** Идентификаторы модулей.
+   *
+   */
+  std::vector<TModuleId> ids;
+
+  /** Идентификаторы имён модулей в таблице символов.
+   *
+   */
+  std::vector<TSymbolId> nameIds;
+
+  /** Типы исполнения модулей (значения EExecutionType::Type).
+   *
+   */
+  std::vector<unsigned char> executionTypes;
+
+  /** Типы транспорта модулей (значения ETransportType::Type).
+   *
+   */
+  std::vector<unsigned char> transportTypes;
+
+  /** Флаги модулей (комбинация значений EModuleFlag::Type).
+   *
+   */
+  std::vector<TModuleFlags> flags;
+
+  /** Количество входных комплектов модулей.
+   *
+   */
+  std::vector<TBatchCount> inputBatchCounts;
+
+  /** Количество выходных комплектов модулей.
+   *
+   */
+  std::vector<TBatchCount> outputBatchCounts;
+
+  /** Редко используемые поля модулей.
+   *
+   */
+  std::vector<TModuleColdInfo> cold;
+
+  /** Конструктор по умолчанию.
+   *
+   */
+  TWorkflowModel();
+
+  /** Конструктор.
+   * \param[in] modules Информация о модулях workflow
+   */
+  explicit TWorkflowModel(const std::vector<TModuleInfo>& modules);
+
+  /** Заменяет содержимое модели информацией о модулях.
+   * \param[in] modules Информация о модулях workflow
+   */
+  void Assign(const std::vector<TModuleInfo>& modules);
+
+  /** Добавляет модуль в модель и возвращает его индекс.
+   * \param[in] module Информация о модуле
+   */
+  std::size_t Append(const TModuleInfo& module);
+
+  /** Восстанавливает полную информацию о модуле по его индексу.
+   * \param[in] index Индекс модуля в модели
+   * \param[out] module Информация о модуле
+   */
+  void Extract(std::size_t index, TModuleInfo& module) const;
+
+  /** Возвращает индекс модуля с указанным идентификатором или Size(),
+   *  если модуль не найден.
+   * \param[in] id Идентификатор модуля
+   */
+  std::size_t Find(const TModuleId& id) const;
+
+  /** Проверяет, установлен ли флаг у модуля.
+   * \param[in] index Индекс модуля в модели
+   * \param[in] flag Флаг модуля
+   */
+  bool HasFlag(std::size_t index, EModuleFlag::Type flag) const;
+
+  std::size_t Size() const;
+
+  void Reserve(std::size_t count);
+
+  void Clear();
+};
+
+#endif // WORKFLOW_MODEL_H_
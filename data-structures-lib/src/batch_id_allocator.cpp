@@ -0,0 +1,114 @@
+#include <atomic>
+#include <cstddef>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+#include "batch_id_allocator.h"
+
+
+namespace wrp
+{
+
+TBatchIdBlock::TBatchIdBlock() :
+  firstId(BatchInstanceIdUndefined), lastId(BatchInstanceIdUndefined)
+{
+}
+
+TBatchIdBlock::TBatchIdBlock(TBatchInstanceId firstId,
+  TBatchInstanceId lastId) :
+  firstId(firstId), lastId(lastId)
+{
+}
+
+std::size_t TBatchIdBlock::Size() const
+{
+  return (firstId == BatchInstanceIdUndefined) ? 0 : lastId - firstId + 1;
+}
+
+
+const std::size_t TBatchIdAllocator::DefaultBlockSize;
+
+TBatchIdAllocator::TBatchIdAllocator(std::size_t blockSize) :
+  nextId(BatchInstanceIdUndefined + 1), blockSize(blockSize)
+{
+  if (blockSize == 0)
+  {
+    std::stringstream info;
+    info << "Block size of batch id allocator must be positive.";
+    throw std::runtime_error(info.str());
+  }
+}
+
+TBatchIdBlock TBatchIdAllocator::AllocateBlock(std::size_t count)
+{
+  if (count == 0)
+  {
+    std::stringstream info;
+    info << "Count of allocated batch ids must be positive.";
+    throw std::runtime_error(info.str());
+  }
+  TBatchInstanceId firstId =
+    nextId.fetch_add(count, std::memory_order_relaxed);
+  if ((firstId == BatchInstanceIdUndefined) ||
+    (count - 1 > std::numeric_limits<TBatchInstanceId>::max() - firstId))
+  {
+    std::stringstream info;
+    info << "Batch instance ids are exhausted.";
+    throw std::runtime_error(info.str());
+  }
+  return TBatchIdBlock(firstId, firstId + (count - 1));
+}
+
+TBatchIdBlock TBatchIdAllocator::AllocateBlock()
+{
+  return AllocateBlock(blockSize);
+}
+
+void TBatchIdAllocator::AllocateSequence(std::size_t count,
+  TBatchSequence& sequence)
+{
+  TBatchIdBlock block = AllocateBlock(count);
+  sequence.firstId = block.firstId;
+  sequence.lastId = block.lastId;
+}
+
+std::size_t TBatchIdAllocator::BlockSize() const
+{
+  return blockSize;
+}
+
+
+TBatchSequenceSink::~TBatchSequenceSink()
+{
+}
+
+
+TBatchIdCursor::TBatchIdCursor(TBatchIdAllocator& allocator,
+  TBatchSequenceSink& sink, const TBatchSequence& prototype) :
+  allocator(allocator), sink(sink), sequence(prototype), block(),
+  nextId(BatchInstanceIdUndefined)
+{
+}
+
+TBatchInstanceId TBatchIdCursor::Next()
+{
+  if ((nextId == BatchInstanceIdUndefined) || (nextId > block.lastId))
+  {
+    TBatchIdBlock newBlock = allocator.AllocateBlock();
+    sequence.firstId = newBlock.firstId;
+    sequence.lastId = newBlock.lastId;
+    /* Ids of the block are handed out only after it has been recorded */
+    sink.Record(sequence);
+    block = newBlock;
+    nextId = block.firstId;
+  }
+  return nextId++;
+}
+
+const TBatchIdBlock& TBatchIdCursor::Block() const
+{
+  return block;
+}
+
+} // namespace wrp
@@ -0,0 +1,129 @@
+#include <algorithm>
+#include <cstddef>
+#include <iterator>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+
+#include "batch_sequence_progress.h"
+
+
+namespace wrp
+{
+
+TBatchSequenceProgress::TBatchSequenceProgress(
+  const TBatchSequence& sequence) :
+  firstId(sequence.firstId), lastId(sequence.lastId),
+  completedCount(0), intervals()
+{
+  if (firstId > lastId)
+  {
+    std::stringstream info;
+    info << "Incorrect batch sequence. First id: " << firstId <<
+      ", last id: " << lastId << ".";
+    throw std::runtime_error(info.str());
+  }
+}
+
+bool TBatchSequenceProgress::MarkCompleted(TBatchInstanceId id)
+{
+  return MarkCompleted(id, id) != 0;
+}
+
+std::size_t TBatchSequenceProgress::MarkCompleted(TBatchInstanceId first,
+  TBatchInstanceId last)
+{
+  if ((first > last) || (first < firstId) || (last > lastId))
+  {
+    std::stringstream info;
+    info << "Batch range [" << first << ", " << last << "] is out of " <<
+      "sequence [" << firstId << ", " << lastId << "].";
+    throw std::runtime_error(info.str());
+  }
+
+  /* Finding first interval which intersects or adjoins the range */
+  std::map<TBatchInstanceId, TBatchInstanceId>::iterator it =
+    intervals.upper_bound(first);
+  if (it != intervals.begin())
+  {
+    std::map<TBatchInstanceId, TBatchInstanceId>::iterator prev =
+      std::prev(it);
+    if ((prev->second >= first) || (prev->second + 1 == first))
+    {
+      it = prev;
+    }
+  }
+
+  /* Merging the range with intersecting and adjoining intervals */
+  std::size_t addedCount = last - first + 1;
+  TBatchInstanceId mergedFirst = first;
+  TBatchInstanceId mergedLast = last;
+  while ((it != intervals.end()) &&
+    ((it->first <= last) || (it->first == last + 1)))
+  {
+    TBatchInstanceId overlapFirst = std::max(it->first, first);
+    TBatchInstanceId overlapLast = std::min(it->second, last);
+    if (overlapFirst <= overlapLast)
+    {
+      addedCount -= overlapLast - overlapFirst + 1;
+    }
+    mergedFirst = std::min(mergedFirst, it->first);
+    mergedLast = std::max(mergedLast, it->second);
+    intervals.erase(it++);
+  }
+  intervals[mergedFirst] = mergedLast;
+  completedCount += addedCount;
+  return addedCount;
+}
+
+bool TBatchSequenceProgress::IsCompleted(TBatchInstanceId id) const
+{
+  std::map<TBatchInstanceId, TBatchInstanceId>::const_iterator it =
+    intervals.upper_bound(id);
+  if (it == intervals.begin())
+  {
+    return false;
+  }
+  --it;
+  return id <= it->second;
+}
+
+bool TBatchSequenceProgress::IsSequenceCompleted() const
+{
+  return completedCount == lastId - firstId + 1;
+}
+
+TBatchInstanceId TBatchSequenceProgress::FirstMissing() const
+{
+  if (IsSequenceCompleted())
+  {
+    return BatchInstanceIdUndefined;
+  }
+  if (intervals.empty() || (intervals.begin()->first != firstId))
+  {
+    return firstId;
+  }
+  return intervals.begin()->second + 1;
+}
+
+std::size_t TBatchSequenceProgress::CompletedCount() const
+{
+  return completedCount;
+}
+
+std::size_t TBatchSequenceProgress::IntervalCount() const
+{
+  return intervals.size();
+}
+
+TBatchInstanceId TBatchSequenceProgress::FirstId() const
+{
+  return firstId;
+}
+
+TBatchInstanceId TBatchSequenceProgress::LastId() const
+{
+  return lastId;
+}
+
+} // namespace wrp
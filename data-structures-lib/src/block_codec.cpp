@@ -0,0 +1,396 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "block_codec.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+const std::size_t MinMatch = 4;
+
+/* Block always ends with literals, matches stop before these limits */
+const std::size_t LastLiterals = 5;
+const std::size_t MatchFindLimit = 12;
+
+const std::size_t MaxOffset = 65535;
+
+const unsigned int HashLog = 12;
+
+/* Search step grows after this many misses in a row (incompressible
+   data is skipped quickly) */
+const unsigned int SkipTrigger = 6;
+
+const std::size_t SampleSize = 4096;
+const std::size_t SampleCount = 3;
+
+inline std::uint32_t Read32(const unsigned char* pos)
+{
+  std::uint32_t value;
+  std::memcpy(&value, pos, sizeof(value));
+  return value;
+}
+
+inline std::uint64_t Read64(const unsigned char* pos)
+{
+  std::uint64_t value;
+  std::memcpy(&value, pos, sizeof(value));
+  return value;
+}
+
+/* Number of equal leading bytes of a and b, at most limit - a */
+inline std::size_t CommonLength(const unsigned char* a,
+  const unsigned char* b, const unsigned char* limit)
+{
+  const unsigned char* start = a;
+#if !defined(__BYTE_ORDER__) || (__BYTE_ORDER__ != __ORDER_BIG_ENDIAN__)
+  while (limit - a >= 8)
+  {
+    std::uint64_t difference = Read64(a) ^ Read64(b);
+    if (difference != 0)
+    {
+#if defined(__GNUC__)
+      return (a - start) + (__builtin_ctzll(difference) >> 3);
+#else
+      while ((difference & 0xFF) == 0)
+      {
+        difference >>= 8;
+        ++a;
+      }
+      return a - start;
+#endif
+    }
+    a += 8;
+    b += 8;
+  }
+#endif
+  while ((a < limit) && (*a == *b))
+  {
+    ++a;
+    ++b;
+  }
+  return a - start;
+}
+
+inline std::uint32_t Hash(std::uint32_t value)
+{
+  return (value * 2654435761U) >> (32 - HashLog);
+}
+
+inline unsigned char* PutLength(unsigned char* pos, std::size_t length)
+{
+  while (length >= 255)
+  {
+    *pos++ = 255;
+    length -= 255;
+  }
+  *pos++ = static_cast<unsigned char>(length);
+  return pos;
+}
+
+/* Writes one sequence; returns NULL if it doesn't fit */
+unsigned char* PutSequence(unsigned char* pos, unsigned char* end,
+  const unsigned char* literals, std::size_t literalCount,
+  std::size_t offset, std::size_t matchLength)
+{
+  if (static_cast<std::size_t>(end - pos) <
+    1 + literalCount + literalCount / 255 + 1 + 2 + matchLength / 255 + 1)
+  {
+    return NULL;
+  }
+  unsigned char* token = pos++;
+  *token = static_cast<unsigned char>(std::min<std::size_t>(literalCount,
+    15) << 4);
+  if (literalCount >= 15)
+  {
+    pos = PutLength(pos, literalCount - 15);
+  }
+  if (literalCount > 0)
+  {
+    std::memcpy(pos, literals, literalCount);
+    pos += literalCount;
+  }
+  if (offset == 0)
+  {
+    return pos;
+  }
+
+  *pos++ = static_cast<unsigned char>(offset & 0xFF);
+  *pos++ = static_cast<unsigned char>(offset >> 8);
+  std::size_t length = matchLength - MinMatch;
+  *token = static_cast<unsigned char>(*token |
+    std::min<std::size_t>(length, 15));
+  if (length >= 15)
+  {
+    pos = PutLength(pos, length - 15);
+  }
+  return pos;
+}
+
+void ThrowCorrupted(const char* reason)
+{
+  std::stringstream info;
+  info << "Corrupted compressed block: " << reason << ".";
+  throw std::runtime_error(info.str());
+}
+
+std::size_t GetLength(const unsigned char*& pos, const unsigned char* end,
+  std::size_t length)
+{
+  if (length != 15)
+  {
+    return length;
+  }
+  unsigned char byte = 0;
+  do
+  {
+    if (pos == end)
+    {
+      ThrowCorrupted("length is truncated");
+    }
+    byte = *pos++;
+    length += byte;
+  }
+  while (byte == 255);
+  return length;
+}
+
+} // namespace
+
+
+std::size_t TBlockCodec::MaxCompressedSize(std::size_t size)
+{
+  return size + size / 255 + 16;
+}
+
+std::size_t TBlockCodec::Compress(const char* source, std::size_t size,
+  char* destination, std::size_t capacity)
+{
+  const unsigned char* input = reinterpret_cast<const unsigned char*>(source);
+  unsigned char* output = reinterpret_cast<unsigned char*>(destination);
+  unsigned char* outputEnd = output + capacity;
+  unsigned char* pos = output;
+  std::size_t anchor = 0;
+
+  if (size >= MatchFindLimit + 1)
+  {
+    std::uint32_t table[1 << HashLog];
+    std::memset(table, 0, sizeof(table));
+    const std::size_t matchLimit = size - LastLiterals;
+    const std::size_t findLimit = size - MatchFindLimit;
+
+    std::size_t ip = 1;
+    unsigned int misses = 1 << SkipTrigger;
+    while (ip < findLimit)
+    {
+      std::uint32_t sequence = Read32(input + ip);
+      std::uint32_t& slot = table[Hash(sequence)];
+      std::size_t ref = slot;
+      slot = static_cast<std::uint32_t>(ip);
+      if ((ref >= ip) || (ip - ref > MaxOffset) ||
+        (Read32(input + ref) != sequence))
+      {
+        ip += misses++ >> SkipTrigger;
+        continue;
+      }
+      misses = 1 << SkipTrigger;
+
+      /* Extending the match backward and forward */
+      while ((ip > anchor) && (ref > 0) && (input[ip - 1] == input[ref - 1]))
+      {
+        --ip;
+        --ref;
+      }
+      std::size_t length = MinMatch + CommonLength(input + ip + MinMatch,
+        input + ref + MinMatch, input + matchLimit);
+
+      pos = PutSequence(pos, outputEnd, input + anchor, ip - anchor,
+        ip - ref, length);
+      if (pos == NULL)
+      {
+        return 0;
+      }
+      ip += length;
+      anchor = ip;
+      if (ip - 2 < findLimit)
+      {
+        table[Hash(Read32(input + ip - 2))] =
+          static_cast<std::uint32_t>(ip - 2);
+      }
+    }
+  }
+
+  pos = PutSequence(pos, outputEnd, input + anchor, size - anchor, 0, 0);
+  if (pos == NULL)
+  {
+    return 0;
+  }
+  return pos - output;
+}
+
+std::size_t TBlockCodec::Decompress(const char* source, std::size_t size,
+  char* destination, std::size_t capacity)
+{
+  const unsigned char* pos = reinterpret_cast<const unsigned char*>(source);
+  const unsigned char* end = pos + size;
+  unsigned char* output = reinterpret_cast<unsigned char*>(destination);
+  unsigned char* out = output;
+  unsigned char* outEnd = output + capacity;
+
+  for (;;)
+  {
+    if (pos == end)
+    {
+      ThrowCorrupted("sequence is truncated");
+    }
+    unsigned char token = *pos++;
+    std::size_t literalCount = token >> 4;
+    if ((literalCount < 15) && (end - pos >= 16) && (outEnd - out >= 16))
+    {
+      /* Short literals are copied by one fixed-size copy */
+      std::memcpy(out, pos, 16);
+    }
+    else
+    {
+      literalCount = GetLength(pos, end, literalCount);
+      if ((literalCount > static_cast<std::size_t>(end - pos)) ||
+        (literalCount > static_cast<std::size_t>(outEnd - out)))
+      {
+        ThrowCorrupted("literals are out of range");
+      }
+      if (literalCount > 0)
+      {
+        std::memcpy(out, pos, literalCount);
+      }
+    }
+    pos += literalCount;
+    out += literalCount;
+    if (pos == end)
+    {
+      /* Last sequence has literals only */
+      break;
+    }
+
+    if (end - pos < 2)
+    {
+      ThrowCorrupted("offset is truncated");
+    }
+    std::size_t offset = pos[0] | (static_cast<std::size_t>(pos[1]) << 8);
+    pos += 2;
+    std::size_t length = token & 0x0F;
+    if (length == 15)
+    {
+      length = GetLength(pos, end, length);
+    }
+    length += MinMatch;
+    if ((offset == 0) || (offset > static_cast<std::size_t>(out - output)))
+    {
+      ThrowCorrupted("offset is out of range");
+    }
+    if (length > static_cast<std::size_t>(outEnd - out))
+    {
+      ThrowCorrupted("match is out of range");
+    }
+
+    const unsigned char* match = out - offset;
+    if ((offset >= 8) && (static_cast<std::size_t>(outEnd - out) >=
+      length + 8))
+    {
+      /* Eight-byte chunks never overlap with offset of eight or more,
+         the last chunk may write past the match */
+      unsigned char* matchEnd = out + length;
+      do
+      {
+        std::memcpy(out, match, 8);
+        out += 8;
+        match += 8;
+      }
+      while (out < matchEnd);
+      out = matchEnd;
+      continue;
+    }
+    while (length > 0)
+    {
+      *out++ = *match++;
+      --length;
+    }
+  }
+  return out - output;
+}
+
+
+TCompressionSelector::TCompressionSelector(double maxRatio,
+  std::size_t sampleInterval) :
+  maxRatio(maxRatio), sampleInterval(std::max<std::size_t>(sampleInterval, 1)),
+  estimatedRatio(0), blocksSinceSample(this->sampleInterval), scratch()
+{
+}
+
+bool TCompressionSelector::ShouldCompress(const char* data, std::size_t size)
+{
+  if (blocksSinceSample >= sampleInterval)
+  {
+    estimatedRatio = Sample(data, size);
+    blocksSinceSample = 0;
+  }
+  ++blocksSinceSample;
+  return estimatedRatio <= maxRatio;
+}
+
+void TCompressionSelector::Report(std::size_t size,
+  std::size_t compressedSize)
+{
+  if (size == 0)
+  {
+    return;
+  }
+  /* Whole block is a better estimate than the samples */
+  estimatedRatio = (compressedSize == 0) ? 1 :
+    static_cast<double>(compressedSize) / size;
+}
+
+bool TCompressionSelector::IsWorthwhile(std::size_t size,
+  std::size_t compressedSize) const
+{
+  return (compressedSize > 0) && (compressedSize <= size * maxRatio);
+}
+
+double TCompressionSelector::EstimatedRatio() const
+{
+  return estimatedRatio;
+}
+
+double TCompressionSelector::Sample(const char* data, std::size_t size)
+{
+  if (size == 0)
+  {
+    return 1;
+  }
+  std::size_t sampleSize = std::min(size, SampleSize);
+  std::size_t count = (size >= SampleCount * SampleSize) ? SampleCount : 1;
+  scratch.resize(TBlockCodec::MaxCompressedSize(sampleSize));
+
+  /* Samples are taken from the start, the middle and the end */
+  std::size_t sourceSize = 0;
+  std::size_t compressedSize = 0;
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::size_t offset = (count == 1) ? 0 :
+      i * ((size - sampleSize) / (count - 1));
+    std::size_t result = TBlockCodec::Compress(data + offset, sampleSize,
+      &scratch[0], scratch.size());
+    sourceSize += sampleSize;
+    compressedSize += (result == 0) ? sampleSize : result;
+  }
+  return static_cast<double>(compressedSize) / sourceSize;
+}
+
+} // namespace wrp
@@ -0,0 +1,272 @@
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+#include "channel_credit.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+/* Credit word: message count in the upper bits, byte size in the lower */
+const unsigned int CountShift = 40;
+const std::uint64_t SizeMask = (std::uint64_t(1) << CountShift) - 1;
+const std::uint64_t MaxCount = (std::uint64_t(1) << (64 - CountShift)) - 1;
+const std::uint64_t OneMessage = std::uint64_t(1) << CountShift;
+
+} // namespace
+
+
+const std::size_t TChannelBudget::DefaultMaxSize;
+const std::size_t TChannelBudget::DefaultMaxCount;
+
+TChannelBudget::TChannelBudget(std::size_t maxSize, std::size_t maxCount) :
+  maxSize(maxSize), maxCount(maxCount)
+{
+}
+
+
+const std::size_t TChannelCreditTable::ChannelNotFound;
+
+bool TChannelCreditTable::TChannelKey::operator<(
+  const TChannelKey& other) const
+{
+  if (source != other.source)
+  {
+    return source < other.source;
+  }
+  if (receiver != other.receiver)
+  {
+    return receiver < other.receiver;
+  }
+  return nameId < other.nameId;
+}
+
+TChannelCreditTable::TChannel::TChannel() :
+  used(0), waiterCount(0), waitCount(0), budget(), mutex(), released()
+{
+}
+
+TChannelCreditTable::TChannelCreditTable(const TWorkflowModel& model,
+  const TChannelBudget& budget) :
+  channels(), outputKeys(), inputKeys(), stopped(false)
+{
+  for (std::size_t i = 0; i < model.Size(); ++i)
+  {
+    const std::vector<TOutputBatchInfo>& outputBatches =
+      model.cold[i].outputBatches;
+    for (std::size_t j = 0; j < outputBatches.size(); ++j)
+    {
+      const std::vector<TOutputBatchInfo::TOutputMessageChannelInfo>&
+        outputChannels = outputBatches[j].channels;
+      for (std::size_t k = 0; k < outputChannels.size(); ++k)
+      {
+        TChannelKey outputKey = { model.ids[i].workflowId,
+          outputChannels[k].receiver, outputChannels[k].nameId,
+          outputKeys.size() };
+        TChannelKey inputKey = outputKey;
+        inputKey.nameId = outputChannels[k].convertedNameId;
+        outputKeys.push_back(outputKey);
+        inputKeys.push_back(inputKey);
+      }
+    }
+  }
+
+  /* Equal channels of different output batches share the credit */
+  std::vector<TChannelKey> sortedKeys(outputKeys);
+  std::stable_sort(sortedKeys.begin(), sortedKeys.end());
+  std::vector<std::size_t> channelOfKey(outputKeys.size(), 0);
+  for (std::size_t i = 0; i < sortedKeys.size(); ++i)
+  {
+    if ((i == 0) || (sortedKeys[i - 1] < sortedKeys[i]))
+    {
+      channels.push_back(std::unique_ptr<TChannel>(new TChannel()));
+    }
+    channelOfKey[sortedKeys[i].channel] = channels.size() - 1;
+  }
+  for (std::size_t i = 0; i < outputKeys.size(); ++i)
+  {
+    outputKeys[i].channel = channelOfKey[i];
+    inputKeys[i].channel = channelOfKey[i];
+  }
+  std::sort(outputKeys.begin(), outputKeys.end());
+  std::sort(inputKeys.begin(), inputKeys.end());
+
+  for (std::size_t i = 0; i < channels.size(); ++i)
+  {
+    SetBudget(i, budget);
+  }
+}
+
+TChannelCreditTable::~TChannelCreditTable()
+{
+}
+
+std::size_t TChannelCreditTable::FindOutput(TModuleId::TWorkflowId source,
+  TModuleId::TWorkflowId receiver, TSymbolId nameId) const
+{
+  TChannelKey key = { source, receiver, nameId, ChannelNotFound };
+  return Find(outputKeys, key);
+}
+
+std::size_t TChannelCreditTable::FindInput(TModuleId::TWorkflowId source,
+  TModuleId::TWorkflowId receiver, TSymbolId channelId) const
+{
+  TChannelKey key = { source, receiver, channelId, ChannelNotFound };
+  return Find(inputKeys, key);
+}
+
+void TChannelCreditTable::SetBudget(std::size_t channel,
+  const TChannelBudget& budget)
+{
+  if ((budget.maxSize == 0) || (budget.maxSize > SizeMask) ||
+    (budget.maxCount == 0) || (budget.maxCount > MaxCount))
+  {
+    std::stringstream info;
+    info << "Incorrect channel budget. Max size: " << budget.maxSize <<
+      ", max count: " << budget.maxCount << ".";
+    throw std::runtime_error(info.str());
+  }
+  Channel(channel).budget = budget;
+}
+
+const TChannelBudget& TChannelCreditTable::Budget(std::size_t channel) const
+{
+  return Channel(channel).budget;
+}
+
+bool TChannelCreditTable::TryAcquire(std::size_t channel, std::size_t size)
+{
+  TChannel& info = Channel(channel);
+  std::uint64_t cost = std::min(size, info.budget.maxSize);
+  std::uint64_t used = info.used.load(std::memory_order_relaxed);
+  do
+  {
+    if (((used >> CountShift) >= info.budget.maxCount) ||
+      ((used & SizeMask) + cost > info.budget.maxSize))
+    {
+      return false;
+    }
+  }
+  while (!info.used.compare_exchange_weak(used, used + OneMessage + cost,
+    std::memory_order_acquire, std::memory_order_relaxed));
+  return true;
+}
+
+bool TChannelCreditTable::Acquire(std::size_t channel, std::size_t size)
+{
+  if (TryAcquire(channel, size))
+  {
+    return true;
+  }
+
+  TChannel& info = Channel(channel);
+  std::unique_lock<std::mutex> lock(info.mutex);
+  info.waitCount.fetch_add(1, std::memory_order_relaxed);
+  info.waiterCount.fetch_add(1, std::memory_order_relaxed);
+  /* Either Release sees the waiter or the waiter sees the released
+     credit */
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  bool acquired = false;
+  for (;;)
+  {
+    acquired = TryAcquire(channel, size);
+    if (acquired || stopped.load(std::memory_order_acquire))
+    {
+      break;
+    }
+    info.released.wait(lock);
+  }
+  info.waiterCount.fetch_sub(1, std::memory_order_relaxed);
+  return acquired;
+}
+
+void TChannelCreditTable::Release(std::size_t channel, std::size_t size)
+{
+  TChannel& info = Channel(channel);
+  std::uint64_t cost = std::min(size, info.budget.maxSize);
+  info.used.fetch_sub(OneMessage + cost);
+  if (info.waiterCount.load() != 0)
+  {
+    std::lock_guard<std::mutex> lock(info.mutex);
+    info.released.notify_all();
+  }
+}
+
+void TChannelCreditTable::Shutdown()
+{
+  stopped.store(true, std::memory_order_release);
+  for (std::size_t i = 0; i < channels.size(); ++i)
+  {
+    std::lock_guard<std::mutex> lock(channels[i]->mutex);
+    channels[i]->released.notify_all();
+  }
+}
+
+std::size_t TChannelCreditTable::MessageSize(const TDataMessage& message)
+{
+  std::size_t size = 0;
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    size += message.entrances[i].fragmentSize;
+  }
+  return size;
+}
+
+std::size_t TChannelCreditTable::ChannelCount() const
+{
+  return channels.size();
+}
+
+std::size_t TChannelCreditTable::InFlightSize(std::size_t channel) const
+{
+  return static_cast<std::size_t>(
+    Channel(channel).used.load(std::memory_order_relaxed) & SizeMask);
+}
+
+std::size_t TChannelCreditTable::InFlightCount(std::size_t channel) const
+{
+  return static_cast<std::size_t>(
+    Channel(channel).used.load(std::memory_order_relaxed) >> CountShift);
+}
+
+std::size_t TChannelCreditTable::WaitCount(std::size_t channel) const
+{
+  return Channel(channel).waitCount.load(std::memory_order_relaxed);
+}
+
+TChannelCreditTable::TChannel& TChannelCreditTable::Channel(
+  std::size_t channel) const
+{
+  if (channel >= channels.size())
+  {
+    std::stringstream info;
+    info << "Channel with '" << channel << "' index doesn't exist.";
+    throw std::runtime_error(info.str());
+  }
+  return *channels[channel];
+}
+
+std::size_t TChannelCreditTable::Find(const std::vector<TChannelKey>& keys,
+  const TChannelKey& key)
+{
+  std::vector<TChannelKey>::const_iterator found =
+    std::lower_bound(keys.begin(), keys.end(), key);
+  if ((found == keys.end()) || (key < *found))
+  {
+    return ChannelNotFound;
+  }
+  return found->channel;
+}
+
+} // namespace wrp
@@ -0,0 +1,217 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "collector_join_table.h"
+
+
+namespace wrp
+{
+
+const std::size_t TCollectorJoinTable::DefaultShardCount;
+const std::size_t TCollectorJoinTable::DefaultCompletedCapacity;
+
+TCollectorJoinTable::TPendingBatch::TPendingBatch() :
+  messages(), arrived(), arrivedCount(0), created(), agePosition()
+{
+}
+
+TCollectorJoinTable::TCollectorJoinTable(const TInputBatchInfo& inputBatch,
+  std::size_t maxPendingCount, std::size_t shardCount,
+  std::size_t completedCapacity) :
+  distributor(inputBatch.source),
+  sourceChannelIds(inputBatch.sourceChannelIds),
+  maxPendingCountPerShard(0),
+  completedCapacityPerShard(0),
+  shards(),
+  pendingCount(0),
+  evictedCount(0)
+{
+  if (inputBatch.type != EInputBatchType::Collector)
+  {
+    std::stringstream info;
+    info << "Join table can be created only for input batch with " <<
+      "collector type. Current type: " << inputBatch.type;
+    throw std::runtime_error(info.str());
+  }
+  if (sourceChannelIds.empty())
+  {
+    std::stringstream info;
+    info << "Input batch with collector type must have source channels.";
+    throw std::runtime_error(info.str());
+  }
+  if ((shardCount == 0) || (maxPendingCount < shardCount))
+  {
+    std::stringstream info;
+    info << "Incorrect size of join table. Max pending count: " <<
+      maxPendingCount << ", shard count: " << shardCount << ".";
+    throw std::runtime_error(info.str());
+  }
+
+  maxPendingCountPerShard = maxPendingCount / shardCount;
+  completedCapacityPerShard = (completedCapacity + shardCount - 1) /
+    shardCount;
+  shards.reserve(shardCount);
+  for (std::size_t i = 0; i < shardCount; ++i)
+  {
+    shards.push_back(std::unique_ptr<TShard>(new TShard()));
+  }
+}
+
+ECollectorJoinStatus::Type TCollectorJoinTable::Add(TDataMessage&& message,
+  TSymbolId sourceChannelId, TCollectedBatch& batch)
+{
+  std::size_t channelIndex = 0;
+  while ((channelIndex < sourceChannelIds.size()) &&
+    (sourceChannelIds[channelIndex] != sourceChannelId))
+  {
+    ++channelIndex;
+  }
+  if (channelIndex == sourceChannelIds.size())
+  {
+    std::stringstream info;
+    info << "Source channel with '" << sourceChannelId << "' symbol id " <<
+      "doesn't belong to input batch with collector type.";
+    throw std::runtime_error(info.str());
+  }
+
+  /* Key is computed before locking */
+  TDataMessageTokens distributorId = FindDistributorId(message.id);
+  std::uint64_t hash = distributorId.Hash();
+  TShard& shard = *shards[(hash >> 32) % shards.size()];
+
+  std::lock_guard<std::mutex> lock(shard.mutex);
+  TPendingBatches::iterator it = shard.pendingBatches.find(distributorId);
+  if (it == shard.pendingBatches.end())
+  {
+    /* Late copy of an already collected set */
+    if (shard.completedKeys.find(distributorId) != shard.completedKeys.end())
+    {
+      return ECollectorJoinStatus::Duplicate;
+    }
+    while (shard.pendingBatches.size() >= maxPendingCountPerShard)
+    {
+      Erase(shard, shard.pendingBatches.find(*shard.ageOrder.front()));
+      ++evictedCount;
+    }
+    it = shard.pendingBatches.insert(
+      std::make_pair(distributorId, TPendingBatch())).first;
+    TPendingBatch& pendingBatch = it->second;
+    pendingBatch.messages.resize(sourceChannelIds.size(),
+      TDataMessage(EMessageType::_undefined));
+    pendingBatch.arrived.resize(sourceChannelIds.size(), false);
+    pendingBatch.created = TClock::now();
+    pendingBatch.agePosition =
+      shard.ageOrder.insert(shard.ageOrder.end(), &it->first);
+    ++pendingCount;
+  }
+
+  TPendingBatch& pendingBatch = it->second;
+  if (pendingBatch.arrived[channelIndex])
+  {
+    return ECollectorJoinStatus::Duplicate;
+  }
+  pendingBatch.messages[channelIndex] = std::move(message);
+  pendingBatch.arrived[channelIndex] = true;
+  ++pendingBatch.arrivedCount;
+  if (pendingBatch.arrivedCount < sourceChannelIds.size())
+  {
+    return ECollectorJoinStatus::Pending;
+  }
+
+  batch.distributorId = it->first;
+  batch.messages = std::move(pendingBatch.messages);
+  Remember(shard, it->first);
+  Erase(shard, it);
+  return ECollectorJoinStatus::Completed;
+}
+
+std::size_t TCollectorJoinTable::EvictOlderThan(const TClock::time_point& time)
+{
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < shards.size(); ++i)
+  {
+    TShard& shard = *shards[i];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    while (!shard.ageOrder.empty())
+    {
+      TPendingBatches::iterator it =
+        shard.pendingBatches.find(*shard.ageOrder.front());
+      if (!(it->second.created < time))
+      {
+        break;
+      }
+      Erase(shard, it);
+      ++count;
+    }
+  }
+  evictedCount += count;
+  return count;
+}
+
+std::size_t TCollectorJoinTable::PendingCount() const
+{
+  return pendingCount;
+}
+
+std::size_t TCollectorJoinTable::EvictedCount() const
+{
+  return evictedCount;
+}
+
+TDataMessageTokens TCollectorJoinTable::FindDistributorId(
+  const TDataMessageTokens& id) const
+{
+  if (id.lastModuleToken.source.workflowId == distributor)
+  {
+    return id;
+  }
+  TTokenPath path = id.tokens;
+  while (!path.Empty() && (path.Back().source.workflowId != distributor))
+  {
+    path = path.Parent();
+  }
+  if (path.Empty())
+  {
+    std::stringstream info;
+    info << "Message didn't pass through distributor with '" <<
+      distributor << "' workflow id.";
+    throw std::runtime_error(info.str());
+  }
+  TDataMessageTokens distributorId;
+  distributorId.lastModuleToken = path.Back();
+  distributorId.tokens = path.Parent();
+  return distributorId;
+}
+
+void TCollectorJoinTable::Erase(TShard& shard, TPendingBatches::iterator it)
+{
+  shard.ageOrder.erase(it->second.agePosition);
+  shard.pendingBatches.erase(it);
+  --pendingCount;
+}
+
+void TCollectorJoinTable::Remember(TShard& shard,
+  const TDataMessageTokens& key)
+{
+  if (completedCapacityPerShard == 0)
+  {
+    return;
+  }
+  if (shard.completedKeys.size() == completedCapacityPerShard)
+  {
+    shard.completedKeys.erase(*shard.completedOrder.front());
+    shard.completedOrder.pop_front();
+  }
+  shard.completedOrder.push_back(&*shard.completedKeys.insert(key).first);
+}
+
+} // namespace wrp
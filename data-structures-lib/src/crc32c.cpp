@@ -0,0 +1,337 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <nmmintrin.h>
+#define WRP_CRC32C_X86
+#elif defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#include <arm_acle.h>
+#include <sys/auxv.h>
+#define WRP_CRC32C_ARM
+#endif
+
+#include "crc32c.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+/* Reflected Castagnoli polynomial */
+const std::uint32_t Polynomial = 0x82F63B78;
+
+/* Sizes up to 2^64 bytes, that is 2^67 bits */
+const unsigned int PowerCount = 67;
+
+/* Hardware path computes three streams of this size in parallel */
+const std::size_t LongBlockSize = 8192;
+const std::size_t ShortBlockSize = 256;
+
+/* Multiplies a and b modulo the polynomial (reflected bit order) */
+std::uint32_t MultiplyModP(std::uint32_t a, std::uint32_t b)
+{
+  std::uint32_t mask = std::uint32_t(1) << 31;
+  std::uint32_t product = 0;
+  for (;;)
+  {
+    if ((a & mask) != 0)
+    {
+      product ^= b;
+      if ((a & (mask - 1)) == 0)
+      {
+        break;
+      }
+    }
+    mask >>= 1;
+    b = ((b & 1) != 0) ? (b >> 1) ^ Polynomial : b >> 1;
+  }
+  return product;
+}
+
+/** Lookup tables, built once on first use.
+ *
+ */
+struct TTables
+{
+  /* Slice-by-8 tables */
+  std::uint32_t bytes[8][256];
+
+  /* x^(2^n) modulo the polynomial */
+  std::uint32_t powers[PowerCount];
+
+  /* Operators appending LongBlockSize and ShortBlockSize zero bytes */
+  std::uint32_t longShift[4][256];
+  std::uint32_t shortShift[4][256];
+
+  TTables();
+
+  /* x^(8 * size) modulo the polynomial */
+  std::uint32_t ZeroBytesOperator(std::uint64_t size) const;
+
+  void FillShift(std::uint32_t shift[4][256], std::size_t size) const;
+};
+
+TTables::TTables()
+{
+  for (std::uint32_t i = 0; i < 256; ++i)
+  {
+    std::uint32_t crc = i;
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = ((crc & 1) != 0) ? (crc >> 1) ^ Polynomial : crc >> 1;
+    }
+    bytes[0][i] = crc;
+  }
+  for (std::uint32_t i = 0; i < 256; ++i)
+  {
+    for (int k = 1; k < 8; ++k)
+    {
+      bytes[k][i] = (bytes[k - 1][i] >> 8) ^
+        bytes[0][bytes[k - 1][i] & 0xFF];
+    }
+  }
+
+  powers[0] = std::uint32_t(1) << 30; /* x^1 */
+  for (unsigned int n = 1; n < PowerCount; ++n)
+  {
+    powers[n] = MultiplyModP(powers[n - 1], powers[n - 1]);
+  }
+
+  FillShift(longShift, LongBlockSize);
+  FillShift(shortShift, ShortBlockSize);
+}
+
+std::uint32_t TTables::ZeroBytesOperator(std::uint64_t size) const
+{
+  std::uint32_t result = std::uint32_t(1) << 31; /* x^0 */
+  std::uint64_t bits = size;
+  for (unsigned int n = 3; bits != 0; bits >>= 1, ++n)
+  {
+    if ((bits & 1) != 0)
+    {
+      result = MultiplyModP(powers[n], result);
+    }
+  }
+  return result;
+}
+
+void TTables::FillShift(std::uint32_t shift[4][256], std::size_t size) const
+{
+  std::uint32_t op = ZeroBytesOperator(size);
+  for (std::uint32_t i = 0; i < 256; ++i)
+  {
+    for (int k = 0; k < 4; ++k)
+    {
+      shift[k][i] = MultiplyModP(op, i << (8 * k));
+    }
+  }
+}
+
+const TTables& Tables()
+{
+  static const TTables tables;
+  return tables;
+}
+
+/* Crc state is not inverted here: Compute() does the pre- and
+   post-conditioning */
+typedef std::uint32_t (*TExtend)(std::uint32_t crc,
+  const unsigned char* data, std::size_t size);
+
+std::uint32_t ExtendSoftware(std::uint32_t crc, const unsigned char* data,
+  std::size_t size)
+{
+  const TTables& tables = Tables();
+  while ((size > 0) && ((reinterpret_cast<std::uintptr_t>(data) & 7) != 0))
+  {
+    crc = (crc >> 8) ^ tables.bytes[0][(crc ^ *data++) & 0xFF];
+    --size;
+  }
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+  /* Word loads below assume little-endian order */
+#else
+  while (size >= 8)
+  {
+    std::uint64_t word;
+    std::memcpy(&word, data, sizeof(word));
+    word ^= crc;
+    crc = tables.bytes[7][word & 0xFF] ^
+      tables.bytes[6][(word >> 8) & 0xFF] ^
+      tables.bytes[5][(word >> 16) & 0xFF] ^
+      tables.bytes[4][(word >> 24) & 0xFF] ^
+      tables.bytes[3][(word >> 32) & 0xFF] ^
+      tables.bytes[2][(word >> 40) & 0xFF] ^
+      tables.bytes[1][(word >> 48) & 0xFF] ^
+      tables.bytes[0][word >> 56];
+    data += 8;
+    size -= 8;
+  }
+#endif
+  while (size > 0)
+  {
+    crc = (crc >> 8) ^ tables.bytes[0][(crc ^ *data++) & 0xFF];
+    --size;
+  }
+  return crc;
+}
+
+inline std::uint32_t Shift(const std::uint32_t shift[4][256],
+  std::uint32_t crc)
+{
+  return shift[0][crc & 0xFF] ^ shift[1][(crc >> 8) & 0xFF] ^
+    shift[2][(crc >> 16) & 0xFF] ^ shift[3][crc >> 24];
+}
+
+#if defined(WRP_CRC32C_X86) || defined(WRP_CRC32C_ARM)
+inline std::uint64_t Load64(const unsigned char* data)
+{
+  std::uint64_t word;
+  std::memcpy(&word, data, sizeof(word));
+  return word;
+}
+#endif
+
+#if defined(WRP_CRC32C_X86)
+#if defined(__x86_64__)
+#define WRP_CRC32C_WORD(crc, data) \
+  static_cast<std::uint32_t>(_mm_crc32_u64((crc), Load64(data)))
+#define WRP_CRC32C_WORD_SIZE 8
+#else
+#define WRP_CRC32C_WORD(crc, data) \
+  _mm_crc32_u32((crc), static_cast<std::uint32_t>(Load64(data)))
+#define WRP_CRC32C_WORD_SIZE 4
+#endif
+#define WRP_CRC32C_BYTE(crc, byte) _mm_crc32_u8((crc), (byte))
+#define WRP_CRC32C_TARGET __attribute__((target("sse4.2")))
+#elif defined(WRP_CRC32C_ARM)
+#define WRP_CRC32C_WORD(crc, data) __crc32cd((crc), Load64(data))
+#define WRP_CRC32C_WORD_SIZE 8
+#define WRP_CRC32C_BYTE(crc, byte) __crc32cb((crc), (byte))
+#define WRP_CRC32C_TARGET __attribute__((target("arch=armv8-a+crc")))
+#endif
+
+#if defined(WRP_CRC32C_TARGET)
+/* Crc instruction has a latency of about three cycles and a throughput
+   of one per cycle, so three independent streams are computed at once
+   and joined with the shift tables */
+WRP_CRC32C_TARGET
+std::uint32_t ExtendHardware(std::uint32_t crc, const unsigned char* data,
+  std::size_t size)
+{
+  const TTables& tables = Tables();
+  while ((size > 0) && ((reinterpret_cast<std::uintptr_t>(data) & 7) != 0))
+  {
+    crc = WRP_CRC32C_BYTE(crc, *data++);
+    --size;
+  }
+
+  while (size >= 3 * LongBlockSize)
+  {
+    std::uint32_t crc1 = 0;
+    std::uint32_t crc2 = 0;
+    const unsigned char* end = data + LongBlockSize;
+    do
+    {
+      crc = WRP_CRC32C_WORD(crc, data);
+      crc1 = WRP_CRC32C_WORD(crc1, data + LongBlockSize);
+      crc2 = WRP_CRC32C_WORD(crc2, data + 2 * LongBlockSize);
+      data += WRP_CRC32C_WORD_SIZE;
+    }
+    while (data < end);
+    crc = Shift(tables.longShift, crc) ^ crc1;
+    crc = Shift(tables.longShift, crc) ^ crc2;
+    data += 2 * LongBlockSize;
+    size -= 3 * LongBlockSize;
+  }
+
+  while (size >= 3 * ShortBlockSize)
+  {
+    std::uint32_t crc1 = 0;
+    std::uint32_t crc2 = 0;
+    const unsigned char* end = data + ShortBlockSize;
+    do
+    {
+      crc = WRP_CRC32C_WORD(crc, data);
+      crc1 = WRP_CRC32C_WORD(crc1, data + ShortBlockSize);
+      crc2 = WRP_CRC32C_WORD(crc2, data + 2 * ShortBlockSize);
+      data += WRP_CRC32C_WORD_SIZE;
+    }
+    while (data < end);
+    crc = Shift(tables.shortShift, crc) ^ crc1;
+    crc = Shift(tables.shortShift, crc) ^ crc2;
+    data += 2 * ShortBlockSize;
+    size -= 3 * ShortBlockSize;
+  }
+
+  while (size >= WRP_CRC32C_WORD_SIZE)
+  {
+    crc = WRP_CRC32C_WORD(crc, data);
+    data += WRP_CRC32C_WORD_SIZE;
+    size -= WRP_CRC32C_WORD_SIZE;
+  }
+  while (size > 0)
+  {
+    crc = WRP_CRC32C_BYTE(crc, *data++);
+    --size;
+  }
+  return crc;
+}
+#endif
+
+bool HasCrcInstructions()
+{
+#if defined(WRP_CRC32C_X86)
+  return __builtin_cpu_supports("sse4.2");
+#elif defined(WRP_CRC32C_ARM)
+  /* HWCAP_CRC32 */
+  return (getauxval(AT_HWCAP) & (1UL << 7)) != 0;
+#else
+  return false;
+#endif
+}
+
+TExtend SelectExtend()
+{
+#if defined(WRP_CRC32C_TARGET)
+  if (HasCrcInstructions())
+  {
+    return ExtendHardware;
+  }
+#endif
+  return ExtendSoftware;
+}
+
+} // namespace
+
+
+std::uint32_t TCrc32c::Compute(const void* data, std::size_t size,
+  std::uint32_t crc)
+{
+  static const TExtend extend = SelectExtend();
+  return ~extend(~crc, static_cast<const unsigned char*>(data), size);
+}
+
+std::uint32_t TCrc32c::Combine(std::uint32_t first, std::uint32_t second,
+  std::uint64_t secondSize)
+{
+  /* Fragments of a message usually have equal sizes */
+  static thread_local std::uint64_t cachedSize = 0;
+  static thread_local std::uint32_t cachedOperator =
+    std::uint32_t(1) << 31;
+  if (secondSize != cachedSize)
+  {
+    cachedOperator = Tables().ZeroBytesOperator(secondSize);
+    cachedSize = secondSize;
+  }
+  return MultiplyModP(cachedOperator, first) ^ second;
+}
+
+bool TCrc32c::IsAccelerated()
+{
+  return SelectExtend() != ExtendSoftware;
+}
+
+} // namespace wrp
@@ -0,0 +1,369 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "crc32c.h"
+#include "data_message.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+const std::uint64_t EmptyTokensHash = 0x9E3779B97F4A7C15ULL;
+
+/* Finalizer of splitmix64 generator */
+std::uint64_t Mix(std::uint64_t value)
+{
+  value ^= value >> 30;
+  value *= 0xBF58476D1CE4E5B9ULL;
+  value ^= value >> 27;
+  value *= 0x94D049BB133111EBULL;
+  value ^= value >> 31;
+  return value;
+}
+
+std::uint64_t Combine(std::uint64_t hash, std::uint64_t value)
+{
+  return Mix(hash + EmptyTokensHash + value);
+}
+
+} // namespace
+
+TDataMessageEntranceInfo::TDataMessageEntranceInfo() :
+  startOffset(0), totalSize(0), fragmentSize(0), entranceId(), data(),
+  checksum(0), hasChecksum(false)
+{
+}
+
+void TDataMessageEntranceInfo::SetFragment(const TPayloadSlice& fragment)
+{
+  data = fragment;
+  fragmentSize = static_cast<TMessageDataSize>(fragment.Size());
+  hasChecksum = false;
+}
+
+void TDataMessageEntranceInfo::ComputeChecksum()
+{
+  checksum = TCrc32c::Compute(data.Data(), data.Size());
+  hasChecksum = true;
+}
+
+bool TDataMessageEntranceInfo::VerifyChecksum() const
+{
+  return !hasChecksum ||
+    (TCrc32c::Compute(data.Data(), data.Size()) == checksum);
+}
+
+
+TDataMessageToken::TDataMessageToken(const TModuleId& source,
+  const TBatchInstanceId& batchId) :
+  source(source), batchId(batchId), timestamp(0)
+{
+}
+
+bool TDataMessageToken::operator==(const TDataMessageToken& other) const
+{
+  return (source == other.source) && (batchId == other.batchId);
+}
+
+bool TDataMessageToken::operator!=(const TDataMessageToken& other) const
+{
+  return !operator == (other);
+}
+
+std::uint64_t TDataMessageToken::Hash() const
+{
+  std::uint64_t hash = Mix(source.workflowId);
+  hash = Combine(hash, source.instanceId);
+  return Combine(hash, batchId);
+}
+
+std::uint64_t TDataMessageToken::Now()
+{
+  /* Steady clock is CLOCK_MONOTONIC on Linux, common for all processes */
+  return static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+
+TTokenPath::TTokenPath() :
+  tail()
+{
+}
+
+TTokenPath::TTokenPath(const std::vector<TDataMessageToken>& tokens) :
+  tail()
+{
+  for (std::size_t i = 0; i < tokens.size(); ++i)
+  {
+    *this = Append(tokens[i]);
+  }
+}
+
+TTokenPath::TTokenPath(const std::shared_ptr<const TNode>& tail) :
+  tail(tail)
+{
+}
+
+TTokenPath::~TTokenPath()
+{
+  /* Releasing exclusively owned nodes one by one to avoid deep recursion
+   * of shared_ptr destructors on long paths
+   */
+  std::shared_ptr<const TNode> node = std::move(tail);
+  while (node && (node.use_count() == 1))
+  {
+    std::shared_ptr<const TNode> parent = node->parent;
+    node.reset();
+    node = std::move(parent);
+  }
+}
+
+TTokenPath& TTokenPath::operator=(TTokenPath other) noexcept
+{
+  tail.swap(other.tail);
+  return *this;
+}
+
+TTokenPath TTokenPath::Append(const TDataMessageToken& token) const
+{
+  std::shared_ptr<TNode> node = std::make_shared<TNode>();
+  node->token = token;
+  node->parent = tail;
+  node->depth = Size() + 1;
+  node->hash = Combine(Hash(), token.Hash());
+  return TTokenPath(node);
+}
+
+TTokenPath TTokenPath::Parent() const
+{
+  return tail ? TTokenPath(tail->parent) : TTokenPath();
+}
+
+TTokenPath TTokenPath::Prefix(std::size_t depth) const
+{
+  if (depth > Size())
+  {
+    std::stringstream info;
+    info << "Prefix with '" << depth << "' tokens is longer than token " <<
+      "path with '" << Size() << "' tokens.";
+    throw std::runtime_error(info.str());
+  }
+  std::shared_ptr<const TNode> node = tail;
+  while (node && (node->depth > depth))
+  {
+    node = node->parent;
+  }
+  return TTokenPath(node);
+}
+
+const TDataMessageToken& TTokenPath::Back() const
+{
+  if (!tail)
+  {
+    std::stringstream info;
+    info << "Token path is empty.";
+    throw std::runtime_error(info.str());
+  }
+  return tail->token;
+}
+
+std::size_t TTokenPath::Size() const
+{
+  return tail ? tail->depth : 0;
+}
+
+bool TTokenPath::Empty() const
+{
+  return !tail;
+}
+
+std::uint64_t TTokenPath::Hash() const
+{
+  return tail ? tail->hash : EmptyTokensHash;
+}
+
+TTokenPath::TReverseIterator TTokenPath::RBegin() const
+{
+  return TReverseIterator(tail.get());
+}
+
+TTokenPath::TReverseIterator TTokenPath::REnd() const
+{
+  return TReverseIterator(NULL);
+}
+
+std::vector<TDataMessageToken> TTokenPath::ToVector() const
+{
+  std::vector<TDataMessageToken> tokens(Size());
+  for (const TNode* node = tail.get(); node != NULL; node = node->parent.get())
+  {
+    tokens[node->depth - 1] = node->token;
+  }
+  return tokens;
+}
+
+const TTokenPath::TNode* TTokenPath::Ancestor(const TNode* node,
+  std::size_t depth)
+{
+  while ((node != NULL) && (node->depth > depth))
+  {
+    node = node->parent.get();
+  }
+  return node;
+}
+
+bool TTokenPath::Equal(const TNode* lhs, const TNode* rhs)
+{
+  /* Walking both chains until the shared part of the paths */
+  while (lhs != rhs)
+  {
+    if ((lhs->hash != rhs->hash) || (lhs->token != rhs->token))
+    {
+      return false;
+    }
+    lhs = lhs->parent.get();
+    rhs = rhs->parent.get();
+  }
+  return true;
+}
+
+bool TTokenPath::IsPrefixOf(const TTokenPath& other) const
+{
+  if (Size() > other.Size())
+  {
+    return false;
+  }
+  const TNode* node = Ancestor(other.tail.get(), Size());
+  if ((node != NULL ? node->hash : EmptyTokensHash) != Hash())
+  {
+    return false;
+  }
+  return Equal(tail.get(), node);
+}
+
+bool TTokenPath::operator==(const TTokenPath& other) const
+{
+  if ((Hash() != other.Hash()) || (Size() != other.Size()))
+  {
+    return false;
+  }
+  return Equal(tail.get(), other.tail.get());
+}
+
+bool TTokenPath::operator!=(const TTokenPath& other) const
+{
+  return !operator == (other);
+}
+
+
+TTokenPath::TReverseIterator::TReverseIterator(const TNode* node) :
+  node(node)
+{
+}
+
+const TDataMessageToken& TTokenPath::TReverseIterator::operator*() const
+{
+  return node->token;
+}
+
+const TDataMessageToken* TTokenPath::TReverseIterator::operator->() const
+{
+  return &node->token;
+}
+
+TTokenPath::TReverseIterator& TTokenPath::TReverseIterator::operator++()
+{
+  node = node->parent.get();
+  return *this;
+}
+
+bool TTokenPath::TReverseIterator::operator==(
+  const TReverseIterator& other) const
+{
+  return node == other.node;
+}
+
+bool TTokenPath::TReverseIterator::operator!=(
+  const TReverseIterator& other) const
+{
+  return node != other.node;
+}
+
+
+TDataMessageTokens::TDataMessageTokens() :
+  tokens(), lastModuleToken()
+{
+}
+
+void TDataMessageTokens::Append(const TDataMessageToken& token)
+{
+  tokens = tokens.Append(token);
+}
+
+void TDataMessageTokens::Forward(const TDataMessageToken& token)
+{
+  tokens = tokens.Append(lastModuleToken);
+  lastModuleToken = token;
+  if (lastModuleToken.timestamp == 0)
+  {
+    lastModuleToken.timestamp = TDataMessageToken::Now();
+  }
+}
+
+void TDataMessageTokens::Clear()
+{
+  tokens = TTokenPath();
+  lastModuleToken = TDataMessageToken();
+}
+
+std::uint64_t TDataMessageTokens::Hash() const
+{
+  return Combine(tokens.Hash(), lastModuleToken.Hash());
+}
+
+bool TDataMessageTokens::operator==(const TDataMessageTokens& other) const
+{
+  return (lastModuleToken == other.lastModuleToken) &&
+    (tokens == other.tokens);
+}
+
+bool TDataMessageTokens::operator!=(const TDataMessageTokens& other) const
+{
+  return !operator == (other);
+}
+
+
+TDataMessage::TDataMessage(EMessageType::Type type, const TModuleId& source,
+  const TModuleId& destination) :
+  TMessage(type, source, destination),
+  id(), entrances()
+{
+}
+
+TDataMessage::~TDataMessage()
+{
+}
+
+
+TBatchSequence::TBatchSequence() :
+  firstId(BatchInstanceIdUndefined), lastId(BatchInstanceIdUndefined),
+  tokens(), sourceChannels()
+{
+}
+
+TBatchSequence::~TBatchSequence()
+{
+}
+
+} // namespace wrp
@@ -0,0 +1,178 @@
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "data_message_pool.h"
+
+
+namespace wrp
+{
+
+struct TDataMessageReturnQueue
+{
+  std::thread::id ownerThread;
+
+  /* Reset to NULL when the pool is destroyed */
+  TDataMessagePool* owner;
+
+  std::mutex mutex;
+  std::vector<TDataMessage*> messages;
+  std::size_t maxCount;
+  std::atomic<std::size_t> count;
+};
+
+namespace
+{
+
+/* Clears contents while keeping capacity of vectors and strings */
+void ClearMessage(TDataMessage* message)
+{
+  message->id.Clear();
+  for (std::size_t i = 0; i < message->entrances.size(); ++i)
+  {
+    TDataMessageEntranceInfo& entrance = message->entrances[i];
+    entrance.startOffset = 0;
+    entrance.totalSize = 0;
+    entrance.fragmentSize = 0;
+    entrance.entranceId.clear();
+    entrance.data = TPayloadSlice();
+    entrance.checksum = 0;
+    entrance.hasChecksum = false;
+  }
+}
+
+} // namespace
+
+
+void TDataMessageRecycler::operator()(TDataMessage* message) const
+{
+  if (!queue)
+  {
+    delete message;
+    return;
+  }
+  /* Only the owner thread changes owner, so it reads it without a lock */
+  if ((std::this_thread::get_id() == queue->ownerThread) &&
+    (queue->owner != NULL))
+  {
+    queue->owner->Release(message);
+    return;
+  }
+
+  ClearMessage(message);
+  std::lock_guard<std::mutex> lock(queue->mutex);
+  if ((queue->owner == NULL) ||
+    (queue->messages.size() >= queue->maxCount))
+  {
+    delete message;
+    return;
+  }
+  queue->messages.push_back(message);
+  queue->count.store(queue->messages.size(), std::memory_order_relaxed);
+}
+
+const std::size_t TDataMessagePool::DefaultMaxCachedCount;
+
+TDataMessagePool::TDataMessagePool(std::size_t maxCachedCount) :
+  freeMessages(), returnQueue(new TDataMessageReturnQueue()),
+  maxCachedCount(maxCachedCount), allocatedCount(0), reusedCount(0)
+{
+  freeMessages.reserve(maxCachedCount);
+  returnQueue->ownerThread = std::this_thread::get_id();
+  returnQueue->owner = this;
+  returnQueue->messages.reserve(maxCachedCount);
+  returnQueue->maxCount = maxCachedCount;
+  returnQueue->count.store(0, std::memory_order_relaxed);
+}
+
+TDataMessagePool::~TDataMessagePool()
+{
+  for (std::size_t i = 0; i < freeMessages.size(); ++i)
+  {
+    delete freeMessages[i];
+  }
+
+  /* Messages released later are deleted by their recyclers */
+  std::lock_guard<std::mutex> lock(returnQueue->mutex);
+  returnQueue->owner = NULL;
+  for (std::size_t i = 0; i < returnQueue->messages.size(); ++i)
+  {
+    delete returnQueue->messages[i];
+  }
+  returnQueue->messages.clear();
+}
+
+TDataMessagePool& TDataMessagePool::Local()
+{
+  static thread_local TDataMessagePool pool;
+  return pool;
+}
+
+TDataMessagePtr TDataMessagePool::Acquire(EMessageType::Type type,
+  const TModuleId& source, const TModuleId& destination,
+  std::size_t entranceCount)
+{
+  if (freeMessages.empty() &&
+    (returnQueue->count.load(std::memory_order_relaxed) > 0))
+  {
+    /* Both vectors keep their capacity, so swapping does not allocate */
+    std::lock_guard<std::mutex> lock(returnQueue->mutex);
+    freeMessages.swap(returnQueue->messages);
+    returnQueue->count.store(0, std::memory_order_relaxed);
+  }
+
+  TDataMessage* message = NULL;
+  if (freeMessages.empty())
+  {
+    message = new TDataMessage(type, source, destination);
+    ++allocatedCount;
+  }
+  else
+  {
+    message = freeMessages.back();
+    freeMessages.pop_back();
+    message->type = type;
+    message->source = source;
+    message->destination = destination;
+    ++reusedCount;
+  }
+  message->entrances.resize(entranceCount);
+  TDataMessageRecycler recycler;
+  recycler.queue = returnQueue;
+  return TDataMessagePtr(message, recycler);
+}
+
+void TDataMessagePool::Release(TDataMessage* message)
+{
+  if (message == NULL)
+  {
+    return;
+  }
+  if (freeMessages.size() >= maxCachedCount)
+  {
+    delete message;
+    return;
+  }
+  ClearMessage(message);
+  freeMessages.push_back(message);
+}
+
+std::size_t TDataMessagePool::CachedCount() const
+{
+  return freeMessages.size();
+}
+
+std::size_t TDataMessagePool::AllocatedCount() const
+{
+  return allocatedCount;
+}
+
+std::size_t TDataMessagePool::ReusedCount() const
+{
+  return reusedCount;
+}
+
+} // namespace wrp
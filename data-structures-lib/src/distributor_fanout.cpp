@@ -0,0 +1,92 @@
+#include <cstddef>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "distributor_fanout.h"
+
+
+namespace wrp
+{
+
+TDistributorFanOut::TDistributorFanOut(const TOutputBatchInfo& outputBatch,
+  const TModuleId& source, const TSymbolTable& symbols) :
+  source(source), routes()
+{
+  if (outputBatch.type != EOutputBatchType::Distributor)
+  {
+    std::stringstream info;
+    info << "Fan-out can be created only for output batch with " <<
+      "distributor type. Current type: " << outputBatch.type;
+    throw std::runtime_error(info.str());
+  }
+  if (outputBatch.channels.empty())
+  {
+    std::stringstream info;
+    info << "Output batch with distributor type must have channels.";
+    throw std::runtime_error(info.str());
+  }
+
+  routes.resize(outputBatch.channels.size());
+  for (std::size_t i = 0; i < outputBatch.channels.size(); ++i)
+  {
+    const TOutputBatchInfo::TOutputMessageChannelInfo& channel =
+      outputBatch.channels[i];
+    routes[i].receiver = TModuleId(channel.receiver);
+    routes[i].name = symbols.GetString(channel.nameId);
+    routes[i].convertedName = symbols.GetString(channel.convertedNameId);
+    routes[i].nameId = channel.nameId;
+    routes[i].convertedNameId = channel.convertedNameId;
+  }
+}
+
+void TDistributorFanOut::Broadcast(const TDataMessage& message,
+  std::vector<TDataMessagePtr>& messages) const
+{
+  messages.clear();
+  messages.reserve(routes.size());
+  for (std::size_t i = 0; i < routes.size(); ++i)
+  {
+    messages.push_back(Route(message, i));
+  }
+}
+
+TDataMessagePtr TDistributorFanOut::Route(const TDataMessage& message,
+  std::size_t route) const
+{
+  const TRoute& info = routes.at(route);
+  TDataMessagePtr header = TDataMessagePool::Local().Acquire(
+    EMessageType::Data, source, info.receiver, message.entrances.size());
+
+  /* Token path is shared and slices only add a reference to the buffer */
+  header->id = message.id;
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    const TDataMessageEntranceInfo& entrance = message.entrances[i];
+    TDataMessageEntranceInfo& copy = header->entrances[i];
+    copy.startOffset = entrance.startOffset;
+    copy.totalSize = entrance.totalSize;
+    copy.fragmentSize = entrance.fragmentSize;
+    copy.data = entrance.data;
+    copy.checksum = entrance.checksum;
+    copy.hasChecksum = entrance.hasChecksum;
+    if (entrance.entranceId == info.name)
+    {
+      copy.entranceId.assign(info.convertedName);
+    }
+    else
+    {
+      copy.entranceId.assign(entrance.entranceId);
+    }
+  }
+  return header;
+}
+
+const std::vector<TDistributorFanOut::TRoute>&
+  TDistributorFanOut::Routes() const
+{
+  return routes;
+}
+
+} // namespace wrp
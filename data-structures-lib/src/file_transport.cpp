@@ -0,0 +1,1058 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <unistd.h>
+
+#if defined(__linux__)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif
+
+#include "file_transport.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+void ThrowSystemError(const char* call, int error)
+{
+  std::stringstream info;
+  info << "File transport: " << call << " failed: " << std::strerror(error) <<
+    ".";
+  throw std::runtime_error(info.str());
+}
+
+/* Synchronous file access */
+int OpenFile(const std::string& path, bool writing)
+{
+  return writing ?
+    open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644) :
+    open(path.c_str(), O_RDONLY | O_CLOEXEC);
+}
+
+int CloseFile(int fd)
+{
+  return close(fd);
+}
+
+bool GetFileSize(int fd, std::uint64_t& size)
+{
+  struct stat info;
+  if (fstat(fd, &info) < 0)
+  {
+    return false;
+  }
+  size = static_cast<std::uint64_t>(info.st_size);
+  return true;
+}
+
+std::int64_t ReadAt(int fd, char* data, std::size_t size,
+  std::uint64_t offset)
+{
+  return pread(fd, data, size, static_cast<off_t>(offset));
+}
+
+std::int64_t WriteAt(int fd, const char* data, std::size_t size,
+  std::uint64_t offset)
+{
+  return pwrite(fd, data, size, static_cast<off_t>(offset));
+}
+
+/* Layout of a compressed file: file header, then frames, each of them is
+   a frame header followed by stored (compressed or raw) data. Integers
+   are little-endian. */
+const std::uint32_t FileMagic = 0x5A505257; /* "WRPZ" */
+const std::uint32_t FileVersion = 1;
+
+/* Magic, version, data size, reserved */
+const std::size_t FileHeaderSize = 32;
+
+const std::uint32_t FrameMagic = 0x46505257; /* "WRPF" */
+const std::uint32_t FrameCompressed = 1 << 0;
+
+/* Magic, flags, data offset, data size, stored size */
+const std::size_t FrameHeaderSize = 24;
+
+void PutFixed(char* pos, std::uint64_t value, std::size_t size)
+{
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    pos[i] = static_cast<char>((value >> (8 * i)) & 0xFF);
+  }
+}
+
+std::uint64_t GetFixed(const char* pos, std::size_t size)
+{
+  std::uint64_t value = 0;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    value |= static_cast<std::uint64_t>(static_cast<unsigned char>(pos[i]))
+      << (8 * i);
+  }
+  return value;
+}
+
+void ThrowCorruptedFile(const char* reason)
+{
+  std::stringstream info;
+  info << "Corrupted compressed file: " << reason << ".";
+  throw std::runtime_error(info.str());
+}
+
+} // namespace
+
+
+/** Requests are kept in slots; a slot id is returned by Submit() and
+ *  released by Take(). Without io_uring (always off Linux) a request is
+ *  executed during Submit() and is completed immediately.
+ */
+class TFileIoQueue
+{
+public:
+  struct EOperation
+  {
+    enum Type
+    {
+      _undefined = 0,
+
+      Read,
+      Write
+    };
+  };
+
+  TFileIoQueue(std::size_t depth, bool useIoUring);
+  ~TFileIoQueue();
+
+  std::size_t Submit(EOperation::Type operation, int fd,
+    const TPayloadBufferPtr& buffer, char* data, std::size_t size,
+    std::uint64_t offset);
+
+  /* Waits for any completed request which is not taken yet */
+  std::size_t WaitAny();
+  void Wait(std::size_t id);
+
+  /* Releases the slot; returns transferred size or throws on error */
+  std::size_t Take(std::size_t id);
+
+  std::size_t InFlightCount() const;
+  std::size_t InFlightSize() const;
+  bool UsesIoUring() const;
+
+private:
+  struct TRequest
+  {
+    EOperation::Type operation;
+    int fd;
+    TPayloadBufferPtr buffer;
+    char* data;
+    std::size_t size;
+    std::uint64_t offset;
+    std::size_t done;
+    int error;
+    bool used;
+    bool completed;
+  };
+
+  std::vector<TRequest> requests;
+  std::vector<std::size_t> freeIds;
+  std::size_t inFlightSize;
+
+#if defined(__linux__)
+  int ringFd;
+  void* sqRing;
+  std::size_t sqRingSize;
+  void* cqRing;
+  std::size_t cqRingSize;
+  io_uring_sqe* sqes;
+  std::size_t sqesSize;
+  unsigned* sqTail;
+  unsigned* sqMask;
+  unsigned* sqArray;
+  unsigned* cqHead;
+  unsigned* cqTail;
+  unsigned* cqMask;
+  io_uring_cqe* cqes;
+
+  bool SetupRing(unsigned entries);
+  void ReleaseRing();
+  void PushRequest(std::size_t id);
+  void ReapOne();
+#endif
+
+  /* Executes the rest of the request with pread/pwrite */
+  void Execute(TRequest& request);
+};
+
+TFileIoQueue::TFileIoQueue(std::size_t depth, bool useIoUring) :
+  requests(depth), freeIds(), inFlightSize(0)
+#if defined(__linux__)
+  , ringFd(-1), sqRing(NULL), sqRingSize(0), cqRing(NULL), cqRingSize(0),
+  sqes(NULL), sqesSize(0), sqTail(NULL), sqMask(NULL), sqArray(NULL),
+  cqHead(NULL), cqTail(NULL), cqMask(NULL), cqes(NULL)
+#endif
+{
+  if (depth == 0)
+  {
+    std::stringstream info;
+    info << "Queue depth of file transport must be positive.";
+    throw std::runtime_error(info.str());
+  }
+  for (std::size_t i = depth; i > 0; --i)
+  {
+    requests[i - 1].used = false;
+    freeIds.push_back(i - 1);
+  }
+#if defined(__linux__)
+  if (useIoUring && !SetupRing(static_cast<unsigned>(depth)))
+  {
+    ReleaseRing();
+  }
+#else
+  (void)useIoUring;
+#endif
+}
+
+TFileIoQueue::~TFileIoQueue()
+{
+#if defined(__linux__)
+  /* Kernel may still access buffers of submitted requests, so all of them
+     are reaped; a failed request doesn't stop the draining */
+  while (InFlightCount() > 0)
+  {
+    std::size_t id = 0;
+    try
+    {
+      id = WaitAny();
+    }
+    catch (...)
+    {
+      /* Ring can't be reaped: buffers of unfinished requests are leaked
+         rather than freed under the kernel */
+      for (std::size_t i = 0; i < requests.size(); ++i)
+      {
+        if (requests[i].used && !requests[i].completed)
+        {
+          new TPayloadBufferPtr(requests[i].buffer);
+        }
+      }
+      break;
+    }
+    try
+    {
+      Take(id);
+    }
+    catch (...)
+    {
+    }
+  }
+  ReleaseRing();
+#endif
+}
+
+std::size_t TFileIoQueue::Submit(EOperation::Type operation, int fd,
+  const TPayloadBufferPtr& buffer, char* data, std::size_t size,
+  std::uint64_t offset)
+{
+  if (freeIds.empty())
+  {
+    std::stringstream info;
+    info << "File transport queue is full.";
+    throw std::runtime_error(info.str());
+  }
+  std::size_t id = freeIds.back();
+  freeIds.pop_back();
+  TRequest& request = requests[id];
+  request.operation = operation;
+  request.fd = fd;
+  request.buffer = buffer;
+  request.data = data;
+  request.size = size;
+  request.offset = offset;
+  request.done = 0;
+  request.error = 0;
+  request.used = true;
+  request.completed = false;
+  inFlightSize += size;
+
+#if defined(__linux__)
+  if (ringFd >= 0)
+  {
+    PushRequest(id);
+    return id;
+  }
+#endif
+  Execute(request);
+  return id;
+}
+
+std::size_t TFileIoQueue::WaitAny()
+{
+  for (;;)
+  {
+    for (std::size_t i = 0; i < requests.size(); ++i)
+    {
+      if (requests[i].used && requests[i].completed)
+      {
+        return i;
+      }
+    }
+    if (InFlightCount() == 0)
+    {
+      std::stringstream info;
+      info << "File transport queue has no requests to wait for.";
+      throw std::runtime_error(info.str());
+    }
+#if defined(__linux__)
+    ReapOne();
+#endif
+  }
+}
+
+void TFileIoQueue::Wait(std::size_t id)
+{
+  while (!requests[id].completed)
+  {
+#if defined(__linux__)
+    ReapOne();
+#endif
+  }
+}
+
+std::size_t TFileIoQueue::Take(std::size_t id)
+{
+  TRequest& request = requests[id];
+  std::size_t done = request.done;
+  int error = request.error;
+  inFlightSize -= request.size;
+  request.buffer.reset();
+  request.used = false;
+  freeIds.push_back(id);
+  if (error != 0)
+  {
+    ThrowSystemError(request.operation == EOperation::Read ?
+      "read" : "write", error);
+  }
+  return done;
+}
+
+std::size_t TFileIoQueue::InFlightCount() const
+{
+  return requests.size() - freeIds.size();
+}
+
+std::size_t TFileIoQueue::InFlightSize() const
+{
+  return inFlightSize;
+}
+
+bool TFileIoQueue::UsesIoUring() const
+{
+#if defined(__linux__)
+  return ringFd >= 0;
+#else
+  return false;
+#endif
+}
+
+void TFileIoQueue::Execute(TRequest& request)
+{
+  while (request.done < request.size)
+  {
+    std::int64_t count = (request.operation == EOperation::Read) ?
+      ReadAt(request.fd, request.data + request.done,
+        request.size - request.done, request.offset + request.done) :
+      WriteAt(request.fd, request.data + request.done,
+        request.size - request.done, request.offset + request.done);
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      request.error = errno;
+      break;
+    }
+    if (count == 0)
+    {
+      break;
+    }
+    request.done += static_cast<std::size_t>(count);
+  }
+  request.completed = true;
+}
+
+#if defined(__linux__)
+bool TFileIoQueue::SetupRing(unsigned entries)
+{
+  io_uring_params params;
+  std::memset(&params, 0, sizeof(params));
+  ringFd = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+  if (ringFd < 0)
+  {
+    return false;
+  }
+
+  /* Kernels before 5.6 have neither IORING_OP_READ/WRITE nor the probe */
+  std::vector<char> probeData(sizeof(io_uring_probe) +
+    IORING_OP_LAST * sizeof(io_uring_probe_op), 0);
+  io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(&probeData[0]);
+  if ((syscall(__NR_io_uring_register, ringFd, IORING_REGISTER_PROBE, probe,
+    IORING_OP_LAST) < 0) || (probe->last_op < IORING_OP_WRITE) ||
+    !(probe->ops[IORING_OP_READ].flags & IO_URING_OP_SUPPORTED) ||
+    !(probe->ops[IORING_OP_WRITE].flags & IO_URING_OP_SUPPORTED))
+  {
+    return false;
+  }
+
+  sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cqRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    sqRingSize = cqRingSize = std::max(sqRingSize, cqRingSize);
+  }
+  sqRing = mmap(NULL, sqRingSize, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+  if (sqRing == MAP_FAILED)
+  {
+    sqRing = NULL;
+    return false;
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP)
+  {
+    cqRing = sqRing;
+  }
+  else
+  {
+    cqRing = mmap(NULL, cqRingSize, PROT_READ | PROT_WRITE,
+      MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_CQ_RING);
+    if (cqRing == MAP_FAILED)
+    {
+      cqRing = NULL;
+      return false;
+    }
+  }
+  sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqesAddress = mmap(NULL, sqesSize, PROT_READ | PROT_WRITE,
+    MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+  if (sqesAddress == MAP_FAILED)
+  {
+    return false;
+  }
+  sqes = static_cast<io_uring_sqe*>(sqesAddress);
+
+  char* sq = static_cast<char*>(sqRing);
+  char* cq = static_cast<char*>(cqRing);
+  sqTail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+  sqMask = reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+  sqArray = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+  cqHead = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+  cqTail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+  cqMask = reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+  cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+  return true;
+}
+
+void TFileIoQueue::ReleaseRing()
+{
+  if (sqes != NULL)
+  {
+    munmap(sqes, sqesSize);
+    sqes = NULL;
+  }
+  if ((cqRing != NULL) && (cqRing != sqRing))
+  {
+    munmap(cqRing, cqRingSize);
+  }
+  cqRing = NULL;
+  if (sqRing != NULL)
+  {
+    munmap(sqRing, sqRingSize);
+    sqRing = NULL;
+  }
+  if (ringFd >= 0)
+  {
+    close(ringFd);
+    ringFd = -1;
+  }
+}
+
+void TFileIoQueue::PushRequest(std::size_t id)
+{
+  /* In-flight requests never exceed the ring size, so a slot is free */
+  const TRequest& request = requests[id];
+  unsigned tail = *sqTail;
+  unsigned index = tail & *sqMask;
+  io_uring_sqe& sqe = sqes[index];
+  std::memset(&sqe, 0, sizeof(sqe));
+  sqe.opcode = (request.operation == EOperation::Read) ?
+    IORING_OP_READ : IORING_OP_WRITE;
+  sqe.fd = request.fd;
+  sqe.addr = reinterpret_cast<std::uint64_t>(request.data + request.done);
+  sqe.len = static_cast<unsigned>(request.size - request.done);
+  sqe.off = request.offset + request.done;
+  sqe.user_data = id;
+  sqArray[index] = index;
+  __atomic_store_n(sqTail, tail + 1, __ATOMIC_RELEASE);
+
+  while (syscall(__NR_io_uring_enter, ringFd, 1, 0, 0, NULL, 0) < 0)
+  {
+    if ((errno != EINTR) && (errno != EAGAIN))
+    {
+      ThrowSystemError("io_uring_enter", errno);
+    }
+  }
+}
+
+void TFileIoQueue::ReapOne()
+{
+  unsigned head = *cqHead;
+  while (head == __atomic_load_n(cqTail, __ATOMIC_ACQUIRE))
+  {
+    if ((syscall(__NR_io_uring_enter, ringFd, 0, 1, IORING_ENTER_GETEVENTS,
+      NULL, 0) < 0) && (errno != EINTR))
+    {
+      ThrowSystemError("io_uring_enter", errno);
+    }
+  }
+  const io_uring_cqe& cqe = cqes[head & *cqMask];
+  std::size_t id = static_cast<std::size_t>(cqe.user_data);
+  int result = cqe.res;
+  __atomic_store_n(cqHead, head + 1, __ATOMIC_RELEASE);
+
+  TRequest& request = requests[id];
+  if ((result == -EINTR) || (result == -EAGAIN))
+  {
+    PushRequest(id);
+    return;
+  }
+  if (result < 0)
+  {
+    request.error = -result;
+    request.completed = true;
+    return;
+  }
+  request.done += static_cast<std::size_t>(result);
+  if ((result == 0) || (request.done == request.size))
+  {
+    request.completed = true;
+    return;
+  }
+  /* Short transfer: the rest is submitted again */
+  PushRequest(id);
+}
+#endif
+
+
+TFileTransportOptions::TFileTransportOptions() :
+  queueDepth(32),
+  blockSize(1024 * 1024),
+  maxWriteBehindSize(64 * 1024 * 1024),
+  useIoUringForReading(true),
+  useIoUringForWriting(true),
+  compression(false)
+{
+}
+
+
+TFileWriter::TFileWriter(const std::string& path,
+  const TFileTransportOptions& options) :
+  fd(-1), options(options), queue(), selector(), staging(), stagingUsed(0),
+  stagingOffset(0), appendOffset(0), frameOffset(FileHeaderSize)
+{
+  if (options.compression && ((options.blockSize == 0) ||
+    (options.blockSize > 0xFFFFFFFFU)))
+  {
+    std::stringstream info;
+    info << "Block size of compressed file transport must be positive " <<
+      "and less than 4 GiB.";
+    throw std::runtime_error(info.str());
+  }
+  fd = OpenFile(path, true);
+  if (fd < 0)
+  {
+    std::stringstream info;
+    info << "Can't open file '" << path << "' for writing: " <<
+      std::strerror(errno) << ".";
+    throw std::runtime_error(info.str());
+  }
+  try
+  {
+    queue.reset(new TFileIoQueue(options.queueDepth,
+      options.useIoUringForWriting));
+  }
+  catch (...)
+  {
+    CloseFile(fd);
+    throw;
+  }
+}
+
+TFileWriter::~TFileWriter()
+{
+  try
+  {
+    Close();
+  }
+  catch (...)
+  {
+  }
+}
+
+void TFileWriter::Write(const TPayloadSlice& data)
+{
+  WriteAt(appendOffset, data);
+}
+
+void TFileWriter::WriteAt(std::uint64_t offset, const TPayloadSlice& data)
+{
+  if (data.Empty())
+  {
+    return;
+  }
+  if (options.compression)
+  {
+    WriteFrames(offset, data);
+  }
+  else if (data.Size() < options.blockSize / 4)
+  {
+    if (staging && ((stagingOffset + stagingUsed != offset) ||
+      (stagingUsed + data.Size() > staging->Size())))
+    {
+      SubmitStaging();
+    }
+    if (!staging)
+    {
+      staging = std::make_shared<TPayloadBuffer>(options.blockSize);
+      stagingUsed = 0;
+      stagingOffset = offset;
+    }
+    std::memcpy(staging->Data() + stagingUsed, data.Data(), data.Size());
+    stagingUsed += data.Size();
+  }
+  else
+  {
+    SubmitStaging();
+    Submit(offset, data);
+  }
+  appendOffset = std::max(appendOffset, offset + data.Size());
+}
+
+void TFileWriter::Write(const TDataMessageEntranceInfo& fragment)
+{
+  WriteAt(fragment.startOffset, fragment.data);
+}
+
+void TFileWriter::Flush()
+{
+  SubmitStaging();
+  while (queue->InFlightCount() > 0)
+  {
+    queue->Take(queue->WaitAny());
+  }
+}
+
+void TFileWriter::Close()
+{
+  if (fd < 0)
+  {
+    return;
+  }
+  try
+  {
+    Flush();
+  }
+  catch (...)
+  {
+    queue.reset();
+    CloseFile(fd);
+    fd = -1;
+    throw;
+  }
+  if (options.compression)
+  {
+    /* Header is written last, so an unfinished file is never valid */
+    TPayloadBufferPtr header =
+      std::make_shared<TPayloadBuffer>(FileHeaderSize);
+    std::memset(header->Data(), 0, FileHeaderSize);
+    PutFixed(header->Data(), FileMagic, 4);
+    PutFixed(header->Data() + 4, FileVersion, 4);
+    PutFixed(header->Data() + 8, appendOffset, 8);
+    try
+    {
+      Submit(0, TPayloadSlice(header));
+      Flush();
+    }
+    catch (...)
+    {
+      queue.reset();
+      CloseFile(fd);
+      fd = -1;
+      throw;
+    }
+  }
+  queue.reset();
+  if (CloseFile(fd) < 0)
+  {
+    fd = -1;
+    ThrowSystemError("close", errno);
+  }
+  fd = -1;
+}
+
+bool TFileWriter::UsesIoUring() const
+{
+  return queue && queue->UsesIoUring();
+}
+
+std::uint64_t TFileWriter::StoredSize() const
+{
+  return options.compression ? frameOffset : appendOffset;
+}
+
+void TFileWriter::WriteFrames(std::uint64_t offset, const TPayloadSlice& data)
+{
+  /* Frames are blockSize long unless data is not contiguous */
+  std::size_t done = 0;
+  while (done < data.Size())
+  {
+    std::uint64_t position = offset + done;
+    std::size_t rest = data.Size() - done;
+    if (staging && (stagingOffset + stagingUsed != position))
+    {
+      SubmitStaging();
+    }
+    if (!staging && (rest >= options.blockSize))
+    {
+      SubmitFrame(position, data.Slice(done, options.blockSize));
+      done += options.blockSize;
+      continue;
+    }
+    if (!staging)
+    {
+      staging = std::make_shared<TPayloadBuffer>(options.blockSize);
+      stagingUsed = 0;
+      stagingOffset = position;
+    }
+    std::size_t size = std::min(rest, staging->Size() - stagingUsed);
+    std::memcpy(staging->Data() + stagingUsed, data.Data() + done, size);
+    stagingUsed += size;
+    done += size;
+    if (stagingUsed == staging->Size())
+    {
+      SubmitStaging();
+    }
+  }
+}
+
+void TFileWriter::SubmitStaging()
+{
+  if (staging && (stagingUsed > 0))
+  {
+    TPayloadSlice data(staging, 0, stagingUsed);
+    if (options.compression)
+    {
+      SubmitFrame(stagingOffset, data);
+    }
+    else
+    {
+      Submit(stagingOffset, data);
+    }
+  }
+  staging.reset();
+  stagingUsed = 0;
+}
+
+void TFileWriter::SubmitFrame(std::uint64_t offset, const TPayloadSlice& data)
+{
+  TPayloadBufferPtr frame;
+  std::size_t compressedSize = 0;
+  if (selector.ShouldCompress(data.Data(), data.Size()))
+  {
+    frame = std::make_shared<TPayloadBuffer>(FrameHeaderSize +
+      TBlockCodec::MaxCompressedSize(data.Size()));
+    compressedSize = TBlockCodec::Compress(data.Data(), data.Size(),
+      frame->Data() + FrameHeaderSize, frame->Size() - FrameHeaderSize);
+    selector.Report(data.Size(), compressedSize);
+    if (!selector.IsWorthwhile(data.Size(), compressedSize))
+    {
+      compressedSize = 0;
+    }
+  }
+
+  /* Raw data is written from the caller's buffer after its own header */
+  if (compressedSize == 0)
+  {
+    frame = std::make_shared<TPayloadBuffer>(FrameHeaderSize);
+  }
+  char* header = frame->Data();
+  PutFixed(header, FrameMagic, 4);
+  PutFixed(header + 4, (compressedSize > 0) ? FrameCompressed : 0, 4);
+  PutFixed(header + 8, offset, 8);
+  PutFixed(header + 16, data.Size(), 4);
+  PutFixed(header + 20, (compressedSize > 0) ? compressedSize : data.Size(),
+    4);
+  if (compressedSize > 0)
+  {
+    Submit(frameOffset, TPayloadSlice(frame, 0,
+      FrameHeaderSize + compressedSize));
+    frameOffset += FrameHeaderSize + compressedSize;
+  }
+  else
+  {
+    Submit(frameOffset, TPayloadSlice(frame));
+    Submit(frameOffset + FrameHeaderSize, data);
+    frameOffset += FrameHeaderSize + data.Size();
+  }
+}
+
+void TFileWriter::Submit(std::uint64_t offset, const TPayloadSlice& data)
+{
+  /* Write-behind is bounded by request count and by size */
+  while ((queue->InFlightCount() == options.queueDepth) ||
+    ((queue->InFlightCount() > 0) &&
+    (queue->InFlightSize() + data.Size() > options.maxWriteBehindSize)))
+  {
+    queue->Take(queue->WaitAny());
+  }
+  queue->Submit(TFileIoQueue::EOperation::Write, fd, data.buffer,
+    const_cast<char*>(data.Data()), data.Size(), offset);
+}
+
+
+TFileReader::TFileReader(const std::string& path,
+  const TFileTransportOptions& options) :
+  fd(-1), options(options), queue(), fileSize(0), dataSize(0), input(),
+  requestOffset(0), requests()
+{
+  fd = OpenFile(path, false);
+  if (fd < 0)
+  {
+    std::stringstream info;
+    info << "Can't open file '" << path << "' for reading: " <<
+      std::strerror(errno) << ".";
+    throw std::runtime_error(info.str());
+  }
+  if (!GetFileSize(fd, fileSize))
+  {
+    int error = errno;
+    CloseFile(fd);
+    ThrowSystemError("fstat", error);
+  }
+  try
+  {
+    if (options.blockSize == 0)
+    {
+      std::stringstream message;
+      message << "Block size of file transport must be positive.";
+      throw std::runtime_error(message.str());
+    }
+    queue.reset(new TFileIoQueue(options.queueDepth,
+      options.useIoUringForReading));
+    if (options.compression)
+    {
+      /* Header is small and is read synchronously */
+      TPayloadBufferPtr header =
+        std::make_shared<TPayloadBuffer>(FileHeaderSize);
+      std::size_t id = queue->Submit(TFileIoQueue::EOperation::Read, fd,
+        header, header->Data(), FileHeaderSize, 0);
+      queue->Wait(id);
+      if ((queue->Take(id) != FileHeaderSize) ||
+        (GetFixed(header->Data(), 4) != FileMagic))
+      {
+        ThrowCorruptedFile("file header is missing");
+      }
+      if (GetFixed(header->Data() + 4, 4) != FileVersion)
+      {
+        ThrowCorruptedFile("unsupported version");
+      }
+      dataSize = GetFixed(header->Data() + 8, 8);
+      requestOffset = FileHeaderSize;
+    }
+    RequestBlocks();
+  }
+  catch (...)
+  {
+    requests.clear();
+    queue.reset();
+    CloseFile(fd);
+    throw;
+  }
+}
+
+TFileReader::~TFileReader()
+{
+  requests.clear();
+  queue.reset();
+  CloseFile(fd);
+}
+
+bool TFileReader::Read(TDataMessageEntranceInfo& fragment)
+{
+  if (options.compression)
+  {
+    return ReadFrame(fragment);
+  }
+  TPayloadSlice block;
+  std::uint64_t offset = 0;
+  if (!NextBlock(block, offset))
+  {
+    return false;
+  }
+  fragment.startOffset = offset;
+  fragment.totalSize = fileSize;
+  fragment.SetFragment(block);
+  return true;
+}
+
+std::uint64_t TFileReader::FileSize() const
+{
+  return options.compression ? dataSize : fileSize;
+}
+
+bool TFileReader::UsesIoUring() const
+{
+  return queue && queue->UsesIoUring();
+}
+
+void TFileReader::RequestBlocks()
+{
+  while ((requests.size() < options.queueDepth) && (requestOffset < fileSize))
+  {
+    std::size_t size = static_cast<std::size_t>(std::min<std::uint64_t>(
+      options.blockSize, fileSize - requestOffset));
+    TBlockRequest request;
+    request.buffer = std::make_shared<TPayloadBuffer>(size);
+    request.offset = requestOffset;
+    request.id = queue->Submit(TFileIoQueue::EOperation::Read, fd,
+      request.buffer, request.buffer->Data(), size, requestOffset);
+    requests.push_back(request);
+    requestOffset += size;
+  }
+}
+
+bool TFileReader::NextBlock(TPayloadSlice& block, std::uint64_t& offset)
+{
+  if (requests.empty())
+  {
+    return false;
+  }
+  TBlockRequest request = requests.front();
+  requests.pop_front();
+  queue->Wait(request.id);
+  std::size_t size = queue->Take(request.id);
+  RequestBlocks();
+  if (size == 0)
+  {
+    /* File was truncated after opening */
+    requests.clear();
+    return false;
+  }
+  block = TPayloadSlice(request.buffer, 0, size);
+  offset = request.offset;
+  return true;
+}
+
+bool TFileReader::Take(std::size_t size, TPayloadSlice& slice)
+{
+  /* Data crossing a block boundary is gathered into a new buffer */
+  while (input.Size() < size)
+  {
+    TPayloadSlice block;
+    std::uint64_t offset = 0;
+    if (!NextBlock(block, offset))
+    {
+      if (input.Empty())
+      {
+        return false;
+      }
+      ThrowCorruptedFile("frame is truncated");
+    }
+    if (input.Empty())
+    {
+      input = block;
+      continue;
+    }
+    std::size_t used = std::min(block.Size(), size - input.Size());
+    TPayloadBufferPtr buffer =
+      std::make_shared<TPayloadBuffer>(input.Size() + used);
+    std::memcpy(buffer->Data(), input.Data(), input.Size());
+    std::memcpy(buffer->Data() + input.Size(), block.Data(), used);
+    if (used < block.Size())
+    {
+      slice = TPayloadSlice(buffer);
+      input = block.Slice(used, block.Size() - used);
+      return true;
+    }
+    input = TPayloadSlice(buffer);
+  }
+  slice = input.Slice(0, size);
+  input = input.Slice(size, input.Size() - size);
+  return true;
+}
+
+bool TFileReader::ReadFrame(TDataMessageEntranceInfo& fragment)
+{
+  TPayloadSlice header;
+  if (!Take(FrameHeaderSize, header))
+  {
+    return false;
+  }
+  std::uint64_t flags = GetFixed(header.Data() + 4, 4);
+  std::uint64_t offset = GetFixed(header.Data() + 8, 8);
+  std::size_t size = static_cast<std::size_t>(GetFixed(header.Data() + 16,
+    4));
+  std::size_t storedSize = static_cast<std::size_t>(
+    GetFixed(header.Data() + 20, 4));
+  if ((GetFixed(header.Data(), 4) != FrameMagic) ||
+    ((flags & ~static_cast<std::uint64_t>(FrameCompressed)) != 0))
+  {
+    ThrowCorruptedFile("frame header is invalid");
+  }
+  if ((size == 0) || (offset > dataSize) || (size > dataSize - offset) ||
+    (storedSize > TBlockCodec::MaxCompressedSize(size)) ||
+    (((flags & FrameCompressed) == 0) && (storedSize != size)))
+  {
+    ThrowCorruptedFile("frame is out of range");
+  }
+  TPayloadSlice stored;
+  if (!Take(storedSize, stored))
+  {
+    ThrowCorruptedFile("frame is truncated");
+  }
+
+  fragment.startOffset = offset;
+  fragment.totalSize = dataSize;
+  if ((flags & FrameCompressed) != 0)
+  {
+    TPayloadBufferPtr buffer = std::make_shared<TPayloadBuffer>(size);
+    if (TBlockCodec::Decompress(stored.Data(), stored.Size(),
+      buffer->Data(), size) != size)
+    {
+      ThrowCorruptedFile("frame size mismatch");
+    }
+    fragment.SetFragment(TPayloadSlice(buffer));
+  }
+  else
+  {
+    fragment.SetFragment(stored);
+  }
+  return true;
+}
+
+} // namespace wrp
@@ -0,0 +1,298 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+#include "crc32c.h"
+#include "fragment_reassembler.h"
+
+
+namespace wrp
+{
+
+bool TFragmentReassembler::TKey::operator==(const TKey& other) const
+{
+  return (tokens == other.tokens) && (entranceId == other.entranceId);
+}
+
+std::size_t TFragmentReassembler::TKeyHash::operator()(const TKey& key) const
+{
+  return static_cast<std::size_t>(key.tokens.Hash()) ^
+    std::hash<std::string>()(key.entranceId);
+}
+
+TFragmentReassembler::TPartialMessage::TPartialMessage() :
+  buffer(), coverage(), checksummed(true), coveredBytes(0), lastUpdate(),
+  lruPosition()
+{
+}
+
+const std::size_t TFragmentReassembler::DefaultCompletedCapacity;
+
+TFragmentReassembler::TFragmentReassembler(std::size_t memoryBudget,
+  std::size_t completedCapacity) :
+  memoryBudget(memoryBudget), pendingBytes(0), evictedCount(0),
+  partialMessages(), lruOrder(), completedCapacity(completedCapacity),
+  completedKeys(), completedOrder()
+{
+}
+
+EReassemblyStatus::Type TFragmentReassembler::Add(
+  const TDataMessageTokens& id, const TDataMessageEntranceInfo& fragment,
+  TDataMessageEntranceInfo& message)
+{
+  std::size_t totalSize = fragment.totalSize;
+  std::size_t begin = fragment.startOffset;
+  std::size_t fragmentSize = fragment.fragmentSize;
+  if ((fragment.data.Size() != fragmentSize) || (begin > totalSize) ||
+    (fragmentSize > totalSize - begin))
+  {
+    std::stringstream info;
+    info << "Incorrect fragment of message for '" << fragment.entranceId <<
+      "' entrance. Start offset: " << begin << ", fragment size: " <<
+      fragmentSize << ", data size: " << fragment.data.Size() <<
+      ", total size: " << totalSize << ".";
+    throw std::runtime_error(info.str());
+  }
+  if (!fragment.VerifyChecksum())
+  {
+    std::stringstream info;
+    info << "Checksum mismatch in fragment of message for '" <<
+      fragment.entranceId << "' entrance. Start offset: " << begin <<
+      ", fragment size: " << fragmentSize << ".";
+    throw std::runtime_error(info.str());
+  }
+  /* Empty fragment of non-empty message carries nothing to place */
+  if ((fragmentSize == 0) && (totalSize > 0))
+  {
+    return EReassemblyStatus::Duplicate;
+  }
+
+  TKey key;
+  key.tokens = id;
+  key.entranceId = fragment.entranceId;
+  TPartialMessages::iterator it = partialMessages.find(key);
+  if (it == partialMessages.end())
+  {
+    /* Late copy of an already reassembled message */
+    if (completedKeys.find(key) != completedKeys.end())
+    {
+      return EReassemblyStatus::Duplicate;
+    }
+
+    /* Whole message in one fragment is passed through without copying */
+    if (fragmentSize == totalSize)
+    {
+      message = fragment;
+      Remember(key);
+      return EReassemblyStatus::Completed;
+    }
+
+    Reserve(totalSize);
+    it = partialMessages.insert(
+      std::make_pair(key, TPartialMessage())).first;
+    it->second.buffer = std::make_shared<TPayloadBuffer>(totalSize);
+    it->second.lruPosition = lruOrder.insert(lruOrder.end(), &it->first);
+    pendingBytes += totalSize;
+  }
+  else
+  {
+    if (it->second.buffer->Size() != totalSize)
+    {
+      std::stringstream info;
+      info << "Total size of message for '" << fragment.entranceId <<
+        "' entrance changed from " << it->second.buffer->Size() << " to " <<
+        totalSize << ".";
+      throw std::runtime_error(info.str());
+    }
+    lruOrder.splice(lruOrder.end(), lruOrder, it->second.lruPosition);
+  }
+
+  TPartialMessage& partialMessage = it->second;
+  std::size_t copiedBytes = Place(partialMessage, fragment);
+  partialMessage.coveredBytes += copiedBytes;
+  partialMessage.lastUpdate = TClock::now();
+
+  if (partialMessage.coveredBytes == totalSize)
+  {
+    message.startOffset = 0;
+    message.totalSize = fragment.totalSize;
+    message.entranceId = fragment.entranceId;
+    message.SetFragment(TPayloadSlice(partialMessage.buffer));
+    if (partialMessage.checksummed)
+    {
+      message.checksum = partialMessage.coverage.begin()->second.checksum;
+      message.hasChecksum = true;
+    }
+    Complete(it);
+    return EReassemblyStatus::Completed;
+  }
+  return (copiedBytes == 0) ? EReassemblyStatus::Duplicate :
+    EReassemblyStatus::Incomplete;
+}
+
+std::size_t TFragmentReassembler::EvictOlderThan(
+  const TClock::time_point& time)
+{
+  std::size_t count = 0;
+  while (!lruOrder.empty())
+  {
+    TPartialMessages::iterator it = partialMessages.find(*lruOrder.front());
+    if (!(it->second.lastUpdate < time))
+    {
+      break;
+    }
+    Erase(it);
+    ++evictedCount;
+    ++count;
+  }
+  return count;
+}
+
+std::size_t TFragmentReassembler::PendingCount() const
+{
+  return partialMessages.size();
+}
+
+std::size_t TFragmentReassembler::PendingBytes() const
+{
+  return pendingBytes;
+}
+
+std::size_t TFragmentReassembler::EvictedCount() const
+{
+  return evictedCount;
+}
+
+std::size_t TFragmentReassembler::Place(TPartialMessage& partialMessage,
+  const TDataMessageEntranceInfo& fragment)
+{
+  TCoverage& coverage = partialMessage.coverage;
+  char* buffer = partialMessage.buffer->Data();
+  const char* data = fragment.data.Data();
+  std::size_t begin = fragment.startOffset;
+  std::size_t end = begin + fragment.fragmentSize;
+  std::size_t copiedBytes = 0;
+
+  /* Finding first interval which intersects or adjoins the fragment */
+  TCoverage::iterator it = coverage.upper_bound(begin);
+  if (it != coverage.begin())
+  {
+    TCoverage::iterator prev = std::prev(it);
+    if (prev->second.end >= begin)
+    {
+      it = prev;
+    }
+  }
+
+  /* Copying gaps between covered intervals and merging the intervals.
+     Checksums are combined only for intervals adjoining the fragment,
+     an overlap leaves the merged checksum unknown */
+  std::size_t mergedBegin = begin;
+  std::size_t mergedEnd = end;
+  std::uint32_t mergedChecksum = fragment.checksum;
+  bool checksummed = partialMessage.checksummed && fragment.hasChecksum;
+  bool duplicate = false;
+  std::size_t cursor = begin;
+  while ((it != coverage.end()) && (it->first <= end))
+  {
+    if (it->first > cursor)
+    {
+      std::memcpy(buffer + cursor, data + (cursor - begin), it->first - cursor);
+      copiedBytes += it->first - cursor;
+    }
+    if ((it->second.end == begin) && (it->first < begin))
+    {
+      mergedChecksum = TCrc32c::Combine(it->second.checksum, mergedChecksum,
+        end - begin);
+    }
+    else if (it->first == end)
+    {
+      mergedChecksum = TCrc32c::Combine(mergedChecksum, it->second.checksum,
+        it->second.end - it->first);
+    }
+    else if ((it->first <= begin) && (it->second.end >= end))
+    {
+      duplicate = true;
+      mergedChecksum = it->second.checksum;
+    }
+    else
+    {
+      checksummed = false;
+    }
+    cursor = std::max(cursor, it->second.end);
+    mergedBegin = std::min(mergedBegin, it->first);
+    mergedEnd = std::max(mergedEnd, it->second.end);
+    coverage.erase(it++);
+  }
+  if (cursor < end)
+  {
+    std::memcpy(buffer + cursor, data + (cursor - begin), end - cursor);
+    copiedBytes += end - cursor;
+  }
+  if (!duplicate)
+  {
+    partialMessage.checksummed = checksummed;
+  }
+  if (mergedBegin < mergedEnd)
+  {
+    TCoveredRange range = { mergedEnd, mergedChecksum };
+    coverage[mergedBegin] = range;
+  }
+  return copiedBytes;
+}
+
+void TFragmentReassembler::Erase(TPartialMessages::iterator it)
+{
+  pendingBytes -= it->second.buffer->Size();
+  lruOrder.erase(it->second.lruPosition);
+  partialMessages.erase(it);
+}
+
+void TFragmentReassembler::Complete(TPartialMessages::iterator it)
+{
+  Remember(it->first);
+  Erase(it);
+}
+
+void TFragmentReassembler::Remember(const TKey& key)
+{
+  if (completedCapacity == 0)
+  {
+    return;
+  }
+  if (completedKeys.size() == completedCapacity)
+  {
+    completedKeys.erase(*completedOrder.front());
+    completedOrder.pop_front();
+  }
+  completedOrder.push_back(&*completedKeys.insert(key).first);
+}
+
+void TFragmentReassembler::Reserve(std::size_t size)
+{
+  if (size > memoryBudget)
+  {
+    std::stringstream info;
+    info << "Message with '" << size << "' size exceeds memory budget of " <<
+      "fragment reassembler (" << memoryBudget << " bytes).";
+    throw std::runtime_error(info.str());
+  }
+  while (pendingBytes + size > memoryBudget)
+  {
+    Erase(partialMessages.find(*lruOrder.front()));
+    ++evictedCount;
+  }
+}
+
+} // namespace wrp
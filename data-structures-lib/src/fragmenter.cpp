@@ -0,0 +1,250 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "file_transport.h"
+#include "fragmenter.h"
+#include "pipe_transport.h"
+#include "shared_memory_transport.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+const std::size_t PageSize = 4096;
+
+/* Room left in a shared memory record for the message headers */
+const std::size_t RingHeaderReserve = 4096;
+
+std::size_t AlignDown(std::size_t size, std::size_t alignment)
+{
+  return size - size % alignment;
+}
+
+std::size_t AlignUp(std::size_t size, std::size_t alignment)
+{
+  return AlignDown(size + alignment - 1, alignment);
+}
+
+} // namespace
+
+
+TFragmenterOptions::TFragmenterOptions() :
+  minSize(4 * 1024),
+  maxSize(4 * 1024 * 1024),
+  initialSize(64 * 1024),
+  alignment(PageSize),
+  windowSize(32),
+  holdWindowCount(64),
+  tolerance(0.05),
+  maxLatency(0)
+{
+}
+
+TFragmenterOptions TFragmenterOptions::ForTransport(
+  ETransportType::Type type, std::size_t transportSize)
+{
+  TFragmenterOptions options;
+  switch (type)
+  {
+  case ETransportType::Pipe:
+    /* A fragment fitting the pipe buffer is written by one call */
+    if (transportSize == 0)
+    {
+      transportSize = TPipeTransportOptions().pipeSize;
+    }
+    options.initialSize = transportSize;
+    options.maxSize = 4 * transportSize;
+    break;
+  case ETransportType::File:
+    /* Fragments are written and read by whole blocks */
+    if (transportSize == 0)
+    {
+      transportSize = TFileTransportOptions().blockSize;
+    }
+    options.minSize = std::min<std::size_t>(64 * 1024, transportSize);
+    options.initialSize = transportSize;
+    options.maxSize = 16 * transportSize;
+    break;
+  case ETransportType::SharedMemory:
+    /* A ring record may take at most a half of the ring */
+    if (transportSize == 0)
+    {
+      transportSize = TSharedMemoryRing::DefaultCapacity;
+    }
+    if (transportSize / 2 < RingHeaderReserve + options.alignment)
+    {
+      std::stringstream info;
+      info << "Shared memory ring of " << transportSize << " bytes is " <<
+        "too small for fragments. Min size: " <<
+        2 * (RingHeaderReserve + options.alignment) << ".";
+      throw std::runtime_error(info.str());
+    }
+    options.maxSize = AlignDown(transportSize / 2 - RingHeaderReserve,
+      options.alignment);
+    options.minSize = std::min(options.minSize, options.maxSize);
+    options.initialSize = std::max(options.maxSize / 4, options.minSize);
+    break;
+  default:
+    {
+      std::stringstream info;
+      info << "Fragment size can't be chosen for transport type '" <<
+        type << "'.";
+      throw std::runtime_error(info.str());
+    }
+  }
+  return options;
+}
+
+
+TFragmenter::TFragmenter(const TFragmenterOptions& options) :
+  options(options), fragmentSize(0), previousSize(0),
+  previousThroughput(0), direction(1), holdWindows(0),
+  windowTransfers(0), windowSize(0), windowTime(0), throughput(0)
+{
+  if ((this->options.alignment == 0) || (this->options.windowSize == 0))
+  {
+    std::stringstream info;
+    info << "Fragment alignment and window size must be positive.";
+    throw std::runtime_error(info.str());
+  }
+  this->options.minSize = AlignUp(std::max<std::size_t>(
+    this->options.minSize, 1), this->options.alignment);
+  this->options.maxSize = AlignDown(this->options.maxSize,
+    this->options.alignment);
+  if (this->options.minSize > this->options.maxSize)
+  {
+    std::stringstream info;
+    info << "Incorrect fragment size range. Min size: " <<
+      options.minSize << ", max size: " << options.maxSize << ".";
+    throw std::runtime_error(info.str());
+  }
+  fragmentSize = std::min(std::max(AlignDown(this->options.initialSize,
+    this->options.alignment), this->options.minSize),
+    this->options.maxSize);
+}
+
+std::size_t TFragmenter::Split(const TPayloadSlice& payload,
+  const std::string& entranceId,
+  std::vector<TDataMessageEntranceInfo>& fragments) const
+{
+  std::size_t totalSize = payload.Size();
+  std::size_t count = (totalSize == 0) ? 1 :
+    (totalSize + fragmentSize - 1) / fragmentSize;
+  fragments.resize(count);
+  for (std::size_t i = 0; i < count; ++i)
+  {
+    std::size_t offset = i * fragmentSize;
+    TDataMessageEntranceInfo& fragment = fragments[i];
+    fragment.startOffset = offset;
+    fragment.totalSize = totalSize;
+    fragment.entranceId.assign(entranceId);
+    fragment.SetFragment(payload.Slice(offset,
+      std::min(fragmentSize, totalSize - offset)));
+  }
+  return count;
+}
+
+void TFragmenter::Observe(std::size_t size, std::chrono::nanoseconds elapsed)
+{
+  ++windowTransfers;
+  windowSize += size;
+  windowTime += elapsed;
+  if (windowTransfers < options.windowSize)
+  {
+    return;
+  }
+
+  std::chrono::nanoseconds latency = windowTime / windowTransfers;
+  double windowThroughput = (windowTime.count() > 0) ?
+    static_cast<double>(windowSize) * 1e9 / windowTime.count() : 0;
+  windowTransfers = 0;
+  windowSize = 0;
+  windowTime = std::chrono::nanoseconds(0);
+  CompleteWindow(windowThroughput, latency);
+}
+
+std::size_t TFragmenter::FragmentSize() const
+{
+  return fragmentSize;
+}
+
+double TFragmenter::Throughput() const
+{
+  return throughput;
+}
+
+const TFragmenterOptions& TFragmenter::Options() const
+{
+  return options;
+}
+
+void TFragmenter::CompleteWindow(double windowThroughput,
+  std::chrono::nanoseconds latency)
+{
+  throughput = windowThroughput;
+
+  /* Latency limit takes priority over throughput */
+  if ((options.maxLatency.count() > 0) && (latency > options.maxLatency) &&
+    (fragmentSize > options.minSize))
+  {
+    fragmentSize = Step(fragmentSize, -1);
+    previousSize = 0;
+    direction = -1;
+    holdWindows = options.holdWindowCount;
+    return;
+  }
+
+  if (holdWindows > 0)
+  {
+    --holdWindows;
+    if (holdWindows > 0)
+    {
+      return;
+    }
+    /* Probing again: the measured window becomes the baseline */
+    previousSize = 0;
+  }
+
+  if ((previousSize == 0) ||
+    (windowThroughput > previousThroughput * (1 + options.tolerance)))
+  {
+    std::size_t nextSize = Step(fragmentSize, direction);
+    if (nextSize == fragmentSize)
+    {
+      direction = -direction;
+      holdWindows = options.holdWindowCount;
+      return;
+    }
+    previousSize = fragmentSize;
+    previousThroughput = windowThroughput;
+    fragmentSize = nextSize;
+    return;
+  }
+
+  /* No gain: previous size is restored and the other direction is tried
+     after the hold period */
+  fragmentSize = previousSize;
+  previousSize = 0;
+  direction = -direction;
+  holdWindows = options.holdWindowCount;
+}
+
+std::size_t TFragmenter::Step(std::size_t size, int step) const
+{
+  if (step > 0)
+  {
+    return std::min(size * 2, options.maxSize);
+  }
+  return std::max(AlignUp(size / 2, options.alignment), options.minSize);
+}
+
+} // namespace wrp
@@ -0,0 +1,307 @@
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "hop_latency.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+/* Number of significant bits of value */
+unsigned int BitLength(std::uint64_t value)
+{
+#if defined(__GNUC__)
+  return (value == 0) ? 0 : 64 - __builtin_clzll(value);
+#else
+  unsigned int length = 0;
+  while (value != 0)
+  {
+    value >>= 1;
+    ++length;
+  }
+  return length;
+#endif
+}
+
+} // namespace
+
+
+const unsigned int TLatencyHistogram::SubBucketBits;
+const std::size_t TLatencyHistogram::SubBucketCount;
+const unsigned int TLatencyHistogram::MaxValueBits;
+const std::size_t TLatencyHistogram::BucketCount;
+
+TLatencyHistogram::TLatencyHistogram()
+{
+  Reset();
+}
+
+void TLatencyHistogram::Record(std::uint64_t value)
+{
+  counts[BucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+  sum.fetch_add(value, std::memory_order_relaxed);
+  std::uint64_t current = max.load(std::memory_order_relaxed);
+  while ((value > current) && !max.compare_exchange_weak(current, value,
+    std::memory_order_relaxed))
+  {
+  }
+}
+
+std::uint64_t TLatencyHistogram::Count() const
+{
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < BucketCount; ++i)
+  {
+    total += counts[i].load(std::memory_order_relaxed);
+  }
+  return total;
+}
+
+double TLatencyHistogram::Mean() const
+{
+  std::uint64_t total = Count();
+  return (total > 0) ?
+    static_cast<double>(sum.load(std::memory_order_relaxed)) / total : 0;
+}
+
+std::uint64_t TLatencyHistogram::Max() const
+{
+  return max.load(std::memory_order_relaxed);
+}
+
+std::uint64_t TLatencyHistogram::ValueAtFraction(double fraction) const
+{
+  /* Counts are copied once, so concurrent records can't shift the rank */
+  std::vector<std::uint64_t> snapshot(BucketCount);
+  std::uint64_t total = 0;
+  for (std::size_t i = 0; i < BucketCount; ++i)
+  {
+    snapshot[i] = counts[i].load(std::memory_order_relaxed);
+    total += snapshot[i];
+  }
+  if (total == 0)
+  {
+    return 0;
+  }
+  fraction = std::min(std::max(fraction, 0.0), 1.0);
+  std::uint64_t rank = std::max<std::uint64_t>(1,
+    static_cast<std::uint64_t>(std::ceil(fraction * total)));
+  std::uint64_t seen = 0;
+  for (std::size_t i = 0; i < BucketCount; ++i)
+  {
+    seen += snapshot[i];
+    if (seen >= rank)
+    {
+      return std::min(BucketHighestValue(i), Max());
+    }
+  }
+  return Max();
+}
+
+void TLatencyHistogram::Reset()
+{
+  for (std::size_t i = 0; i < BucketCount; ++i)
+  {
+    counts[i].store(0, std::memory_order_relaxed);
+  }
+  sum.store(0, std::memory_order_relaxed);
+  max.store(0, std::memory_order_relaxed);
+}
+
+std::size_t TLatencyHistogram::BucketIndex(std::uint64_t value)
+{
+  /* Values below 2 * SubBucketCount have their own buckets; above that
+     every power of two is split into SubBucketCount buckets */
+  unsigned int length = BitLength(value);
+  if (length <= SubBucketBits + 1)
+  {
+    return static_cast<std::size_t>(value);
+  }
+  if (length > MaxValueBits)
+  {
+    return BucketCount - 1;
+  }
+  unsigned int shift = length - (SubBucketBits + 1);
+  return shift * SubBucketCount + static_cast<std::size_t>(value >> shift);
+}
+
+std::uint64_t TLatencyHistogram::BucketHighestValue(std::size_t index)
+{
+  if (index < 2 * SubBucketCount)
+  {
+    return index;
+  }
+  std::size_t shift = index / SubBucketCount - 1;
+  std::uint64_t lowest =
+    static_cast<std::uint64_t>(index - shift * SubBucketCount) << shift;
+  return lowest + (std::uint64_t(1) << shift) - 1;
+}
+
+
+const std::size_t THopLatencyTable::HopNotFound;
+
+bool THopLatencyTable::THopKey::operator<(const THopKey& other) const
+{
+  if (receiver != other.receiver)
+  {
+    return receiver < other.receiver;
+  }
+  return channelId < other.channelId;
+}
+
+THopLatencyTable::THopLatencyTable(const TWorkflowModel& model,
+  const TSymbolTable& symbols) :
+  hops(), keys()
+{
+  std::map<TModuleId::TWorkflowId, std::string> moduleNames;
+  for (std::size_t i = 0; i < model.Size(); ++i)
+  {
+    moduleNames[model.ids[i].workflowId] = model.cold[i].name;
+  }
+
+  for (std::size_t i = 0; i < model.Size(); ++i)
+  {
+    const std::vector<TOutputBatchInfo>& outputBatches =
+      model.cold[i].outputBatches;
+    for (std::size_t j = 0; j < outputBatches.size(); ++j)
+    {
+      const std::vector<TOutputBatchInfo::TOutputMessageChannelInfo>&
+        outputChannels = outputBatches[j].channels;
+      for (std::size_t k = 0; k < outputChannels.size(); ++k)
+      {
+        THopKey key = { outputChannels[k].receiver,
+          outputChannels[k].convertedNameId, hops.size() };
+        std::vector<THopKey>::iterator found =
+          std::lower_bound(keys.begin(), keys.end(), key);
+        if ((found != keys.end()) && !(key < *found))
+        {
+          /* Several producers may feed one input channel */
+          continue;
+        }
+        keys.insert(found, key);
+        hops.push_back(std::unique_ptr<THop>(new THop()));
+        hops.back()->moduleName = moduleNames[key.receiver];
+        hops.back()->channelName =
+          symbols.GetString(outputChannels[k].convertedNameId);
+      }
+    }
+  }
+}
+
+THopLatencyTable::~THopLatencyTable()
+{
+}
+
+std::uint64_t THopLatencyTable::Now()
+{
+  return TDataMessageToken::Now();
+}
+
+std::size_t THopLatencyTable::Find(TModuleId::TWorkflowId receiver,
+  TSymbolId channelId) const
+{
+  THopKey key = { receiver, channelId, HopNotFound };
+  std::vector<THopKey>::const_iterator found =
+    std::lower_bound(keys.begin(), keys.end(), key);
+  if ((found == keys.end()) || (key < *found))
+  {
+    return HopNotFound;
+  }
+  return found->hop;
+}
+
+void THopLatencyTable::Record(std::size_t hop, std::uint64_t latency)
+{
+  hops.at(hop)->histogram.Record(latency);
+}
+
+bool THopLatencyTable::RecordArrival(const TDataMessage& message,
+  TSymbolId channelId, std::uint64_t now)
+{
+  std::uint64_t timestamp = message.id.lastModuleToken.timestamp;
+  if (timestamp == 0)
+  {
+    return false;
+  }
+  std::size_t hop = Find(message.destination.workflowId, channelId);
+  if (hop == HopNotFound)
+  {
+    return false;
+  }
+  hops[hop]->histogram.Record((now > timestamp) ? now - timestamp : 0);
+  return true;
+}
+
+std::size_t THopLatencyTable::HopCount() const
+{
+  return hops.size();
+}
+
+const TLatencyHistogram& THopLatencyTable::Histogram(std::size_t hop) const
+{
+  return hops.at(hop)->histogram;
+}
+
+void THopLatencyTable::WriteSnapshot(std::ostream& output) const
+{
+  output << "# module\tchannel\tcount\tmean\tp50\tp90\tp99\tp99.9\tmax" <<
+    "\n# latencies in microseconds\n";
+  output << std::fixed << std::setprecision(1);
+  for (std::size_t i = 0; i < hops.size(); ++i)
+  {
+    const TLatencyHistogram& histogram = hops[i]->histogram;
+    std::uint64_t count = histogram.Count();
+    if (count == 0)
+    {
+      continue;
+    }
+    output << hops[i]->moduleName << '\t' << hops[i]->channelName << '\t' <<
+      count << '\t' << histogram.Mean() / 1000 << '\t' <<
+      histogram.ValueAtFraction(0.5) / 1000.0 << '\t' <<
+      histogram.ValueAtFraction(0.9) / 1000.0 << '\t' <<
+      histogram.ValueAtFraction(0.99) / 1000.0 << '\t' <<
+      histogram.ValueAtFraction(0.999) / 1000.0 << '\t' <<
+      histogram.Max() / 1000.0 << '\n';
+  }
+}
+
+void THopLatencyTable::SaveSnapshot(const std::string& path) const
+{
+  std::string temporaryPath = path + ".tmp";
+  {
+    std::ofstream output(temporaryPath.c_str(),
+      std::ios::out | std::ios::trunc);
+    WriteSnapshot(output);
+    output.flush();
+    if (!output)
+    {
+      std::stringstream info;
+      info << "Can't write latency snapshot to '" << temporaryPath << "'.";
+      throw std::runtime_error(info.str());
+    }
+  }
+  if (std::rename(temporaryPath.c_str(), path.c_str()) != 0)
+  {
+    std::stringstream info;
+    info << "Can't replace latency snapshot '" << path << "'.";
+    throw std::runtime_error(info.str());
+  }
+}
+
+} // namespace wrp
@@ -0,0 +1,17 @@
+#include "message.h"
+
+
+namespace wrp
+{
+
+TMessage::TMessage(EMessageType::Type type, const TModuleId& source,
+  const TModuleId& destination) :
+  type(type), source(source), destination(destination)
+{
+}
+
+TMessage::~TMessage()
+{
+}
+
+} // namespace wrp
@@ -0,0 +1,463 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "message_codec.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+std::size_t VarintSize(std::uint64_t value)
+{
+  std::size_t size = 1;
+  while (value >= 0x80)
+  {
+    value >>= 7;
+    ++size;
+  }
+  return size;
+}
+
+char* PutVarint(char* pos, std::uint64_t value)
+{
+  while (value >= 0x80)
+  {
+    *pos++ = static_cast<char>((value & 0x7F) | 0x80);
+    value >>= 7;
+  }
+  *pos++ = static_cast<char>(value);
+  return pos;
+}
+
+template<class T>
+char* PutFixed(char* pos, T value)
+{
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    *pos++ = static_cast<char>(value & 0xFF);
+    value = static_cast<T>(value >> 8);
+  }
+  return pos;
+}
+
+template<class T>
+const char* GetFixed(const char* pos, T& value)
+{
+  value = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    value = static_cast<T>(value |
+      (static_cast<T>(static_cast<unsigned char>(pos[i])) << (8 * i)));
+  }
+  return pos + sizeof(T);
+}
+
+std::size_t TokenSize(const TDataMessageToken& token)
+{
+  return VarintSize(token.source.workflowId) +
+    VarintSize(token.source.instanceId) + VarintSize(token.batchId) +
+    VarintSize(token.timestamp);
+}
+
+char* PutToken(char* pos, const TDataMessageToken& token)
+{
+  pos = PutVarint(pos, token.source.workflowId);
+  pos = PutVarint(pos, token.source.instanceId);
+  pos = PutVarint(pos, token.batchId);
+  return PutVarint(pos, token.timestamp);
+}
+
+void ThrowCorrupted(const char* reason)
+{
+  std::stringstream info;
+  info << "Corrupted data message: " << reason << ".";
+  throw std::runtime_error(info.str());
+}
+
+/** Reads metadata fields with bounds checking.
+ *
+ */
+class TMetaReader
+{
+public:
+  TMetaReader(const char* begin, const char* end) :
+    pos(begin), end(end)
+  {
+  }
+
+  std::uint64_t ReadVarint()
+  {
+    std::uint64_t value = 0;
+    for (unsigned int shift = 0; shift < 64; shift += 7)
+    {
+      if (pos == end)
+      {
+        ThrowCorrupted("metadata is truncated");
+      }
+      unsigned char byte = static_cast<unsigned char>(*pos++);
+      value |= static_cast<std::uint64_t>(byte & 0x7F) << shift;
+      if ((byte & 0x80) == 0)
+      {
+        return value;
+      }
+    }
+    ThrowCorrupted("varint is too long");
+    return 0;
+  }
+
+  template<class T>
+  T Read()
+  {
+    std::uint64_t value = ReadVarint();
+    if (value > std::numeric_limits<T>::max())
+    {
+      ThrowCorrupted("value is out of range");
+    }
+    return static_cast<T>(value);
+  }
+
+  template<class T>
+  T ReadFixed()
+  {
+    if (static_cast<std::size_t>(end - pos) < sizeof(T))
+    {
+      ThrowCorrupted("metadata is truncated");
+    }
+    T value;
+    pos = GetFixed(pos, value);
+    return value;
+  }
+
+  TDataMessageToken ReadToken()
+  {
+    TDataMessageToken token;
+    token.source.workflowId = Read<TModuleId::TWorkflowId>();
+    token.source.instanceId = Read<TModuleId::TInstanceId>();
+    token.batchId = Read<TBatchInstanceId>();
+    token.timestamp = ReadVarint();
+    return token;
+  }
+
+  void ReadString(std::string& value)
+  {
+    std::size_t size = Read<std::size_t>();
+    if (size > static_cast<std::size_t>(end - pos))
+    {
+      ThrowCorrupted("metadata is truncated");
+    }
+    value.assign(pos, size);
+    pos += size;
+  }
+
+  bool AtEnd() const
+  {
+    return pos == end;
+  }
+
+private:
+  const char* pos;
+  const char* end;
+};
+
+unsigned int EntranceFlags(const TDataMessageEntranceInfo& entrance)
+{
+  return entrance.hasChecksum ? EWireEntranceFlag::HasChecksum : 0;
+}
+
+/* Writes header and metadata; headSize must be HeadSize(message) */
+std::size_t WriteHead(const TDataMessage& message, std::size_t headSize,
+  char* buffer)
+{
+  TWireHeader header;
+  header.type = static_cast<std::uint16_t>(message.type);
+  header.metaSize = static_cast<std::uint32_t>(headSize - TWireHeader::Size);
+  header.entranceCount = static_cast<std::uint32_t>(message.entrances.size());
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    if (message.entrances[i].data.Size() != message.entrances[i].fragmentSize)
+    {
+      std::stringstream info;
+      info << "Fragment of '" << message.entrances[i].entranceId <<
+        "' entrance has '" << message.entrances[i].data.Size() <<
+        "' bytes, expected '" << message.entrances[i].fragmentSize << "'.";
+      throw std::runtime_error(info.str());
+    }
+    header.payloadSize += message.entrances[i].fragmentSize;
+  }
+
+  char* pos = buffer;
+  pos = PutFixed(pos, header.magic);
+  pos = PutFixed(pos, header.version);
+  pos = PutFixed(pos, header.type);
+  pos = PutFixed(pos, header.metaSize);
+  pos = PutFixed(pos, header.entranceCount);
+  pos = PutFixed(pos, header.payloadSize);
+
+  pos = PutVarint(pos, message.source.workflowId);
+  pos = PutVarint(pos, message.source.instanceId);
+  pos = PutVarint(pos, message.destination.workflowId);
+  pos = PutVarint(pos, message.destination.instanceId);
+
+  /* Path is stored from its tail, so tokens are written backward */
+  std::size_t tokenCount = message.id.tokens.Size();
+  pos = PutVarint(pos, tokenCount);
+  char* tokensEnd = pos;
+  for (TTokenPath::TReverseIterator it = message.id.tokens.RBegin();
+    it != message.id.tokens.REnd(); ++it)
+  {
+    tokensEnd += TokenSize(*it);
+  }
+  char* tokenPos = tokensEnd;
+  for (TTokenPath::TReverseIterator it = message.id.tokens.RBegin();
+    it != message.id.tokens.REnd(); ++it)
+  {
+    tokenPos -= TokenSize(*it);
+    PutToken(tokenPos, *it);
+  }
+  pos = PutToken(tokensEnd, message.id.lastModuleToken);
+
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    const TDataMessageEntranceInfo& entrance = message.entrances[i];
+    pos = PutVarint(pos, entrance.startOffset);
+    pos = PutVarint(pos, entrance.totalSize);
+    pos = PutVarint(pos, entrance.fragmentSize);
+    pos = PutVarint(pos, EntranceFlags(entrance));
+    if (entrance.hasChecksum)
+    {
+      pos = PutFixed(pos, entrance.checksum);
+    }
+    pos = PutVarint(pos, entrance.entranceId.size());
+    std::memcpy(pos, entrance.entranceId.data(), entrance.entranceId.size());
+    pos += entrance.entranceId.size();
+  }
+  return pos - buffer;
+}
+
+} // namespace
+
+
+const std::uint32_t TWireHeader::Magic;
+const std::uint16_t TWireHeader::Version;
+const std::size_t TWireHeader::Size;
+
+TWireHeader::TWireHeader() :
+  magic(Magic), version(Version), type(EMessageType::_undefined),
+  metaSize(0), entranceCount(0), payloadSize(0)
+{
+}
+
+std::size_t TWireHeader::MessageSize() const
+{
+  return Size + metaSize + payloadSize;
+}
+
+
+std::size_t TDataMessageCodec::HeadSize(const TDataMessage& message)
+{
+  std::size_t size = TWireHeader::Size +
+    VarintSize(message.source.workflowId) +
+    VarintSize(message.source.instanceId) +
+    VarintSize(message.destination.workflowId) +
+    VarintSize(message.destination.instanceId) +
+    VarintSize(message.id.tokens.Size()) +
+    TokenSize(message.id.lastModuleToken);
+  for (TTokenPath::TReverseIterator it = message.id.tokens.RBegin();
+    it != message.id.tokens.REnd(); ++it)
+  {
+    size += TokenSize(*it);
+  }
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    const TDataMessageEntranceInfo& entrance = message.entrances[i];
+    size += VarintSize(entrance.startOffset) +
+      VarintSize(entrance.totalSize) + VarintSize(entrance.fragmentSize) +
+      VarintSize(EntranceFlags(entrance)) +
+      (entrance.hasChecksum ? sizeof(entrance.checksum) : 0) +
+      VarintSize(entrance.entranceId.size()) + entrance.entranceId.size();
+  }
+  return size;
+}
+
+std::size_t TDataMessageCodec::EncodedSize(const TDataMessage& message)
+{
+  std::size_t size = HeadSize(message);
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    size += message.entrances[i].data.Size();
+  }
+  return size;
+}
+
+std::size_t TDataMessageCodec::EncodeHead(const TDataMessage& message,
+  char* buffer, std::size_t size)
+{
+  std::size_t headSize = HeadSize(message);
+  if (size < headSize)
+  {
+    std::stringstream info;
+    info << "Buffer with '" << size << "' size is too small for data " <<
+      "message head with '" << headSize << "' size.";
+    throw std::runtime_error(info.str());
+  }
+
+  return WriteHead(message, headSize, buffer);
+}
+
+std::size_t TDataMessageCodec::Encode(const TDataMessage& message,
+  char* buffer, std::size_t size)
+{
+  std::size_t headSize = HeadSize(message);
+  std::size_t encodedSize = headSize;
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    encodedSize += message.entrances[i].data.Size();
+  }
+  if (size < encodedSize)
+  {
+    std::stringstream info;
+    info << "Buffer with '" << size << "' size is too small for data " <<
+      "message with '" << encodedSize << "' size.";
+    throw std::runtime_error(info.str());
+  }
+
+  char* pos = buffer + WriteHead(message, headSize, buffer);
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    const TPayloadSlice& data = message.entrances[i].data;
+    if (!data.Empty())
+    {
+      std::memcpy(pos, data.Data(), data.Size());
+      pos += data.Size();
+    }
+  }
+  return pos - buffer;
+}
+
+TPayloadSlice TDataMessageCodec::Encode(const TDataMessage& message)
+{
+  TPayloadBufferPtr buffer =
+    std::make_shared<TPayloadBuffer>(EncodedSize(message));
+  Encode(message, buffer->Data(), buffer->Size());
+  return TPayloadSlice(buffer);
+}
+
+bool TDataMessageCodec::DecodeHeader(const char* data, std::size_t size,
+  TWireHeader& header)
+{
+  if (size < TWireHeader::Size)
+  {
+    return false;
+  }
+
+  const char* pos = data;
+  pos = GetFixed(pos, header.magic);
+  pos = GetFixed(pos, header.version);
+  pos = GetFixed(pos, header.type);
+  pos = GetFixed(pos, header.metaSize);
+  pos = GetFixed(pos, header.entranceCount);
+  pos = GetFixed(pos, header.payloadSize);
+  if (header.magic != TWireHeader::Magic)
+  {
+    ThrowCorrupted("wrong signature");
+  }
+  if (header.version != TWireHeader::Version)
+  {
+    std::stringstream info;
+    info << "Unsupported data message format version: " << header.version <<
+      ". Supported version: " << TWireHeader::Version << ".";
+    throw std::runtime_error(info.str());
+  }
+  if (header.payloadSize > std::numeric_limits<std::size_t>::max() -
+    TWireHeader::Size - header.metaSize)
+  {
+    ThrowCorrupted("payload size is out of range");
+  }
+  return true;
+}
+
+std::size_t TDataMessageCodec::Decode(const TPayloadSlice& input,
+  TDataMessage& message)
+{
+  TWireHeader header;
+  if (!DecodeHeader(input.Data(), input.Size(), header))
+  {
+    ThrowCorrupted("header is truncated");
+  }
+  if (header.MessageSize() > input.Size())
+  {
+    ThrowCorrupted("message is truncated");
+  }
+
+  const char* meta = input.Data() + TWireHeader::Size;
+  TMetaReader reader(meta, meta + header.metaSize);
+  message.type = static_cast<EMessageType::Type>(header.type);
+  message.source.workflowId = reader.Read<TModuleId::TWorkflowId>();
+  message.source.instanceId = reader.Read<TModuleId::TInstanceId>();
+  message.destination.workflowId = reader.Read<TModuleId::TWorkflowId>();
+  message.destination.instanceId = reader.Read<TModuleId::TInstanceId>();
+
+  std::size_t tokenCount = reader.Read<std::size_t>();
+  if (tokenCount > header.metaSize)
+  {
+    ThrowCorrupted("token count is out of range");
+  }
+  message.id.Clear();
+  for (std::size_t i = 0; i < tokenCount; ++i)
+  {
+    message.id.Append(reader.ReadToken());
+  }
+  message.id.lastModuleToken = reader.ReadToken();
+
+  if (header.entranceCount > header.metaSize)
+  {
+    ThrowCorrupted("entrance count is out of range");
+  }
+  message.entrances.resize(header.entranceCount);
+  std::size_t payloadOffset = TWireHeader::Size + header.metaSize;
+  std::uint64_t payloadLeft = header.payloadSize;
+  for (std::size_t i = 0; i < header.entranceCount; ++i)
+  {
+    TDataMessageEntranceInfo& entrance = message.entrances[i];
+    entrance.startOffset =
+      reader.Read<TDataMessageEntranceInfo::TMessageDataSize>();
+    entrance.totalSize =
+      reader.Read<TDataMessageEntranceInfo::TMessageDataSize>();
+    TDataMessageEntranceInfo::TMessageDataSize fragmentSize =
+      reader.Read<TDataMessageEntranceInfo::TMessageDataSize>();
+    unsigned int flags = reader.Read<unsigned int>();
+    if ((flags & ~static_cast<unsigned int>(
+      EWireEntranceFlag::HasChecksum)) != 0)
+    {
+      ThrowCorrupted("unknown entrance flags");
+    }
+    std::uint32_t checksum = ((flags & EWireEntranceFlag::HasChecksum) != 0) ?
+      reader.ReadFixed<std::uint32_t>() : 0;
+    reader.ReadString(entrance.entranceId);
+    if (fragmentSize > payloadLeft)
+    {
+      ThrowCorrupted("fragment is out of payload");
+    }
+    entrance.SetFragment(input.Slice(payloadOffset, fragmentSize));
+    entrance.checksum = checksum;
+    entrance.hasChecksum = (flags & EWireEntranceFlag::HasChecksum) != 0;
+    payloadOffset += fragmentSize;
+    payloadLeft -= fragmentSize;
+  }
+  if (!reader.AtEnd() || (payloadLeft != 0))
+  {
+    ThrowCorrupted("sizes of sections don't match header");
+  }
+  return header.MessageSize();
+}
+
+} // namespace wrp
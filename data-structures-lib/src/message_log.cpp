@@ -0,0 +1,340 @@
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#include "message_codec.h"
+#include "message_log.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+template<class T>
+char* PutFixed(char* pos, T value)
+{
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    *pos++ = static_cast<char>(value & 0xFF);
+    value = static_cast<T>(value >> 8);
+  }
+  return pos;
+}
+
+template<class T>
+const char* GetFixed(const char* pos, T& value)
+{
+  value = 0;
+  for (std::size_t i = 0; i < sizeof(T); ++i)
+  {
+    value = static_cast<T>(value |
+      (static_cast<T>(static_cast<unsigned char>(pos[i])) << (8 * i)));
+  }
+  return pos + sizeof(T);
+}
+
+void ThrowSystemError(const char* call, int error)
+{
+  std::stringstream info;
+  info << "Message log: " << call << " failed: " << std::strerror(error) <<
+    ".";
+  throw std::runtime_error(info.str());
+}
+
+void ThrowCorrupted(const std::string& path, const char* reason)
+{
+  std::stringstream info;
+  info << "Corrupted message log '" << path << "': " << reason << ".";
+  throw std::runtime_error(info.str());
+}
+
+#if defined(__linux__)
+void Unmap(char* data, std::size_t size)
+{
+  munmap(data, size);
+}
+#endif
+
+} // namespace
+
+
+const std::uint32_t TMessageLogHeader::Magic;
+const std::uint32_t TMessageLogHeader::Version;
+const std::size_t TMessageLogHeader::Size;
+const std::size_t TMessageLogHeader::TimestampSize;
+
+
+const std::size_t TMessageRecorder::DefaultCapacity;
+
+TMessageRecorder::TMessageRecorder(const std::string& path,
+  std::size_t capacity) :
+  fd(-1), mapping(NULL), capacity(0), used(TMessageLogHeader::Size),
+  recordCount(0), started(false), startTime()
+{
+#if defined(__linux__)
+  fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd < 0)
+  {
+    std::stringstream info;
+    info << "Can't open message log '" << path << "' for writing: " <<
+      std::strerror(errno) << ".";
+    throw std::runtime_error(info.str());
+  }
+  try
+  {
+    Reserve(std::max(capacity, TMessageLogHeader::Size) -
+      TMessageLogHeader::Size);
+  }
+  catch (...)
+  {
+    CloseFile();
+    throw;
+  }
+  /* Header stays zero until Close, so an unfinished log is rejected */
+  std::memset(mapping, 0, TMessageLogHeader::Size);
+#else
+  (void)path;
+  (void)capacity;
+  ThrowSystemError("open", ENOSYS);
+#endif
+}
+
+TMessageRecorder::~TMessageRecorder()
+{
+  try
+  {
+    Close();
+  }
+  catch (...)
+  {
+  }
+}
+
+void TMessageRecorder::Record(const TDataMessage& message)
+{
+  TClock::time_point now = TClock::now();
+  if (!started)
+  {
+    startTime = now;
+    started = true;
+  }
+  Record(message, static_cast<std::uint64_t>(
+    std::chrono::duration_cast<std::chrono::nanoseconds>(
+      now - startTime).count()));
+}
+
+void TMessageRecorder::Record(const TDataMessage& message,
+  std::uint64_t timestamp)
+{
+  if (fd < 0)
+  {
+    std::stringstream info;
+    info << "Message log is closed.";
+    throw std::runtime_error(info.str());
+  }
+  std::size_t size = TDataMessageCodec::EncodedSize(message);
+  Reserve(TMessageLogHeader::TimestampSize + size);
+
+  /* Message is encoded straight into the mapping */
+  char* pos = PutFixed(mapping + used, timestamp);
+  TDataMessageCodec::Encode(message, pos, size);
+  used += TMessageLogHeader::TimestampSize + size;
+  ++recordCount;
+}
+
+void TMessageRecorder::Close()
+{
+  if (fd < 0)
+  {
+    return;
+  }
+  char* pos = mapping;
+  pos = PutFixed(pos, TMessageLogHeader::Magic);
+  pos = PutFixed(pos, TMessageLogHeader::Version);
+  pos = PutFixed(pos, recordCount);
+  PutFixed(pos, static_cast<std::uint64_t>(used - TMessageLogHeader::Size));
+  CloseFile();
+}
+
+std::uint64_t TMessageRecorder::RecordCount() const
+{
+  return recordCount;
+}
+
+std::uint64_t TMessageRecorder::Size() const
+{
+  return used;
+}
+
+void TMessageRecorder::Reserve(std::size_t size)
+{
+  if ((mapping != NULL) && (capacity - used >= size))
+  {
+    return;
+  }
+#if defined(__linux__)
+  std::size_t newCapacity = std::max<std::size_t>(capacity, 4096);
+  while ((newCapacity < used) || (newCapacity - used < size))
+  {
+    newCapacity *= 2;
+  }
+  if (ftruncate(fd, static_cast<off_t>(newCapacity)) < 0)
+  {
+    ThrowSystemError("ftruncate", errno);
+  }
+  void* address = (mapping == NULL) ?
+    mmap(NULL, newCapacity, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) :
+    mremap(mapping, capacity, newCapacity, MREMAP_MAYMOVE);
+  if (address == MAP_FAILED)
+  {
+    ThrowSystemError(mapping == NULL ? "mmap" : "mremap", errno);
+  }
+  mapping = static_cast<char*>(address);
+  capacity = newCapacity;
+#else
+  ThrowSystemError("mmap", ENOSYS);
+#endif
+}
+
+void TMessageRecorder::CloseFile()
+{
+#if defined(__linux__)
+  int error = 0;
+  const char* call = NULL;
+  if (mapping != NULL)
+  {
+    munmap(mapping, capacity);
+    mapping = NULL;
+  }
+  if (ftruncate(fd, static_cast<off_t>(used)) < 0)
+  {
+    error = errno;
+    call = "ftruncate";
+  }
+  if ((close(fd) < 0) && (call == NULL))
+  {
+    error = errno;
+    call = "close";
+  }
+  fd = -1;
+  if (call != NULL)
+  {
+    ThrowSystemError(call, error);
+  }
+#endif
+}
+
+
+TMessageLog::TMessageLog(const std::string& path) :
+  records(), recordCount(0), position(0), readCount(0)
+{
+#if defined(__linux__)
+  int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    std::stringstream info;
+    info << "Can't open message log '" << path << "' for reading: " <<
+      std::strerror(errno) << ".";
+    throw std::runtime_error(info.str());
+  }
+  struct stat info;
+  if (fstat(fd, &info) < 0)
+  {
+    int error = errno;
+    close(fd);
+    ThrowSystemError("fstat", error);
+  }
+  std::size_t size = static_cast<std::size_t>(info.st_size);
+  if (size < TMessageLogHeader::Size)
+  {
+    close(fd);
+    ThrowCorrupted(path, "header is missing");
+  }
+
+  /* Read-only: fragment data must be the same on every pass */
+  void* address = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+  int error = errno;
+  close(fd);
+  if (address == MAP_FAILED)
+  {
+    ThrowSystemError("mmap", error);
+  }
+  TPayloadBufferPtr buffer = std::make_shared<TPayloadBuffer>(
+    static_cast<char*>(address), size, Unmap);
+
+  const char* pos = buffer->Data();
+  std::uint32_t magic = 0;
+  std::uint32_t version = 0;
+  std::uint64_t dataSize = 0;
+  pos = GetFixed(pos, magic);
+  pos = GetFixed(pos, version);
+  pos = GetFixed(pos, recordCount);
+  pos = GetFixed(pos, dataSize);
+  if (magic != TMessageLogHeader::Magic)
+  {
+    ThrowCorrupted(path, "wrong signature or log was not closed");
+  }
+  if (version != TMessageLogHeader::Version)
+  {
+    ThrowCorrupted(path, "unsupported version");
+  }
+  if (dataSize > size - TMessageLogHeader::Size)
+  {
+    ThrowCorrupted(path, "log is truncated");
+  }
+  records = TPayloadSlice(buffer, TMessageLogHeader::Size,
+    static_cast<std::size_t>(dataSize));
+#else
+  (void)path;
+  ThrowSystemError("open", ENOSYS);
+#endif
+}
+
+bool TMessageLog::Next(TDataMessage& message, std::uint64_t& timestamp)
+{
+  if ((position == records.Size()) || (readCount == recordCount))
+  {
+    return false;
+  }
+  if (records.Size() - position < TMessageLogHeader::TimestampSize)
+  {
+    std::stringstream info;
+    info << "Corrupted message log: record is truncated.";
+    throw std::runtime_error(info.str());
+  }
+  GetFixed(records.Data() + position, timestamp);
+  position += TMessageLogHeader::TimestampSize;
+  position += TDataMessageCodec::Decode(records.Slice(position,
+    records.Size() - position), message);
+  ++readCount;
+  return true;
+}
+
+void TMessageLog::Rewind()
+{
+  position = 0;
+  readCount = 0;
+}
+
+std::uint64_t TMessageLog::RecordCount() const
+{
+  return recordCount;
+}
+
+} // namespace wrp
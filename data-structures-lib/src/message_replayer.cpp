@@ -0,0 +1,206 @@
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "message_replayer.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+typedef std::chrono::steady_clock TClock;
+
+/* Sleeping is coarse, so the last part of the interval is spun */
+const std::chrono::microseconds SpinInterval(100);
+
+void WaitUntil(const TClock::time_point& time)
+{
+  TClock::time_point now = TClock::now();
+  if (time - now > 2 * SpinInterval)
+  {
+    std::this_thread::sleep_until(time - SpinInterval);
+  }
+  while (TClock::now() < time)
+  {
+  }
+}
+
+std::uint64_t Percentile(const std::vector<std::uint64_t>& sorted,
+  double fraction)
+{
+  if (sorted.empty())
+  {
+    return 0;
+  }
+  std::size_t rank = static_cast<std::size_t>(fraction * sorted.size());
+  return sorted[std::min(rank, sorted.size() - 1)];
+}
+
+void CopyData(TDataMessage& message)
+{
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    TPayloadSlice& data = message.entrances[i].data;
+    data = TPayloadSlice::Copy(data.Data(), data.Size());
+  }
+}
+
+} // namespace
+
+
+TReplayTarget::~TReplayTarget()
+{
+}
+
+void TReplayTarget::Flush()
+{
+}
+
+bool TReplayTarget::ModifiesData() const
+{
+  return false;
+}
+
+
+TPipeReplayTarget::TPipeReplayTarget(TPipeWriter& writer) :
+  writer(writer)
+{
+}
+
+void TPipeReplayTarget::Send(const TDataMessage& message)
+{
+  writer.Send(message);
+}
+
+void TPipeReplayTarget::Flush()
+{
+  writer.Flush();
+}
+
+
+TSharedMemoryReplayTarget::TSharedMemoryReplayTarget(
+  TSharedMemoryRing& ring) :
+  ring(ring)
+{
+}
+
+void TSharedMemoryReplayTarget::Send(const TDataMessage& message)
+{
+  ring.Send(message);
+}
+
+
+TFileReplayTarget::TFileReplayTarget(TFileWriter& writer) :
+  writer(writer)
+{
+}
+
+void TFileReplayTarget::Send(const TDataMessage& message)
+{
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    writer.Write(message.entrances[i].data);
+  }
+}
+
+void TFileReplayTarget::Flush()
+{
+  writer.Flush();
+}
+
+
+TReplayOptions::TReplayOptions() :
+  speed(0), passCount(1)
+{
+}
+
+
+TReplayReport::TReplayReport() :
+  messageCount(0), payloadSize(0), elapsedSeconds(0), latencyP50(0),
+  latencyP90(0), latencyP99(0), latencyP999(0), latencyMax(0)
+{
+}
+
+double TReplayReport::MessagesPerSecond() const
+{
+  return (elapsedSeconds > 0) ? messageCount / elapsedSeconds : 0;
+}
+
+double TReplayReport::BytesPerSecond() const
+{
+  return (elapsedSeconds > 0) ? payloadSize / elapsedSeconds : 0;
+}
+
+
+TReplayReport TMessageReplayer::Replay(TMessageLog& log,
+  TReplayTarget& target, const TReplayOptions& options)
+{
+  TReplayReport report;
+  std::vector<std::uint64_t> latencies;
+  latencies.reserve(static_cast<std::size_t>(log.RecordCount() *
+    options.passCount));
+
+  TDataMessage message(EMessageType::Data);
+  bool copyData = target.ModifiesData();
+  TClock::time_point start = TClock::now();
+  std::uint64_t passStart = 0;
+  for (std::size_t pass = 0; pass < options.passCount; ++pass)
+  {
+    log.Rewind();
+    std::uint64_t timestamp = 0;
+    std::uint64_t firstTimestamp = 0;
+    bool first = true;
+    while (log.Next(message, timestamp))
+    {
+      if (first)
+      {
+        firstTimestamp = timestamp;
+        first = false;
+      }
+      TClock::time_point scheduled = TClock::now();
+      if (options.speed > 0)
+      {
+        /* Passes follow each other without a gap */
+        double offset = (passStart + (timestamp - firstTimestamp)) /
+          options.speed;
+        scheduled = start + std::chrono::duration_cast<TClock::duration>(
+          std::chrono::duration<double, std::nano>(offset));
+        WaitUntil(scheduled);
+      }
+      if (copyData)
+      {
+        CopyData(message);
+      }
+      target.Send(message);
+      latencies.push_back(static_cast<std::uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(
+          TClock::now() - scheduled).count()));
+
+      ++report.messageCount;
+      for (std::size_t i = 0; i < message.entrances.size(); ++i)
+      {
+        report.payloadSize += message.entrances[i].data.Size();
+      }
+    }
+    passStart += timestamp - firstTimestamp;
+  }
+  target.Flush();
+  report.elapsedSeconds =
+    std::chrono::duration<double>(TClock::now() - start).count();
+
+  std::sort(latencies.begin(), latencies.end());
+  report.latencyP50 = Percentile(latencies, 0.5);
+  report.latencyP90 = Percentile(latencies, 0.9);
+  report.latencyP99 = Percentile(latencies, 0.99);
+  report.latencyP999 = Percentile(latencies, 0.999);
+  report.latencyMax = latencies.empty() ? 0 : latencies.back();
+  return report;
+}
+
+} // namespace wrp
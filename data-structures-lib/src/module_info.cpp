@@ -29,26 +29,26 @@ bool TModuleId::operator!=(const TModuleId& other) const
 
 
 TInputBatchInfo::TInputBatchInfo() :
-  sourceChannels(),
+  sourceChannelIds(),
   source(TModuleId::WorkflowIdUndefined),
-  channels(),
+  channelIds(),
   type(EInputBatchType::_undefined)
 {
 }
 
 TOutputBatchInfo::TOutputMessageChannelInfo::TOutputMessageChannelInfo() :
   receiver(TModuleId::WorkflowIdUndefined),
-  name(),
-  convertedName()
+  nameId(SymbolIdUndefined),
+  convertedNameId(SymbolIdUndefined)
 {
 }
 
 TOutputBatchInfo::TOutputMessageChannelInfo::TOutputMessageChannelInfo(
   const TModuleId::TWorkflowId& receiver,
-  const std::string& name, const std::string& convertedName) :
+  TSymbolId nameId, TSymbolId convertedNameId) :
   receiver(receiver),
-  name(name),
-  convertedName(convertedName)
+  nameId(nameId),
+  convertedNameId(convertedNameId)
 {
 }
 
@@ -61,12 +61,12 @@ TOutputBatchInfo::TOutputBatchInfo() :
 
 
 TModuleInfo::TModuleInfo() :
-  name(),
+  name(), nameId(SymbolIdUndefined),
   id(TModuleId::WorkflowIdUndefined, TModuleId::InstanceIdUndefined),
   executionType(EExecutionType::_undefined),
   transportType(ETransportType::_undefined),
   executablePath(), startCommandLineArgs(), stopCommandLine(),
-  parameters(), environmentVariables(),
+  parameters(), parameterNameIds(), environmentVariables(),
   inputFileName(), outputFileName(),
   isTransferable(false), hasState(false),
   stateFileName(), tempDirectoryPath(),
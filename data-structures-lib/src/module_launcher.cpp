@@ -0,0 +1,323 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <signal.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "module_launcher.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+char* PutString(char* pos, const std::string& value)
+{
+  std::memcpy(pos, value.c_str(), value.size() + 1);
+  return pos + value.size() + 1;
+}
+
+char* PutVariable(char* pos, const std::string& name,
+  const std::string& value)
+{
+  std::memcpy(pos, name.data(), name.size());
+  pos += name.size();
+  *pos++ = '=';
+  return PutString(pos, value);
+}
+
+struct TLaunchJob
+{
+  const TModuleLauncher* launcher;
+  const std::vector<std::size_t>* modules;
+  std::vector<TLaunchResult>* results;
+  std::atomic<std::size_t> next;
+};
+
+void LaunchWorker(TLaunchJob* job)
+{
+  for (;;)
+  {
+    std::size_t i = job->next.fetch_add(1);
+    if (i >= job->modules->size())
+    {
+      return;
+    }
+    (*job->results)[i] = job->launcher->Launch((*job->modules)[i]);
+  }
+}
+
+} // namespace
+
+
+TLaunchCommand::TLaunchCommand(const std::string& executablePath,
+  const std::vector<std::string>& arguments,
+  const std::map<std::string, std::string>& environmentVariables) :
+  strings(), argv(), envp()
+{
+  /* Inherited variables overridden by the module are dropped */
+  std::vector<const char*> inherited;
+#if defined(__linux__)
+  for (char** variable = environ; *variable != NULL; ++variable)
+  {
+    const char* separator = std::strchr(*variable, '=');
+    std::string name = (separator != NULL) ?
+      std::string(*variable, separator - *variable) :
+      std::string(*variable);
+    if (environmentVariables.find(name) == environmentVariables.end())
+    {
+      inherited.push_back(*variable);
+    }
+  }
+#endif
+
+  /* Buffer is sized first, so pointers into it stay valid */
+  std::size_t size = executablePath.size() + 1;
+  for (std::size_t i = 0; i < arguments.size(); ++i)
+  {
+    size += arguments[i].size() + 1;
+  }
+  for (std::size_t i = 0; i < inherited.size(); ++i)
+  {
+    size += std::strlen(inherited[i]) + 1;
+  }
+  for (std::map<std::string, std::string>::const_iterator it =
+    environmentVariables.begin(); it != environmentVariables.end(); ++it)
+  {
+    size += it->first.size() + it->second.size() + 2;
+  }
+  strings.resize(size);
+
+  char* pos = &strings[0];
+  argv.push_back(pos);
+  pos = PutString(pos, executablePath);
+  for (std::size_t i = 0; i < arguments.size(); ++i)
+  {
+    argv.push_back(pos);
+    pos = PutString(pos, arguments[i]);
+  }
+  argv.push_back(NULL);
+  for (std::size_t i = 0; i < inherited.size(); ++i)
+  {
+    envp.push_back(pos);
+    pos = PutString(pos, inherited[i]);
+  }
+  for (std::map<std::string, std::string>::const_iterator it =
+    environmentVariables.begin(); it != environmentVariables.end(); ++it)
+  {
+    envp.push_back(pos);
+    pos = PutVariable(pos, it->first, it->second);
+  }
+  envp.push_back(NULL);
+}
+
+const char* TLaunchCommand::ExecutablePath() const
+{
+  return argv[0];
+}
+
+char* const* TLaunchCommand::Argv() const
+{
+  return &argv[0];
+}
+
+char* const* TLaunchCommand::Envp() const
+{
+  return &envp[0];
+}
+
+
+TLaunchResult::TLaunchResult() :
+  module(0), processId(TModuleLauncher::NoProcess), error(0),
+  startupSeconds(0)
+{
+}
+
+
+const int TModuleLauncher::NoProcess;
+const std::size_t TModuleLauncher::DefaultThreadCount;
+
+TModuleLauncher::TModuleLauncher(const TWorkflowModel& model) :
+  commands(model.Size())
+{
+  for (std::size_t i = 0; i < model.Size(); ++i)
+  {
+    if (model.executionTypes[i] != EExecutionType::External)
+    {
+      continue;
+    }
+    const TModuleColdInfo& module = model.cold[i];
+    commands[i].reset(new TLaunchCommand(module.executablePath,
+      module.startCommandLineArgs, module.environmentVariables));
+  }
+}
+
+TModuleLauncher::~TModuleLauncher()
+{
+}
+
+bool TModuleLauncher::IsLaunchable(std::size_t module) const
+{
+  return (module < commands.size()) && commands[module];
+}
+
+const TLaunchCommand& TModuleLauncher::Command(std::size_t module) const
+{
+  if (!IsLaunchable(module))
+  {
+    std::stringstream info;
+    info << "Module " << module << " is not an external module.";
+    throw std::runtime_error(info.str());
+  }
+  return *commands[module];
+}
+
+TLaunchResult TModuleLauncher::Launch(std::size_t module) const
+{
+  TLaunchResult result;
+  result.module = module;
+  Spawn(Command(module), result);
+  return result;
+}
+
+std::vector<TLaunchResult> TModuleLauncher::Launch(
+  const std::vector<std::size_t>& modules, std::size_t threadCount) const
+{
+  for (std::size_t i = 0; i < modules.size(); ++i)
+  {
+    Command(modules[i]);
+  }
+  std::vector<TLaunchResult> results(modules.size());
+  TLaunchJob job;
+  job.launcher = this;
+  job.modules = &modules;
+  job.results = &results;
+  job.next = 0;
+
+  /* Each spawn blocks only its caller until exec, so threads overlap */
+  threadCount = std::min(std::max<std::size_t>(threadCount, 1),
+    std::max<std::size_t>(modules.size(), 1));
+  std::vector<std::thread> threads;
+  for (std::size_t i = 1; i < threadCount; ++i)
+  {
+    threads.push_back(std::thread(LaunchWorker, &job));
+  }
+  LaunchWorker(&job);
+  for (std::size_t i = 0; i < threads.size(); ++i)
+  {
+    threads[i].join();
+  }
+  return results;
+}
+
+void TModuleLauncher::Spawn(const TLaunchCommand& command,
+  TLaunchResult& result)
+{
+  Spawn(command, result, -1, -1);
+}
+
+void TModuleLauncher::Spawn(const TLaunchCommand& command,
+  TLaunchResult& result, int descriptor, int childDescriptor)
+{
+#if defined(__linux__)
+  /* dup2 onto itself would keep FD_CLOEXEC, so a copy is passed instead */
+  int copy = -1;
+  if ((descriptor >= 0) && (descriptor == childDescriptor))
+  {
+    copy = fcntl(descriptor, F_DUPFD_CLOEXEC, childDescriptor + 1);
+    if (copy < 0)
+    {
+      result.error = errno;
+      result.processId = NoProcess;
+      return;
+    }
+    descriptor = copy;
+  }
+  posix_spawn_file_actions_t actions;
+  posix_spawn_file_actions_init(&actions);
+  if (descriptor >= 0)
+  {
+    posix_spawn_file_actions_adddup2(&actions, descriptor, childDescriptor);
+  }
+
+  posix_spawnattr_t attributes;
+  posix_spawnattr_init(&attributes);
+  short flags = POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF;
+#if defined(POSIX_SPAWN_USEVFORK)
+  flags |= POSIX_SPAWN_USEVFORK;
+#endif
+  posix_spawnattr_setflags(&attributes, flags);
+  sigset_t signals;
+  sigemptyset(&signals);
+  posix_spawnattr_setsigmask(&attributes, &signals);
+  sigaddset(&signals, SIGPIPE);
+  posix_spawnattr_setsigdefault(&attributes, &signals);
+
+  std::chrono::steady_clock::time_point start =
+    std::chrono::steady_clock::now();
+  pid_t processId = 0;
+  int error = posix_spawnp(&processId, command.ExecutablePath(), &actions,
+    &attributes, command.Argv(), command.Envp());
+  result.startupSeconds = std::chrono::duration<double>(
+    std::chrono::steady_clock::now() - start).count();
+  posix_spawnattr_destroy(&attributes);
+  posix_spawn_file_actions_destroy(&actions);
+  if (copy >= 0)
+  {
+    close(copy);
+  }
+
+  result.error = error;
+  result.processId = (error == 0) ? static_cast<int>(processId) : NoProcess;
+#else
+  (void)command;
+  (void)descriptor;
+  (void)childDescriptor;
+  result.error = ENOSYS;
+  result.processId = NoProcess;
+#endif
+}
+
+int TModuleLauncher::Wait(int processId)
+{
+#if defined(__linux__)
+  int status = 0;
+  while (waitpid(static_cast<pid_t>(processId), &status, 0) < 0)
+  {
+    if (errno != EINTR)
+    {
+      std::stringstream info;
+      info << "Can't wait for process " << processId << ": " <<
+        std::strerror(errno) << ".";
+      throw std::runtime_error(info.str());
+    }
+  }
+  return WIFEXITED(status) ? WEXITSTATUS(status) : -1;
+#else
+  (void)processId;
+  std::stringstream info;
+  info << "Can't wait for process: not supported.";
+  throw std::runtime_error(info.str());
+#endif
+}
+
+} // namespace wrp
@@ -0,0 +1,421 @@
+#include <cerrno>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if defined(__linux__)
+#include <signal.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+#include "module_worker_pool.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+void PutString(std::string& output, const std::string& value)
+{
+  output.append(value);
+  output.push_back('\0');
+}
+
+} // namespace
+
+
+const char* const TWarmAssignment::DescriptorVariable = "WRP_WARM_FD";
+const int TWarmAssignment::Descriptor;
+
+TWarmAssignment::TWarmAssignment() :
+  environmentVariables(), inputFileName(), outputFileName()
+{
+}
+
+bool TWarmAssignment::Receive(TWarmAssignment& assignment)
+{
+#if defined(__linux__)
+  const char* value = std::getenv(DescriptorVariable);
+  if (value == NULL)
+  {
+    return false;
+  }
+  int descriptor = std::atoi(value);
+  unsetenv(DescriptorVariable);
+
+  /* Pool closes its end after the assignment, so it is read up to EOF */
+  std::string data;
+  char buffer[4096];
+  for (;;)
+  {
+    ssize_t size = read(descriptor, buffer, sizeof(buffer));
+    if (size > 0)
+    {
+      data.append(buffer, static_cast<std::size_t>(size));
+    }
+    else if (size == 0)
+    {
+      break;
+    }
+    else if (errno != EINTR)
+    {
+      int error = errno;
+      close(descriptor);
+      std::stringstream info;
+      info << "Can't read warm assignment: " << std::strerror(error) << ".";
+      throw std::runtime_error(info.str());
+    }
+  }
+  close(descriptor);
+
+  std::vector<std::string> fields;
+  std::size_t begin = 0;
+  for (std::size_t end = data.find('\0'); end != std::string::npos;
+    end = data.find('\0', begin))
+  {
+    fields.push_back(data.substr(begin, end - begin));
+    begin = end + 1;
+  }
+  if (data.empty())
+  {
+    std::stringstream info;
+    info << "Worker pool closed the warm assignment descriptor.";
+    throw std::runtime_error(info.str());
+  }
+  if ((begin != data.size()) || (fields.size() < 2) ||
+    (fields.size() % 2 != 0))
+  {
+    std::stringstream info;
+    info << "Corrupted warm assignment.";
+    throw std::runtime_error(info.str());
+  }
+
+  assignment.inputFileName = fields[0];
+  assignment.outputFileName = fields[1];
+  assignment.environmentVariables.clear();
+  for (std::size_t i = 2; i < fields.size(); i += 2)
+  {
+    assignment.environmentVariables[fields[i]] = fields[i + 1];
+    setenv(fields[i].c_str(), fields[i + 1].c_str(), 1);
+  }
+  return true;
+#else
+  (void)assignment;
+  return false;
+#endif
+}
+
+
+const std::size_t TWorkerPoolOptions::DefaultIdleCount;
+
+TWorkerPoolOptions::TWorkerPoolOptions(std::size_t idleCount,
+  double idleSeconds) :
+  idleCount(idleCount), idleSeconds(idleSeconds)
+{
+}
+
+
+const std::size_t TModuleWorkerPool::NoGroup;
+
+TModuleWorkerPool::TModuleWorkerPool(const TWorkflowModel& model,
+  const std::vector<std::size_t>& modules,
+  const TWorkerPoolOptions& options) :
+  options(options), groups(), moduleGroups(model.Size(), NoGroup),
+  assignments(model.Size()), mutex(), warmStartCount(0), coldStartCount(0)
+{
+  std::map<std::string, std::string> warmVariables;
+  std::stringstream descriptor;
+  descriptor << TWarmAssignment::Descriptor;
+  warmVariables[TWarmAssignment::DescriptorVariable] = descriptor.str();
+
+  /* Modules differing only in per-run parameters share a group */
+  std::map<std::string, std::size_t> groupIndexes;
+  for (std::size_t i = 0; i < modules.size(); ++i)
+  {
+    std::size_t module = modules[i];
+    if ((module >= model.Size()) ||
+      (model.executionTypes[module] != EExecutionType::External))
+    {
+      std::stringstream info;
+      info << "Module " << module << " is not an external module.";
+      throw std::runtime_error(info.str());
+    }
+    const TModuleColdInfo& info = model.cold[module];
+    std::string key;
+    PutString(key, info.executablePath);
+    for (std::size_t j = 0; j < info.startCommandLineArgs.size(); ++j)
+    {
+      PutString(key, info.startCommandLineArgs[j]);
+    }
+
+    std::map<std::string, std::size_t>::iterator found =
+      groupIndexes.find(key);
+    if (found == groupIndexes.end())
+    {
+      found = groupIndexes.insert(std::make_pair(key, groups.size())).first;
+      groups.push_back(std::unique_ptr<TWorkerGroup>(new TWorkerGroup()));
+      groups.back()->command.reset(new TLaunchCommand(info.executablePath,
+        info.startCommandLineArgs, warmVariables));
+      groups.back()->lastUse = TClock::now();
+    }
+    moduleGroups[module] = found->second;
+    assignments[module].environmentVariables = info.environmentVariables;
+    assignments[module].inputFileName = info.inputFileName;
+    assignments[module].outputFileName = info.outputFileName;
+  }
+}
+
+TModuleWorkerPool::~TModuleWorkerPool()
+{
+  for (std::size_t i = 0; i < groups.size(); ++i)
+  {
+    for (std::size_t j = 0; j < groups[i]->idle.size(); ++j)
+    {
+      StopWorker(groups[i]->idle[j]);
+    }
+  }
+}
+
+bool TModuleWorkerPool::IsPooled(std::size_t module) const
+{
+  return (module < moduleGroups.size()) && (moduleGroups[module] != NoGroup);
+}
+
+TLaunchResult TModuleWorkerPool::Start(std::size_t module)
+{
+  if (!IsPooled(module))
+  {
+    std::stringstream info;
+    info << "Module " << module << " is not in the worker pool.";
+    throw std::runtime_error(info.str());
+  }
+  return Start(module, assignments[module]);
+}
+
+TLaunchResult TModuleWorkerPool::Start(std::size_t module,
+  const TWarmAssignment& assignment)
+{
+  if (!IsPooled(module))
+  {
+    std::stringstream info;
+    info << "Module " << module << " is not in the worker pool.";
+    throw std::runtime_error(info.str());
+  }
+  TClock::time_point start = TClock::now();
+  TLaunchResult result;
+  result.module = module;
+  TWorkerGroup& group = *groups[moduleGroups[module]];
+
+  std::unique_lock<std::mutex> lock(mutex);
+  group.lastUse = start;
+  while (!group.idle.empty())
+  {
+    TWorker worker = group.idle.front();
+    group.idle.pop_front();
+    if (Assign(worker, assignment))
+    {
+      ++warmStartCount;
+      lock.unlock();
+      result.processId = worker.processId;
+      result.startupSeconds =
+        std::chrono::duration<double>(TClock::now() - start).count();
+      return result;
+    }
+    /* Worker has exited while waiting */
+    StopWorker(worker);
+  }
+  ++coldStartCount;
+  lock.unlock();
+
+  TWorker worker;
+  if (!SpawnWorker(*group.command, worker, result.error))
+  {
+    return result;
+  }
+  if (!Assign(worker, assignment))
+  {
+    result.error = EPIPE;
+    StopWorker(worker);
+    return result;
+  }
+  result.processId = worker.processId;
+  result.startupSeconds =
+    std::chrono::duration<double>(TClock::now() - start).count();
+  return result;
+}
+
+void TModuleWorkerPool::Maintain()
+{
+#if defined(__linux__)
+  std::lock_guard<std::mutex> lock(mutex);
+  TClock::time_point now = TClock::now();
+  for (std::size_t i = 0; i < groups.size(); ++i)
+  {
+    TWorkerGroup& group = *groups[i];
+    for (std::deque<TWorker>::iterator it = group.idle.begin();
+      it != group.idle.end(); )
+    {
+      int status = 0;
+      if (waitpid(static_cast<pid_t>(it->processId), &status, WNOHANG) ==
+        it->processId)
+      {
+        close(it->socket);
+        it = group.idle.erase(it);
+      }
+      else
+      {
+        ++it;
+      }
+    }
+
+    if (std::chrono::duration<double>(now - group.lastUse).count() >
+      options.idleSeconds)
+    {
+      for (std::size_t j = 0; j < group.idle.size(); ++j)
+      {
+        StopWorker(group.idle[j]);
+      }
+      group.idle.clear();
+      continue;
+    }
+    while (group.idle.size() < options.idleCount)
+    {
+      TWorker worker;
+      int error = 0;
+      if (!SpawnWorker(*group.command, worker, error))
+      {
+        /* Start reports the error when the module is requested */
+        break;
+      }
+      group.idle.push_back(worker);
+    }
+  }
+#endif
+}
+
+std::size_t TModuleWorkerPool::IdleCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  std::size_t count = 0;
+  for (std::size_t i = 0; i < groups.size(); ++i)
+  {
+    count += groups[i]->idle.size();
+  }
+  return count;
+}
+
+std::uint64_t TModuleWorkerPool::WarmStartCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return warmStartCount;
+}
+
+std::uint64_t TModuleWorkerPool::ColdStartCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return coldStartCount;
+}
+
+bool TModuleWorkerPool::SpawnWorker(const TLaunchCommand& command,
+  TWorker& worker, int& error)
+{
+#if defined(__linux__)
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets) < 0)
+  {
+    error = errno;
+    return false;
+  }
+  TLaunchResult result;
+  TModuleLauncher::Spawn(command, result, sockets[1],
+    TWarmAssignment::Descriptor);
+  close(sockets[1]);
+  if (result.error != 0)
+  {
+    close(sockets[0]);
+    error = result.error;
+    return false;
+  }
+  worker.processId = result.processId;
+  worker.socket = sockets[0];
+  return true;
+#else
+  (void)command;
+  (void)worker;
+  error = ENOSYS;
+  return false;
+#endif
+}
+
+void TModuleWorkerPool::StopWorker(const TWorker& worker)
+{
+#if defined(__linux__)
+  /* Killed before the socket is closed, so the worker never sees EOF */
+  kill(static_cast<pid_t>(worker.processId), SIGKILL);
+  close(worker.socket);
+  while ((waitpid(static_cast<pid_t>(worker.processId), NULL, 0) < 0) &&
+    (errno == EINTR))
+  {
+  }
+#else
+  (void)worker;
+#endif
+}
+
+bool TModuleWorkerPool::Assign(const TWorker& worker,
+  const TWarmAssignment& assignment)
+{
+#if defined(__linux__)
+  std::string data;
+  PutString(data, assignment.inputFileName);
+  PutString(data, assignment.outputFileName);
+  for (std::map<std::string, std::string>::const_iterator it =
+    assignment.environmentVariables.begin();
+    it != assignment.environmentVariables.end(); ++it)
+  {
+    PutString(data, it->first);
+    PutString(data, it->second);
+  }
+
+  /* MSG_NOSIGNAL: a worker that has exited must not raise SIGPIPE here */
+  std::size_t sent = 0;
+  while (sent < data.size())
+  {
+    ssize_t size = send(worker.socket, data.data() + sent,
+      data.size() - sent, MSG_NOSIGNAL);
+    if (size < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      return false;
+    }
+    sent += static_cast<std::size_t>(size);
+  }
+  /* EOF marks the end of the assignment; the worker owns its end now */
+  close(worker.socket);
+  return true;
+#else
+  (void)worker;
+  (void)assignment;
+  return false;
+#endif
+}
+
+} // namespace wrp
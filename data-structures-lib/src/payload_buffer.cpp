@@ -0,0 +1,121 @@
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+
+#include "payload_buffer.h"
+
+
+namespace wrp
+{
+
+TPayloadBuffer::TPayloadBuffer(std::size_t size) :
+  data(NULL), size(size), release(NULL)
+{
+  if (size > 0)
+  {
+    data = new char[size];
+  }
+}
+
+TPayloadBuffer::TPayloadBuffer(const char* data, std::size_t size) :
+  data(NULL), size(size), release(NULL)
+{
+  if (size > 0)
+  {
+    this->data = new char[size];
+    std::memcpy(this->data, data, size);
+  }
+}
+
+TPayloadBuffer::TPayloadBuffer(char* data, std::size_t size,
+  TRelease release) :
+  data(data), size(size), release(release)
+{
+}
+
+TPayloadBuffer::~TPayloadBuffer()
+{
+  if (release != NULL)
+  {
+    release(data, size);
+    return;
+  }
+  delete[] data;
+}
+
+char* TPayloadBuffer::Data()
+{
+  return data;
+}
+
+const char* TPayloadBuffer::Data() const
+{
+  return data;
+}
+
+std::size_t TPayloadBuffer::Size() const
+{
+  return size;
+}
+
+
+TPayloadSlice::TPayloadSlice() :
+  buffer(), offset(0), length(0)
+{
+}
+
+TPayloadSlice::TPayloadSlice(const TPayloadBufferPtr& buffer,
+  std::size_t offset, std::size_t length) :
+  buffer(buffer), offset(offset), length(length)
+{
+  std::size_t bufferSize = buffer ? buffer->Size() : 0;
+  if ((offset > bufferSize) || (length > bufferSize - offset))
+  {
+    std::stringstream info;
+    info << "Payload slice [" << offset << ", " << offset + length <<
+      ") is out of buffer with '" << bufferSize << "' size.";
+    throw std::runtime_error(info.str());
+  }
+}
+
+TPayloadSlice::TPayloadSlice(const TPayloadBufferPtr& buffer) :
+  buffer(buffer), offset(0), length(buffer ? buffer->Size() : 0)
+{
+}
+
+TPayloadSlice TPayloadSlice::Slice(std::size_t offset,
+  std::size_t length) const
+{
+  if ((offset > this->length) || (length > this->length - offset))
+  {
+    std::stringstream info;
+    info << "Nested payload slice [" << offset << ", " << offset + length <<
+      ") is out of slice with '" << this->length << "' size.";
+    throw std::runtime_error(info.str());
+  }
+  return TPayloadSlice(buffer, this->offset + offset, length);
+}
+
+const char* TPayloadSlice::Data() const
+{
+  return buffer ? buffer->Data() + offset : NULL;
+}
+
+std::size_t TPayloadSlice::Size() const
+{
+  return length;
+}
+
+bool TPayloadSlice::Empty() const
+{
+  return length == 0;
+}
+
+TPayloadSlice TPayloadSlice::Copy(const char* data, std::size_t size)
+{
+  return TPayloadSlice(std::make_shared<TPayloadBuffer>(data, size));
+}
+
+} // namespace wrp
@@ -0,0 +1,597 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "message_codec.h"
+#include "pipe_transport.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+const std::size_t HeadChunkSize = 64 * 1024;
+
+#if defined(__linux__)
+const std::size_t MaxIovCount = 1024;
+
+void ThrowSystemError(const char* call)
+{
+  int error = errno;
+  std::stringstream info;
+  info << "Pipe transport: " << call << " failed: " << std::strerror(error) <<
+    ".";
+  throw std::runtime_error(info.str());
+}
+
+/* Returns the resulting capacity; the default one is kept on failure */
+std::size_t SetPipeSize(int fd, std::size_t size)
+{
+  if (size > 0)
+  {
+    fcntl(fd, F_SETPIPE_SZ, static_cast<int>(size));
+  }
+  int pipeSize = fcntl(fd, F_GETPIPE_SZ);
+  if (pipeSize < 0)
+  {
+    ThrowSystemError("fcntl(F_GETPIPE_SZ)");
+  }
+  return static_cast<std::size_t>(pipeSize);
+}
+
+void WaitDescriptor(int fd, short events)
+{
+  pollfd descriptor;
+  descriptor.fd = fd;
+  descriptor.events = events;
+  descriptor.revents = 0;
+  while (poll(&descriptor, 1, -1) < 0)
+  {
+    if (errno != EINTR)
+    {
+      ThrowSystemError("poll");
+    }
+  }
+}
+#else
+void ThrowNotSupported()
+{
+  std::stringstream info;
+  info << "Pipe transport is supported only on Linux.";
+  throw std::runtime_error(info.str());
+}
+#endif
+
+} // namespace
+
+
+TPipeTransportOptions::TPipeTransportOptions() :
+  pipeSize(1024 * 1024),
+  copyThreshold(512),
+  spliceThreshold(64 * 1024),
+  autoFlush(true),
+  maxPendingSize(4 * 1024 * 1024),
+  readChunkSize(256 * 1024)
+{
+}
+
+
+TPipeWriter::TPipeWriter(int fd, const TPipeTransportOptions& options) :
+  fd(fd), fdFlags(0), options(options), pipeSize(0), pending(),
+  pendingSize(0), headChunk(), headChunkUsed(0), spliced(), writtenSize(0),
+  splicedSize(0), writeCallCount(0), mutex(), flusher(), wakeFd(-1),
+  flusherWaiting(false), stopping(false), flushError()
+{
+#if defined(__linux__)
+  fdFlags = fcntl(fd, F_GETFL);
+  if ((fdFlags < 0) || (fcntl(fd, F_SETFL, fdFlags | O_NONBLOCK) < 0))
+  {
+    ThrowSystemError("fcntl(F_SETFL)");
+  }
+  try
+  {
+    pipeSize = SetPipeSize(fd, options.pipeSize);
+    if (options.autoFlush)
+    {
+      wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+      if (wakeFd < 0)
+      {
+        ThrowSystemError("eventfd");
+      }
+      flusher = std::thread(&TPipeWriter::RunFlusher, this);
+    }
+  }
+  catch (...)
+  {
+    if (wakeFd >= 0)
+    {
+      close(wakeFd);
+    }
+    fcntl(fd, F_SETFL, fdFlags);
+    throw;
+  }
+#else
+  ThrowNotSupported();
+#endif
+}
+
+TPipeWriter::~TPipeWriter()
+{
+#if defined(__linux__)
+  if (flusher.joinable())
+  {
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      stopping = true;
+    }
+    std::uint64_t one = 1;
+    if (write(wakeFd, &one, sizeof(one)) < 0)
+    {
+      /* The counter can't overflow, the flusher wakes up in any case */
+    }
+    flusher.join();
+    close(wakeFd);
+  }
+  /* A reader that stopped reading must not block the destructor */
+  try
+  {
+    TryFlushLocked();
+  }
+  catch (...)
+  {
+  }
+  fcntl(fd, F_SETFL, fdFlags);
+#endif
+}
+
+void TPipeWriter::Send(const TDataMessage& message)
+{
+  std::unique_lock<std::mutex> lock(mutex);
+  CheckFlushError();
+  bool backlog = !pending.empty();
+  std::size_t headSize = TDataMessageCodec::HeadSize(message);
+  TDataMessageCodec::EncodeHead(message, ReserveHead(headSize), headSize);
+  CommitHead(headSize);
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    const TPayloadSlice& data = message.entrances[i].data;
+    if (data.Size() < options.copyThreshold)
+    {
+      if (!data.Empty())
+      {
+        std::memcpy(ReserveHead(data.Size()), data.Data(), data.Size());
+        CommitHead(data.Size());
+      }
+    }
+    else
+    {
+      pending.push_back(data);
+      pendingSize += data.Size();
+    }
+  }
+
+  /* A backlog means the pipe was full. The flusher writes it as soon as
+     the pipe polls writable, so that messages queued meanwhile go out in
+     one call instead of a failed call per message */
+  if ((backlog && flusher.joinable()) || !TryFlushLocked())
+  {
+    WakeFlusher();
+  }
+  while (pendingSize > options.maxPendingSize)
+  {
+    lock.unlock();
+    WaitWritable();
+    lock.lock();
+    CheckFlushError();
+    TryFlushLocked();
+  }
+}
+
+bool TPipeWriter::TryFlush()
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  CheckFlushError();
+  return TryFlushLocked();
+}
+
+bool TPipeWriter::TryFlushLocked()
+{
+#if defined(__linux__)
+  while (!pending.empty())
+  {
+    const TPayloadSlice& front = pending.front();
+    ssize_t count = 0;
+    if (front.Size() >= options.spliceThreshold)
+    {
+      iovec vector;
+      vector.iov_base = const_cast<char*>(front.Data());
+      vector.iov_len = front.Size();
+      count = vmsplice(fd, &vector, 1, SPLICE_F_NONBLOCK);
+      if (count > 0)
+      {
+        TSplicedBuffer splicedBuffer;
+        splicedBuffer.buffer = front.buffer;
+        splicedBuffer.endPosition = writtenSize + count;
+        spliced.push_back(splicedBuffer);
+        splicedSize += count;
+      }
+    }
+    else
+    {
+      /* Gathering everything up to the next spliced fragment */
+      iovec vectors[MaxIovCount];
+      int vectorCount = 0;
+      for (std::deque<TPayloadSlice>::const_iterator it = pending.begin();
+        (it != pending.end()) && (vectorCount < static_cast<int>(MaxIovCount))
+        && (it->Size() < options.spliceThreshold); ++it)
+      {
+        vectors[vectorCount].iov_base = const_cast<char*>(it->Data());
+        vectors[vectorCount].iov_len = it->Size();
+        ++vectorCount;
+      }
+      count = writev(fd, vectors, vectorCount);
+    }
+    ++writeCallCount;
+
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      {
+        ReleaseSpliced();
+        return false;
+      }
+      ThrowSystemError("write to pipe");
+    }
+    writtenSize += count;
+    Consume(static_cast<std::size_t>(count));
+  }
+  ReleaseSpliced();
+  return true;
+#else
+  return pending.empty();
+#endif
+}
+
+void TPipeWriter::Flush()
+{
+  while (!TryFlush())
+  {
+    WaitWritable();
+  }
+}
+
+void TPipeWriter::Close()
+{
+#if defined(__linux__)
+  Flush();
+  /* Spliced pages must stay intact until the reader consumes them */
+  std::unique_lock<std::mutex> lock(mutex);
+  ReleaseSpliced();
+  while (!spliced.empty())
+  {
+    pollfd descriptor;
+    descriptor.fd = fd;
+    descriptor.events = POLLOUT;
+    descriptor.revents = 0;
+    if ((poll(&descriptor, 1, 0) > 0) && (descriptor.revents & POLLERR))
+    {
+      spliced.clear();
+      break;
+    }
+    lock.unlock();
+    poll(NULL, 0, 1);
+    lock.lock();
+    ReleaseSpliced();
+  }
+#endif
+}
+
+std::size_t TPipeWriter::PendingSize() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return pendingSize;
+}
+
+std::size_t TPipeWriter::PipeSize() const
+{
+  return pipeSize;
+}
+
+std::size_t TPipeWriter::WriteCallCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return writeCallCount;
+}
+
+std::uint64_t TPipeWriter::SplicedSize() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return splicedSize;
+}
+
+void TPipeWriter::CheckFlushError()
+{
+  if (flushError)
+  {
+    std::rethrow_exception(flushError);
+  }
+}
+
+void TPipeWriter::WakeFlusher()
+{
+#if defined(__linux__)
+  if (!flusher.joinable() || flusherWaiting || pending.empty())
+  {
+    return;
+  }
+  /* The flusher is waiting for the wakeup only, it has to poll the pipe */
+  flusherWaiting = true;
+  std::uint64_t one = 1;
+  if (write(wakeFd, &one, sizeof(one)) < 0)
+  {
+    ThrowSystemError("write to eventfd");
+  }
+#endif
+}
+
+void TPipeWriter::RunFlusher()
+{
+#if defined(__linux__)
+  std::unique_lock<std::mutex> lock(mutex);
+  while (!stopping)
+  {
+    pollfd descriptors[2];
+    descriptors[0].fd = wakeFd;
+    descriptors[0].events = POLLIN;
+    descriptors[0].revents = 0;
+    descriptors[1].fd = fd;
+    descriptors[1].events = flusherWaiting ? POLLOUT : 0;
+    descriptors[1].revents = 0;
+    lock.unlock();
+    int count = poll(descriptors, 2, -1);
+    lock.lock();
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      flushError = std::make_exception_ptr(std::runtime_error(
+        "Pipe transport: poll failed in the flusher."));
+      break;
+    }
+    if (descriptors[0].revents & POLLIN)
+    {
+      std::uint64_t value = 0;
+      if (read(wakeFd, &value, sizeof(value)) < 0)
+      {
+        /* Another wakeup has already reset the counter */
+      }
+    }
+    if (stopping || !flusherWaiting ||
+      !(descriptors[1].revents & (POLLOUT | POLLERR)))
+    {
+      continue;
+    }
+    try
+    {
+      flusherWaiting = !TryFlushLocked();
+    }
+    catch (...)
+    {
+      flushError = std::current_exception();
+      flusherWaiting = false;
+      break;
+    }
+  }
+#endif
+}
+
+char* TPipeWriter::ReserveHead(std::size_t size)
+{
+  if (!headChunk || (headChunk->Size() - headChunkUsed < size))
+  {
+    headChunk = std::make_shared<TPayloadBuffer>(
+      std::max(HeadChunkSize, size));
+    headChunkUsed = 0;
+  }
+  return headChunk->Data() + headChunkUsed;
+}
+
+void TPipeWriter::CommitHead(std::size_t size)
+{
+  if (size == 0)
+  {
+    return;
+  }
+  /* Adjacent heads and copied fragments are sent as one vector */
+  if (!pending.empty() && (pending.back().buffer == headChunk) &&
+    (pending.back().offset + pending.back().length == headChunkUsed) &&
+    (pending.back().length + size < options.spliceThreshold))
+  {
+    pending.back().length += size;
+  }
+  else
+  {
+    pending.push_back(TPayloadSlice(headChunk, headChunkUsed, size));
+  }
+  headChunkUsed += size;
+  pendingSize += size;
+}
+
+void TPipeWriter::Consume(std::size_t size)
+{
+  while (size > 0)
+  {
+    TPayloadSlice& front = pending.front();
+    if (size < front.length)
+    {
+      front.offset += size;
+      front.length -= size;
+      pendingSize -= size;
+      break;
+    }
+    size -= front.length;
+    pendingSize -= front.length;
+    pending.pop_front();
+  }
+  if (pending.empty())
+  {
+    if (headChunk && (headChunk.use_count() == 1))
+    {
+      headChunkUsed = 0;
+    }
+  }
+}
+
+void TPipeWriter::ReleaseSpliced()
+{
+#if defined(__linux__)
+  if (spliced.empty())
+  {
+    return;
+  }
+  int unreadSize = 0;
+  if (ioctl(fd, FIONREAD, &unreadSize) < 0)
+  {
+    return;
+  }
+  std::uint64_t readSize = writtenSize - static_cast<std::uint64_t>(unreadSize);
+  while (!spliced.empty() && (spliced.front().endPosition <= readSize))
+  {
+    spliced.pop_front();
+  }
+#endif
+}
+
+void TPipeWriter::WaitWritable()
+{
+#if defined(__linux__)
+  WaitDescriptor(fd, POLLOUT);
+#endif
+}
+
+
+TPipeReader::TPipeReader(int fd, const TPipeTransportOptions& options) :
+  fd(fd), chunkSize(options.readChunkSize), chunk(), begin(0), end(0),
+  readCallCount(0)
+{
+#if defined(__linux__)
+  SetPipeSize(fd, options.pipeSize);
+#else
+  ThrowNotSupported();
+#endif
+}
+
+bool TPipeReader::Receive(TDataMessage& message)
+{
+  if (!Fill(TWireHeader::Size))
+  {
+    return false;
+  }
+  TWireHeader header;
+  TDataMessageCodec::DecodeHeader(chunk->Data() + begin, end - begin, header);
+  std::size_t messageSize = header.MessageSize();
+  Fill(messageSize);
+  begin += TDataMessageCodec::Decode(TPayloadSlice(chunk, begin, messageSize),
+    message);
+  return true;
+}
+
+std::size_t TPipeReader::ReadCallCount() const
+{
+  return readCallCount;
+}
+
+bool TPipeReader::Fill(std::size_t size)
+{
+  if (end - begin >= size)
+  {
+    return true;
+  }
+
+  /* Chunk which is referenced by received messages is never overwritten */
+  bool unique = chunk && (chunk.use_count() == 1);
+  if (unique && (begin == end))
+  {
+    begin = end = 0;
+  }
+  if (!chunk || (chunk->Size() - begin < size))
+  {
+    if (unique && (chunk->Size() >= size))
+    {
+      std::memmove(chunk->Data(), chunk->Data() + begin, end - begin);
+    }
+    else
+    {
+      TPayloadBufferPtr newChunk =
+        std::make_shared<TPayloadBuffer>(std::max(chunkSize, size));
+      if (end > begin)
+      {
+        std::memcpy(newChunk->Data(), chunk->Data() + begin, end - begin);
+      }
+      chunk = newChunk;
+    }
+    end -= begin;
+    begin = 0;
+  }
+
+#if defined(__linux__)
+  while (end - begin < size)
+  {
+    ssize_t count = read(fd, chunk->Data() + end, chunk->Size() - end);
+    ++readCallCount;
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      if ((errno == EAGAIN) || (errno == EWOULDBLOCK))
+      {
+        WaitDescriptor(fd, POLLIN);
+        continue;
+      }
+      ThrowSystemError("read from pipe");
+    }
+    if (count == 0)
+    {
+      if (end == begin)
+      {
+        return false;
+      }
+      std::stringstream info;
+      info << "Pipe is closed in the middle of data message.";
+      throw std::runtime_error(info.str());
+    }
+    end += static_cast<std::size_t>(count);
+  }
+#endif
+  return true;
+}
+
+} // namespace wrp
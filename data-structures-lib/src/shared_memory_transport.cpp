@@ -0,0 +1,418 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include "message_codec.h"
+#include "shared_memory_transport.h"
+
+
+namespace wrp
+{
+
+/** Control block which is placed at the start of the shared memory.
+ *
+ */
+struct TSharedMemoryRing::TControl
+{
+  std::uint64_t magic;
+  std::uint64_t capacity;
+
+  /** Written only by the writer.
+   *
+   */
+  alignas(64) std::atomic<std::uint64_t> head;
+
+  /** Written only by the reader.
+   *
+   */
+  alignas(64) std::atomic<std::uint64_t> tail;
+
+  /** Futex words: non-zero while the side sleeps.
+   *
+   */
+  alignas(64) std::atomic<std::uint32_t> readerWaiting;
+  std::atomic<std::uint32_t> writerWaiting;
+  std::atomic<std::uint32_t> closed;
+};
+
+namespace
+{
+
+const std::uint64_t RingMagic = 0x31474E4952505257ULL; /* "WRPRING1" */
+
+/* Data area starts on a separate page */
+const std::size_t ControlSize = 4096;
+
+const std::size_t MinCapacity = 4096;
+const std::size_t MaxCapacity = std::size_t(1) << 30;
+
+/* Record: 32-bit size, 32-bit reserved, message aligned to 8 bytes */
+const std::size_t RecordHeaderSize = 8;
+const std::uint32_t PaddingMark = 0xFFFFFFFF;
+
+/* Spinning is useless when the other side can't run at the same time */
+const unsigned int SpinCount =
+  (std::thread::hardware_concurrency() > 1) ? 1024 : 0;
+
+std::size_t RecordSize(std::size_t messageSize)
+{
+  return (RecordHeaderSize + messageSize + 7) & ~std::size_t(7);
+}
+
+inline void CpuRelax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+  __builtin_ia32_pause();
+#elif defined(__aarch64__)
+  asm volatile("yield");
+#endif
+}
+
+#if defined(__linux__)
+void ThrowSystemError(const char* call)
+{
+  int error = errno;
+  std::stringstream info;
+  info << "Shared memory transport: " << call << " failed: " <<
+    std::strerror(error) << ".";
+  throw std::runtime_error(info.str());
+}
+
+void FutexWait(std::atomic<std::uint32_t>& word, std::uint32_t value)
+{
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAIT,
+    value, NULL, NULL, 0);
+}
+
+void FutexWake(std::atomic<std::uint32_t>& word)
+{
+  syscall(SYS_futex, reinterpret_cast<std::uint32_t*>(&word), FUTEX_WAKE,
+    1, NULL, NULL, 0);
+}
+#else
+void ThrowNotSupported()
+{
+  std::stringstream info;
+  info << "Shared memory transport is supported only on Linux.";
+  throw std::runtime_error(info.str());
+}
+
+void FutexWait(std::atomic<std::uint32_t>&, std::uint32_t)
+{
+}
+
+void FutexWake(std::atomic<std::uint32_t>&)
+{
+}
+#endif
+
+/* Wakes the other side only if it sleeps; returns true if woken */
+bool WakeIfWaiting(std::atomic<std::uint32_t>& waiting)
+{
+  std::atomic_thread_fence(std::memory_order_seq_cst);
+  if (waiting.load(std::memory_order_relaxed) == 0)
+  {
+    return false;
+  }
+  waiting.store(0, std::memory_order_relaxed);
+  FutexWake(waiting);
+  return true;
+}
+
+} // namespace
+
+
+const std::size_t TSharedMemoryRing::DefaultCapacity;
+
+std::unique_ptr<TSharedMemoryRing> TSharedMemoryRing::Create(
+  std::size_t capacity)
+{
+#if defined(__linux__)
+  if (capacity > MaxCapacity)
+  {
+    std::stringstream info;
+    info << "Shared memory ring capacity '" << capacity << "' exceeds '" <<
+      MaxCapacity << "' bytes.";
+    throw std::runtime_error(info.str());
+  }
+  std::size_t roundedCapacity = MinCapacity;
+  while (roundedCapacity < capacity)
+  {
+    roundedCapacity <<= 1;
+  }
+
+  int fd = static_cast<int>(syscall(SYS_memfd_create, "wrp-ring",
+    MFD_CLOEXEC));
+  if (fd < 0)
+  {
+    ThrowSystemError("memfd_create");
+  }
+  if (ftruncate(fd, ControlSize + roundedCapacity) < 0)
+  {
+    int error = errno;
+    close(fd);
+    errno = error;
+    ThrowSystemError("ftruncate");
+  }
+
+  std::unique_ptr<TSharedMemoryRing> ring(
+    new TSharedMemoryRing(fd, ControlSize + roundedCapacity));
+  TControl* control = new (ring->mapping) TControl();
+  control->magic = RingMagic;
+  control->capacity = roundedCapacity;
+  control->head.store(0);
+  control->tail.store(0);
+  control->readerWaiting.store(0);
+  control->writerWaiting.store(0);
+  control->closed.store(0);
+  return ring;
+#else
+  (void)capacity;
+  ThrowNotSupported();
+  return std::unique_ptr<TSharedMemoryRing>();
+#endif
+}
+
+std::unique_ptr<TSharedMemoryRing> TSharedMemoryRing::Attach(int fd)
+{
+#if defined(__linux__)
+  struct stat info;
+  if (fstat(fd, &info) < 0)
+  {
+    ThrowSystemError("fstat");
+  }
+  std::size_t mappingSize = static_cast<std::size_t>(info.st_size);
+  if (mappingSize < ControlSize + MinCapacity)
+  {
+    std::stringstream message;
+    message << "Descriptor '" << fd << "' is not a shared memory ring.";
+    throw std::runtime_error(message.str());
+  }
+
+  /* The ring owns a copy, so the caller's descriptor stays open */
+  int copy = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+  if (copy < 0)
+  {
+    ThrowSystemError("fcntl(F_DUPFD_CLOEXEC)");
+  }
+  std::unique_ptr<TSharedMemoryRing> ring(
+    new TSharedMemoryRing(copy, mappingSize));
+  if ((ring->control->magic != RingMagic) ||
+    (ring->control->capacity != ring->capacity))
+  {
+    std::stringstream message;
+    message << "Descriptor '" << fd << "' is not a shared memory ring.";
+    throw std::runtime_error(message.str());
+  }
+  return ring;
+#else
+  (void)fd;
+  ThrowNotSupported();
+  return std::unique_ptr<TSharedMemoryRing>();
+#endif
+}
+
+TSharedMemoryRing::TSharedMemoryRing(int fd, std::size_t mappingSize) :
+  fd(fd), mapping(NULL), mappingSize(mappingSize), control(NULL), data(NULL),
+  capacity(mappingSize - ControlSize), cachedTail(0), cachedHead(0),
+  wakeCount(0)
+{
+#if defined(__linux__)
+  void* address = mmap(NULL, mappingSize, PROT_READ | PROT_WRITE, MAP_SHARED,
+    fd, 0);
+  if (address == MAP_FAILED)
+  {
+    int error = errno;
+    close(fd);
+    errno = error;
+    ThrowSystemError("mmap");
+  }
+  mapping = static_cast<char*>(address);
+  control = reinterpret_cast<TControl*>(mapping);
+  data = mapping + ControlSize;
+#endif
+}
+
+TSharedMemoryRing::~TSharedMemoryRing()
+{
+#if defined(__linux__)
+  munmap(mapping, mappingSize);
+  close(fd);
+#endif
+}
+
+bool TSharedMemoryRing::TrySend(const TDataMessage& message)
+{
+  std::size_t messageSize = TDataMessageCodec::EncodedSize(message);
+  std::size_t recordSize = RecordSize(messageSize);
+  if (recordSize > capacity / 2)
+  {
+    std::stringstream info;
+    info << "Data message with '" << messageSize << "' size doesn't fit " <<
+      "shared memory ring with '" << capacity << "' capacity.";
+    throw std::runtime_error(info.str());
+  }
+
+  std::uint64_t head = control->head.load(std::memory_order_relaxed);
+  std::size_t position = static_cast<std::size_t>(head & (capacity - 1));
+  std::size_t contiguousSize = capacity - position;
+  std::size_t requiredSize = (recordSize <= contiguousSize) ?
+    recordSize : contiguousSize + recordSize;
+  if (head + requiredSize - cachedTail > capacity)
+  {
+    cachedTail = control->tail.load(std::memory_order_acquire);
+    if (head + requiredSize - cachedTail > capacity)
+    {
+      return false;
+    }
+  }
+
+  /* Record is never split: the rest of the area is skipped */
+  if (recordSize > contiguousSize)
+  {
+    std::memcpy(data + position, &PaddingMark, sizeof(PaddingMark));
+    head += contiguousSize;
+    position = 0;
+  }
+  std::uint32_t size = static_cast<std::uint32_t>(messageSize);
+  std::memcpy(data + position, &size, sizeof(size));
+  TDataMessageCodec::Encode(message, data + position + RecordHeaderSize,
+    messageSize);
+  control->head.store(head + recordSize, std::memory_order_release);
+
+  if (WakeIfWaiting(control->readerWaiting))
+  {
+    ++wakeCount;
+  }
+  return true;
+}
+
+void TSharedMemoryRing::Send(const TDataMessage& message)
+{
+  for (;;)
+  {
+    for (unsigned int i = 0; i < SpinCount; ++i)
+    {
+      if (TrySend(message))
+      {
+        return;
+      }
+      CpuRelax();
+    }
+    control->writerWaiting.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (TrySend(message))
+    {
+      control->writerWaiting.store(0, std::memory_order_relaxed);
+      return;
+    }
+    FutexWait(control->writerWaiting, 1);
+  }
+}
+
+void TSharedMemoryRing::Close()
+{
+  control->closed.store(1, std::memory_order_release);
+  if (WakeIfWaiting(control->readerWaiting))
+  {
+    ++wakeCount;
+  }
+}
+
+bool TSharedMemoryRing::TryReceive(TDataMessage& message)
+{
+  std::uint64_t tail = control->tail.load(std::memory_order_relaxed);
+  std::size_t position = 0;
+  std::uint32_t size = 0;
+  for (;;)
+  {
+    if (tail == cachedHead)
+    {
+      cachedHead = control->head.load(std::memory_order_acquire);
+      if (tail == cachedHead)
+      {
+        return false;
+      }
+    }
+    position = static_cast<std::size_t>(tail & (capacity - 1));
+    std::memcpy(&size, data + position, sizeof(size));
+    if (size != PaddingMark)
+    {
+      break;
+    }
+    tail += capacity - position;
+  }
+
+  /* Slot is released right after copying, decoding works on the copy */
+  TPayloadBufferPtr buffer = std::make_shared<TPayloadBuffer>(
+    data + position + RecordHeaderSize, size);
+  control->tail.store(tail + RecordSize(size), std::memory_order_release);
+  if (WakeIfWaiting(control->writerWaiting))
+  {
+    ++wakeCount;
+  }
+
+  TDataMessageCodec::Decode(TPayloadSlice(buffer), message);
+  return true;
+}
+
+bool TSharedMemoryRing::Receive(TDataMessage& message)
+{
+  for (;;)
+  {
+    for (unsigned int i = 0; i < SpinCount; ++i)
+    {
+      if (TryReceive(message))
+      {
+        return true;
+      }
+      CpuRelax();
+    }
+    control->readerWaiting.store(1);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (TryReceive(message))
+    {
+      control->readerWaiting.store(0, std::memory_order_relaxed);
+      return true;
+    }
+    if (control->closed.load(std::memory_order_acquire) != 0)
+    {
+      control->readerWaiting.store(0, std::memory_order_relaxed);
+      return TryReceive(message);
+    }
+    FutexWait(control->readerWaiting, 1);
+  }
+}
+
+int TSharedMemoryRing::Descriptor() const
+{
+  return fd;
+}
+
+std::size_t TSharedMemoryRing::Capacity() const
+{
+  return capacity;
+}
+
+std::size_t TSharedMemoryRing::WakeCount() const
+{
+  return wakeCount;
+}
+
+} // namespace wrp
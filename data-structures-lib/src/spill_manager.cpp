@@ -0,0 +1,407 @@
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+#include "spill_manager.h"
+
+
+namespace wrp
+{
+
+namespace
+{
+
+void ThrowSystemError(const char* call, int error)
+{
+  std::stringstream info;
+  info << "Spill manager: " << call << " failed: " << std::strerror(error) <<
+    ".";
+  throw std::runtime_error(info.str());
+}
+
+#if defined(__linux__)
+void Unmap(char* data, std::size_t size)
+{
+  munmap(data, size);
+}
+
+void WriteAt(int fd, const char* data, std::size_t size,
+  std::uint64_t fileOffset)
+{
+  std::size_t done = 0;
+  while (done < size)
+  {
+    ssize_t count = pwrite(fd, data + done, size - done,
+      static_cast<off_t>(fileOffset + done));
+    if (count < 0)
+    {
+      if (errno == EINTR)
+      {
+        continue;
+      }
+      ThrowSystemError("pwrite", errno);
+    }
+    done += static_cast<std::size_t>(count);
+  }
+}
+#endif
+
+} // namespace
+
+
+TSpillOptions::TSpillOptions(std::size_t memoryBudget,
+  std::size_t minSpillSize) :
+  memoryBudget(memoryBudget), minSpillSize(minSpillSize)
+{
+}
+
+
+TSpillManager::TEntry::TEntry() :
+  data(), size(0), spilled(false), fileOffset(0), mapping()
+{
+}
+
+
+TSpillManager::TBufferUse::TBufferUse() :
+  tickets(), dataSize(0), lruPosition(), inLru(false)
+{
+}
+
+
+TSpillManager::TSpillManager(const std::string& directoryPath,
+  const TSpillOptions& options) :
+  mutex(), directoryPath(directoryPath), options(options), fd(-1),
+  fileEnd(0), pageSize(4096), nextTicket(0), memorySize(0), spilledSize(0),
+  spilledCount(0), spillCount(0), entries(), buffers(), lruOrder(),
+  retiredRanges()
+{
+  if (directoryPath.empty())
+  {
+    std::stringstream info;
+    info << "Spill manager requires a temporary directory.";
+    throw std::runtime_error(info.str());
+  }
+#if defined(__linux__)
+  long systemPageSize = sysconf(_SC_PAGESIZE);
+  if (systemPageSize > 0)
+  {
+    pageSize = static_cast<std::size_t>(systemPageSize);
+  }
+#endif
+}
+
+TSpillManager::~TSpillManager()
+{
+#if defined(__linux__)
+  /* Mappings keep their own reference to the file */
+  if (fd >= 0)
+  {
+    close(fd);
+  }
+#endif
+}
+
+TSpillManager::TTicket TSpillManager::Put(const TPayloadSlice& data)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  TTicket ticket = nextTicket++;
+  TEntry& entry = entries[ticket];
+  entry.size = data.Size();
+  if (entry.size > 0)
+  {
+    entry.data = data;
+    /* Slices of one buffer hold it in memory once */
+    std::pair<TBuffers::iterator, bool> inserted = buffers.insert(
+      std::make_pair(data.buffer.get(), TBufferUse()));
+    if (inserted.second)
+    {
+      memorySize += data.buffer->Size();
+    }
+    inserted.first->second.tickets.push_back(ticket);
+    inserted.first->second.dataSize += entry.size;
+    Touch(inserted.first);
+  }
+  if (memorySize > options.memoryBudget)
+  {
+    SpillCold();
+  }
+  return ticket;
+}
+
+TPayloadSlice TSpillManager::Get(TTicket ticket)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  TEntries::iterator it = entries.find(ticket);
+  if (it == entries.end())
+  {
+    std::stringstream info;
+    info << "Spill manager has no data with ticket '" << ticket << "'.";
+    throw std::runtime_error(info.str());
+  }
+  TEntry& entry = it->second;
+  if (entry.spilled)
+  {
+    return Map(entry);
+  }
+  if (entry.data.buffer)
+  {
+    Touch(buffers.find(entry.data.buffer.get()));
+  }
+  return entry.data;
+}
+
+void TSpillManager::Remove(TTicket ticket)
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  TEntries::iterator it = entries.find(ticket);
+  if (it == entries.end())
+  {
+    return;
+  }
+  TEntry& entry = it->second;
+  if (entry.spilled)
+  {
+    if (entry.mapping.expired())
+    {
+      ReleaseRange(entry.fileOffset, entry.size);
+    }
+    else
+    {
+      /* Punching a hole under a live mapping would zero its pages */
+      TRetiredRange range;
+      range.fileOffset = entry.fileOffset;
+      range.size = entry.size;
+      range.mapping = entry.mapping;
+      retiredRanges.push_back(range);
+    }
+    spilledSize -= entry.size;
+    --spilledCount;
+  }
+  else if (entry.data.buffer)
+  {
+    TBuffers::iterator use = buffers.find(entry.data.buffer.get());
+    std::vector<TTicket>& tickets = use->second.tickets;
+    tickets.erase(std::find(tickets.begin(), tickets.end(), ticket));
+    use->second.dataSize -= entry.size;
+    if (tickets.empty())
+    {
+      memorySize -= entry.data.buffer->Size();
+      if (use->second.inLru)
+      {
+        lruOrder.erase(use->second.lruPosition);
+      }
+      buffers.erase(use);
+    }
+    else if (use->second.inLru &&
+      (use->second.dataSize < options.minSpillSize))
+    {
+      lruOrder.erase(use->second.lruPosition);
+      use->second.inLru = false;
+    }
+  }
+  entries.erase(it);
+  ReleaseRetiredRanges();
+
+#if defined(__linux__)
+  if ((fd >= 0) && (spilledCount == 0) && retiredRanges.empty() &&
+    (fileEnd > 0))
+  {
+    if (ftruncate(fd, 0) == 0)
+    {
+      fileEnd = 0;
+    }
+  }
+#endif
+}
+
+std::size_t TSpillManager::MemorySize() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return memorySize;
+}
+
+std::uint64_t TSpillManager::SpilledSize() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return spilledSize;
+}
+
+std::size_t TSpillManager::SpillCount() const
+{
+  std::lock_guard<std::mutex> lock(mutex);
+  return spillCount;
+}
+
+void TSpillManager::SpillCold()
+{
+  /* Buffers shared outside the manager stay: spilling them frees nothing.
+     Only buffers large enough to spill are in the list, so the scan ends
+     with the candidates */
+  std::list<const TPayloadBuffer*>::iterator position = lruOrder.begin();
+  while ((position != lruOrder.end()) &&
+    (memorySize > options.memoryBudget))
+  {
+    TBuffers::iterator use = buffers.find(*position);
+    ++position;
+    const TEntry& entry = entries[use->second.tickets.front()];
+    if (entry.data.buffer.use_count() ==
+      static_cast<long>(use->second.tickets.size()))
+    {
+      Spill(use);
+    }
+  }
+}
+
+void TSpillManager::Spill(TBuffers::iterator use)
+{
+#if defined(__linux__)
+  if (fd < 0)
+  {
+    OpenFile();
+  }
+  /* All slices of the buffer are written together, each on a page
+     boundary so it can be mapped directly */
+  const std::vector<TTicket>& tickets = use->second.tickets;
+  std::vector<std::uint64_t> fileOffsets(tickets.size());
+  std::uint64_t fileOffset = fileEnd;
+  for (std::size_t i = 0; i < tickets.size(); ++i)
+  {
+    const TEntry& entry = entries[tickets[i]];
+    WriteAt(fd, entry.data.Data(), entry.size, fileOffset);
+    fileOffsets[i] = fileOffset;
+    fileOffset = (fileOffset + entry.size + pageSize - 1) / pageSize *
+      pageSize;
+  }
+  fileEnd = fileOffset;
+
+  memorySize -= use->first->Size();
+  for (std::size_t i = 0; i < tickets.size(); ++i)
+  {
+    TEntry& entry = entries[tickets[i]];
+    entry.data = TPayloadSlice();
+    entry.spilled = true;
+    entry.fileOffset = fileOffsets[i];
+    spilledSize += entry.size;
+    ++spilledCount;
+  }
+  if (use->second.inLru)
+  {
+    lruOrder.erase(use->second.lruPosition);
+  }
+  buffers.erase(use);
+  ++spillCount;
+#else
+  (void)use;
+  ThrowSystemError("open", ENOSYS);
+#endif
+}
+
+void TSpillManager::Touch(TBuffers::iterator use)
+{
+  TBufferUse& info = use->second;
+  if (info.inLru)
+  {
+    lruOrder.splice(lruOrder.end(), lruOrder, info.lruPosition);
+  }
+  else if (info.dataSize >= options.minSpillSize)
+  {
+    lruOrder.push_back(use->first);
+    info.lruPosition = --lruOrder.end();
+    info.inLru = true;
+  }
+}
+
+TPayloadSlice TSpillManager::Map(TEntry& entry)
+{
+  TPayloadBufferPtr buffer = entry.mapping.lock();
+  if (buffer)
+  {
+    return TPayloadSlice(buffer);
+  }
+#if defined(__linux__)
+  /* Read-only mapping: pages stay shared with the page cache */
+  void* address = mmap(NULL, entry.size, PROT_READ, MAP_SHARED, fd,
+    static_cast<off_t>(entry.fileOffset));
+  if (address == MAP_FAILED)
+  {
+    ThrowSystemError("mmap", errno);
+  }
+  buffer = std::make_shared<TPayloadBuffer>(static_cast<char*>(address),
+    entry.size, Unmap);
+  entry.mapping = buffer;
+#else
+  ThrowSystemError("mmap", ENOSYS);
+#endif
+  return TPayloadSlice(buffer);
+}
+
+void TSpillManager::ReleaseRange(std::uint64_t fileOffset, std::size_t size)
+{
+#if defined(__linux__) && defined(FALLOC_FL_PUNCH_HOLE)
+  /* Not every file system supports holes; the space is then reclaimed
+     when the file is truncated */
+  fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+    static_cast<off_t>(fileOffset), static_cast<off_t>(size));
+#else
+  (void)fileOffset;
+  (void)size;
+#endif
+}
+
+void TSpillManager::ReleaseRetiredRanges()
+{
+  std::size_t kept = 0;
+  for (std::size_t i = 0; i < retiredRanges.size(); ++i)
+  {
+    if (retiredRanges[i].mapping.expired())
+    {
+      ReleaseRange(retiredRanges[i].fileOffset, retiredRanges[i].size);
+    }
+    else
+    {
+      retiredRanges[kept++] = retiredRanges[i];
+    }
+  }
+  retiredRanges.resize(kept);
+}
+
+void TSpillManager::OpenFile()
+{
+#if defined(__linux__)
+  std::string path = directoryPath + "/wrp-spill-XXXXXX";
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  fd = mkstemp(&name[0]);
+  if (fd < 0)
+  {
+    std::stringstream info;
+    info << "Can't create spill file in '" << directoryPath << "': " <<
+      std::strerror(errno) << ".";
+    throw std::runtime_error(info.str());
+  }
+  fcntl(fd, F_SETFD, FD_CLOEXEC);
+
+  /* File disappears with the process even after a crash */
+  unlink(&name[0]);
+#endif
+}
+
+} // namespace wrp
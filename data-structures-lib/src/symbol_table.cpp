@@ -0,0 +1,86 @@
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "symbol_table.h"
+
+
+std::size_t TSymbolTable::TStringPtrHash::operator()(
+  const std::string* str) const
+{
+  return std::hash<std::string>()(*str);
+}
+
+bool TSymbolTable::TStringPtrEqual::operator()(const std::string* lhs,
+  const std::string* rhs) const
+{
+  return *lhs == *rhs;
+}
+
+TSymbolTable::TSymbolTable() :
+  pool(), index()
+{
+  /* Identifier 0 is reserved for empty string */
+  pool.push_back(std::string());
+  index.insert(std::make_pair(&pool.back(), SymbolIdUndefined));
+}
+
+TSymbolId TSymbolTable::Intern(const std::string& str)
+{
+  TIndex::const_iterator it = index.find(&str);
+  if (it != index.end())
+  {
+    return it->second;
+  }
+
+  TSymbolId id = static_cast<TSymbolId>(pool.size());
+  if (static_cast<std::size_t>(id) != pool.size() ||
+    id == SymbolIdUndefined)
+  {
+    std::stringstream info;
+    info << "Symbol table overflow. Current count of symbols: " <<
+      pool.size();
+    throw std::runtime_error(info.str());
+  }
+  pool.push_back(str);
+  index.insert(std::make_pair(&pool.back(), id));
+  return id;
+}
+
+TSymbolId TSymbolTable::Find(const std::string& str) const
+{
+  TIndex::const_iterator it = index.find(&str);
+  if (it == index.end())
+  {
+    return SymbolIdUndefined;
+  }
+  return it->second;
+}
+
+const std::string& TSymbolTable::GetString(TSymbolId id) const
+{
+  if (static_cast<std::size_t>(id) >= pool.size())
+  {
+    std::stringstream info;
+    info << "Symbol with '" << id << "' id unexisted in symbol table.";
+    throw std::runtime_error(info.str());
+  }
+  return pool[id];
+}
+
+std::size_t TSymbolTable::Size() const
+{
+  return pool.size();
+}
+
+void TSymbolTable::Clear()
+{
+  index.clear();
+  pool.clear();
+  pool.push_back(std::string());
+  index.insert(std::make_pair(&pool.back(), SymbolIdUndefined));
+}
@@ -0,0 +1,163 @@
+#include <cstddef>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "workflow_model.h"
+
+
+TModuleColdInfo::TModuleColdInfo() :
+  name(), executablePath(), startCommandLineArgs(), stopCommandLine(),
+  parameters(), parameterNameIds(), environmentVariables(),
+  inputFileName(), outputFileName(),
+  stateFileName(), tempDirectoryPath(),
+  inputBatches(), outputBatches()
+{
+}
+
+TWorkflowModel::TWorkflowModel() :
+  ids(), nameIds(), executionTypes(), transportTypes(), flags(),
+  inputBatchCounts(), outputBatchCounts(), cold()
+{
+}
+
+TWorkflowModel::TWorkflowModel(const std::vector<TModuleInfo>& modules) :
+  ids(), nameIds(), executionTypes(), transportTypes(), flags(),
+  inputBatchCounts(), outputBatchCounts(), cold()
+{
+  Assign(modules);
+}
+
+void TWorkflowModel::Assign(const std::vector<TModuleInfo>& modules)
+{
+  Clear();
+  Reserve(modules.size());
+  for (std::size_t i = 0; i < modules.size(); ++i)
+  {
+    Append(modules[i]);
+  }
+}
+
+std::size_t TWorkflowModel::Append(const TModuleInfo& module)
+{
+  TModuleFlags moduleFlags = 0;
+  if (module.isTransferable)
+  {
+    moduleFlags |= EModuleFlag::IsTransferable;
+  }
+  if (module.hasState)
+  {
+    moduleFlags |= EModuleFlag::HasState;
+  }
+  if (module.isStarting)
+  {
+    moduleFlags |= EModuleFlag::IsStarting;
+  }
+  if (module.isFinishing)
+  {
+    moduleFlags |= EModuleFlag::IsFinishing;
+  }
+
+  ids.push_back(module.id);
+  nameIds.push_back(module.nameId);
+  executionTypes.push_back(static_cast<unsigned char>(module.executionType));
+  transportTypes.push_back(static_cast<unsigned char>(module.transportType));
+  flags.push_back(moduleFlags);
+  inputBatchCounts.push_back(
+    static_cast<TBatchCount>(module.inputBatches.size()));
+  outputBatchCounts.push_back(
+    static_cast<TBatchCount>(module.outputBatches.size()));
+
+  /* Cold fields are filled in place to avoid copying a whole cold record */
+  cold.push_back(TModuleColdInfo());
+  TModuleColdInfo& coldInfo = cold.back();
+  coldInfo.name = module.name;
+  coldInfo.executablePath = module.executablePath;
+  coldInfo.startCommandLineArgs = module.startCommandLineArgs;
+  coldInfo.stopCommandLine = module.stopCommandLine;
+  coldInfo.parameters = module.parameters;
+  coldInfo.parameterNameIds = module.parameterNameIds;
+  coldInfo.environmentVariables = module.environmentVariables;
+  coldInfo.inputFileName = module.inputFileName;
+  coldInfo.outputFileName = module.outputFileName;
+  coldInfo.stateFileName = module.stateFileName;
+  coldInfo.tempDirectoryPath = module.tempDirectoryPath;
+  coldInfo.inputBatches = module.inputBatches;
+  coldInfo.outputBatches = module.outputBatches;
+
+  return ids.size() - 1;
+}
+
+void TWorkflowModel::Extract(std::size_t index, TModuleInfo& module) const
+{
+  const TModuleColdInfo& coldInfo = cold[index];
+  module.name = coldInfo.name;
+  module.nameId = nameIds[index];
+  module.id = ids[index];
+  module.executionType =
+    static_cast<EExecutionType::Type>(executionTypes[index]);
+  module.transportType =
+    static_cast<ETransportType::Type>(transportTypes[index]);
+  module.executablePath = coldInfo.executablePath;
+  module.startCommandLineArgs = coldInfo.startCommandLineArgs;
+  module.stopCommandLine = coldInfo.stopCommandLine;
+  module.parameters = coldInfo.parameters;
+  module.parameterNameIds = coldInfo.parameterNameIds;
+  module.environmentVariables = coldInfo.environmentVariables;
+  module.inputFileName = coldInfo.inputFileName;
+  module.outputFileName = coldInfo.outputFileName;
+  module.isTransferable = HasFlag(index, EModuleFlag::IsTransferable);
+  module.hasState = HasFlag(index, EModuleFlag::HasState);
+  module.stateFileName = coldInfo.stateFileName;
+  module.tempDirectoryPath = coldInfo.tempDirectoryPath;
+  module.inputBatches = coldInfo.inputBatches;
+  module.outputBatches = coldInfo.outputBatches;
+  module.isStarting = HasFlag(index, EModuleFlag::IsStarting);
+  module.isFinishing = HasFlag(index, EModuleFlag::IsFinishing);
+}
+
+std::size_t TWorkflowModel::Find(const TModuleId& id) const
+{
+  for (std::size_t i = 0; i < ids.size(); ++i)
+  {
+    if (ids[i] == id)
+    {
+      return i;
+    }
+  }
+  return ids.size();
+}
+
+bool TWorkflowModel::HasFlag(std::size_t index, EModuleFlag::Type flag) const
+{
+  return (flags[index] & flag) != 0;
+}
+
+std::size_t TWorkflowModel::Size() const
+{
+  return ids.size();
+}
+
+void TWorkflowModel::Reserve(std::size_t count)
+{
+  ids.reserve(count);
+  nameIds.reserve(count);
+  executionTypes.reserve(count);
+  transportTypes.reserve(count);
+  flags.reserve(count);
+  inputBatchCounts.reserve(count);
+  outputBatchCounts.reserve(count);
+  cold.reserve(count);
+}
+
+void TWorkflowModel::Clear()
+{
+  ids.clear();
+  nameIds.clear();
+  executionTypes.clear();
+  transportTypes.clear();
+  flags.clear();
+  inputBatchCounts.clear();
+  outputBatchCounts.clear();
+  cold.clear();
+}
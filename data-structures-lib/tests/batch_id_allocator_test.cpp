@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "batch_id_allocator.h"
+#include "data_message.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+/* Keeps every sequence recorded by one cursor */
+class TRecordingSink : public wrp::TBatchSequenceSink
+{
+public:
+  std::vector<wrp::TBatchSequence> sequences;
+
+  virtual void Record(const wrp::TBatchSequence& sequence) override
+  {
+    sequences.push_back(sequence);
+  }
+};
+
+bool Covers(const std::vector<wrp::TBatchSequence>& sequences,
+  wrp::TBatchInstanceId id)
+{
+  for (std::size_t i = 0; i < sequences.size(); ++i)
+  {
+    if ((sequences[i].firstId <= id) && (id <= sequences[i].lastId))
+    {
+      return true;
+    }
+  }
+  return false;
+}
+
+void TestCursorRecordsBlocks()
+{
+  wrp::TBatchIdAllocator allocator(4);
+  TRecordingSink sink;
+  wrp::TBatchSequence prototype;
+  prototype.tokens.push_back(wrp::TDataMessageToken(TModuleId(7, 0), 3));
+  prototype.sourceChannels.push_back("output");
+  wrp::TBatchIdCursor cursor(allocator, sink, prototype);
+
+  Check(sink.sequences.empty(), "nothing is recorded before Next");
+  std::vector<wrp::TBatchInstanceId> ids;
+  for (int i = 0; i < 10; ++i)
+  {
+    ids.push_back(cursor.Next());
+  }
+  Check(sink.sequences.size() == 3, "each block is recorded once");
+  for (std::size_t i = 0; i < ids.size(); ++i)
+  {
+    Check(Covers(sink.sequences, ids[i]),
+      "id " + std::to_string(ids[i]) + " is in a recorded sequence");
+  }
+  Check(sink.sequences[1].firstId == 5 && sink.sequences[1].lastId == 8,
+    "recorded sequence matches the block");
+  Check(sink.sequences[2].tokens.size() == 1 &&
+    sink.sequences[2].tokens[0].source == TModuleId(7, 0) &&
+    sink.sequences[2].sourceChannels.size() == 1,
+    "recorded sequence carries the prototype tokens and channels");
+}
+
+const std::size_t ThreadCount = 8;
+const std::size_t BlockSize = 64;
+
+/* Whole blocks, so that recorded sequences are used up */
+const std::size_t IdsPerThread = 1600 * BlockSize;
+
+struct TProducer
+{
+  wrp::TBatchIdAllocator* allocator;
+  TRecordingSink sink;
+  std::vector<wrp::TBatchInstanceId> ids;
+};
+
+void Produce(TProducer* producer)
+{
+  wrp::TBatchIdCursor cursor(*producer->allocator, producer->sink);
+  producer->ids.reserve(IdsPerThread);
+  for (std::size_t i = 0; i < IdsPerThread; ++i)
+  {
+    producer->ids.push_back(cursor.Next());
+  }
+}
+
+void TestConcurrentCursors()
+{
+  wrp::TBatchIdAllocator allocator(BlockSize);
+  std::vector<TProducer> producers(ThreadCount);
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < ThreadCount; ++i)
+  {
+    producers[i].allocator = &allocator;
+    threads.push_back(std::thread(Produce, &producers[i]));
+  }
+  for (std::size_t i = 0; i < threads.size(); ++i)
+  {
+    threads[i].join();
+  }
+
+  std::vector<wrp::TBatchInstanceId> all;
+  std::size_t recordedCount = 0;
+  bool covered = true;
+  for (std::size_t i = 0; i < producers.size(); ++i)
+  {
+    const std::vector<wrp::TBatchSequence>& sequences =
+      producers[i].sink.sequences;
+    std::size_t sequence = 0;
+    /* Ids of a cursor go through its recorded blocks in order */
+    for (std::size_t j = 0; j < producers[i].ids.size(); ++j)
+    {
+      wrp::TBatchInstanceId id = producers[i].ids[j];
+      while ((sequence < sequences.size()) &&
+        (id > sequences[sequence].lastId ||
+        id < sequences[sequence].firstId))
+      {
+        ++sequence;
+      }
+      covered = covered && (sequence < sequences.size());
+      all.push_back(id);
+    }
+    for (std::size_t j = 0; j < sequences.size(); ++j)
+    {
+      recordedCount += sequences[j].lastId - sequences[j].firstId + 1;
+    }
+  }
+  Check(covered, "every id is in a sequence recorded by its cursor");
+
+  std::sort(all.begin(), all.end());
+  Check(std::adjacent_find(all.begin(), all.end()) == all.end(),
+    "ids of concurrent cursors are unique");
+  Check(all.front() != wrp::BatchInstanceIdUndefined,
+    "undefined id is never handed out");
+  Check(recordedCount == ThreadCount * IdsPerThread,
+    "recorded sequences cover exactly the handed out ids");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestCursorRecordsBlocks();
+  TestConcurrentCursors();
+  std::printf("Batch id allocator: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,210 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "block_codec.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+std::vector<char> RandomData(std::size_t size, std::uint32_t seed)
+{
+  std::vector<char> data(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<char>(seed >> 16);
+  }
+  return data;
+}
+
+std::vector<char> TextData(std::size_t size)
+{
+  const char* words[] = { "module ", "batch ", "entrance ", "channel ",
+    "workflow ", "message ", "fragment ", "token " };
+  std::string text;
+  std::uint32_t seed = 7;
+  while (text.size() < size)
+  {
+    seed = seed * 1103515245 + 12345;
+    text += words[(seed >> 16) % 8];
+  }
+  return std::vector<char>(text.begin(), text.begin() + size);
+}
+
+std::vector<char> Compress(const std::vector<char>& data)
+{
+  std::vector<char> compressed(
+    wrp::TBlockCodec::MaxCompressedSize(data.size()));
+  std::size_t size = wrp::TBlockCodec::Compress(
+    data.empty() ? NULL : &data[0], data.size(), &compressed[0],
+    compressed.size());
+  compressed.resize(size);
+  return compressed;
+}
+
+/* Returns decompressed size or -1 if data is rejected as corrupted */
+long Decompress(const std::vector<char>& compressed, std::size_t capacity,
+  std::vector<char>& output)
+{
+  output.assign(capacity + 1, 0);
+  try
+  {
+    return static_cast<long>(wrp::TBlockCodec::Decompress(
+      compressed.empty() ? NULL : &compressed[0], compressed.size(),
+      &output[0], capacity));
+  }
+  catch (const std::runtime_error&)
+  {
+    return -1;
+  }
+}
+
+void TestRoundTrip(const std::string& name, const std::vector<char>& data)
+{
+  std::vector<char> compressed = Compress(data);
+  Check(!compressed.empty(), name + ": compressed");
+  std::vector<char> output;
+  long size = Decompress(compressed, data.size(), output);
+  Check((size == static_cast<long>(data.size())) &&
+    std::equal(data.begin(), data.end(), output.begin()),
+    name + ": round trip");
+}
+
+void TestRoundTrips()
+{
+  TestRoundTrip("empty", std::vector<char>());
+  TestRoundTrip("one byte", std::vector<char>(1, 'a'));
+  TestRoundTrip("zeros", std::vector<char>(1024 * 1024, 0));
+  TestRoundTrip("text", TextData(300 * 1024));
+  TestRoundTrip("random", RandomData(100 * 1024, 1));
+  const std::size_t sizes[] = { 12, 13, 15, 16, 17, 65535, 65536, 65537 };
+  for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    TestRoundTrip("text of " + std::to_string(sizes[i]) + " bytes",
+      TextData(sizes[i]));
+  }
+
+  std::vector<char> text = TextData(64 * 1024);
+  Check(Compress(text).size() < text.size() / 2, "text is compressible");
+  std::vector<char> random = RandomData(64 * 1024, 2);
+  std::vector<char> small(random.size() / 2);
+  Check(wrp::TBlockCodec::Compress(&random[0], random.size(), &small[0],
+    small.size()) == 0, "incompressible data does not fit small buffer");
+}
+
+void TestTruncated()
+{
+  std::vector<char> data = TextData(20000);
+  std::vector<char> compressed = Compress(data);
+  std::vector<char> output;
+  for (std::size_t size = 0; size < compressed.size(); ++size)
+  {
+    std::vector<char> truncated(compressed.begin(),
+      compressed.begin() + size);
+    long result = Decompress(truncated, data.size(), output);
+    /* A cut after a sequence's literals parses as a shorter block */
+    if ((result == static_cast<long>(data.size())) ||
+      (output[data.size()] != 0))
+    {
+      Check(false, "truncated block to " + std::to_string(size) +
+        " bytes is not decoded in full");
+      return;
+    }
+  }
+}
+
+void TestCorrupted()
+{
+  std::vector<char> data = TextData(20000);
+  std::vector<char> compressed = Compress(data);
+  std::vector<char> output;
+
+  Check(Decompress(compressed, data.size() - 1, output) == -1,
+    "output larger than capacity is rejected");
+  Check(Decompress(std::vector<char>(), data.size(), output) == -1,
+    "empty block is rejected");
+
+  /* Token with no literals and a match at offset 0 or before output */
+  std::vector<char> zeroOffset;
+  zeroOffset.push_back(0x10);
+  zeroOffset.push_back('a');
+  zeroOffset.push_back(0);
+  zeroOffset.push_back(0);
+  zeroOffset.push_back(0);
+  Check(Decompress(zeroOffset, 100, output) == -1, "zero offset is rejected");
+  std::vector<char> farOffset = zeroOffset;
+  farOffset[2] = 2;
+  Check(Decompress(farOffset, 100, output) == -1,
+    "offset before output start is rejected");
+
+  /* Literal count beyond the input */
+  std::vector<char> longLiterals;
+  longLiterals.push_back(static_cast<char>(0xF0));
+  longLiterals.push_back(static_cast<char>(200));
+  longLiterals.push_back('a');
+  Check(Decompress(longLiterals, 1000, output) == -1,
+    "literals beyond input are rejected");
+
+  /* Random byte changes must never write beyond the output buffer */
+  std::uint32_t seed = 3;
+  for (int i = 0; i < 2000; ++i)
+  {
+    std::vector<char> corrupted = compressed;
+    for (int j = 0; j < 4; ++j)
+    {
+      seed = seed * 1103515245 + 12345;
+      corrupted[(seed >> 8) % corrupted.size()] =
+        static_cast<char>(seed >> 24);
+    }
+    long result = Decompress(corrupted, data.size(), output);
+    if ((result > static_cast<long>(data.size())) ||
+      (output[data.size()] != 0))
+    {
+      Check(false, "corrupted block stays within output buffer");
+      return;
+    }
+  }
+}
+
+void TestSelector()
+{
+  /* Zero sample interval is clamped to one, so every block is sampled */
+  wrp::TCompressionSelector selector(0.9, 0);
+  std::vector<char> random = RandomData(64 * 1024, 4);
+  Check(!selector.ShouldCompress(&random[0], random.size()),
+    "first random block is sampled and not compressed");
+  std::vector<char> text = TextData(64 * 1024);
+  Check(selector.ShouldCompress(&text[0], text.size()),
+    "next text block is sampled and compressed");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestRoundTrips();
+  TestTruncated();
+  TestCorrupted();
+  TestSelector();
+  std::printf("Block codec: %s\n", (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,113 @@
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <utility>
+
+#include "collector_join_table.h"
+#include "data_message.h"
+#include "module_info.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+const TModuleId::TWorkflowId Distributor = 2;
+
+TInputBatchInfo CollectorBatch()
+{
+  TInputBatchInfo inputBatch;
+  inputBatch.type = EInputBatchType::Collector;
+  inputBatch.source = Distributor;
+  inputBatch.sourceChannelIds.push_back(10);
+  inputBatch.sourceChannelIds.push_back(11);
+  return inputBatch;
+}
+
+/* Message of distributor set batchId, passed through worker module */
+wrp::TDataMessage Message(wrp::TBatchInstanceId batchId,
+  TModuleId::TWorkflowId worker)
+{
+  wrp::TDataMessage message(wrp::EMessageType::Data);
+  message.id.lastModuleToken = wrp::TDataMessageToken(TModuleId(1, 0), 1);
+  message.id.Forward(wrp::TDataMessageToken(TModuleId(Distributor, 0),
+    batchId));
+  message.id.Forward(wrp::TDataMessageToken(TModuleId(worker, 0), batchId));
+  return message;
+}
+
+void TestCompleted()
+{
+  wrp::TCollectorJoinTable table(CollectorBatch(), 16, 4);
+  wrp::TCollectedBatch batch;
+  Check(table.Add(Message(1, 3), 10, batch) ==
+    wrp::ECollectorJoinStatus::Pending, "first message is pending");
+  Check(table.Add(Message(1, 3), 10, batch) ==
+    wrp::ECollectorJoinStatus::Duplicate, "repeated channel is duplicate");
+  Check(table.Add(Message(1, 4), 11, batch) ==
+    wrp::ECollectorJoinStatus::Completed, "set is completed");
+  Check(batch.messages.size() == 2, "set has all channels");
+  Check(batch.distributorId.lastModuleToken.source.workflowId ==
+    Distributor, "set key ends with distributor token");
+  Check(batch.distributorId.tokens.Size() == 1,
+    "set key keeps distributor path");
+  Check(table.PendingCount() == 0, "completed set is not pending");
+
+  Check(table.Add(Message(1, 4), 11, batch) ==
+    wrp::ECollectorJoinStatus::Duplicate, "late message is duplicate");
+  Check(table.PendingCount() == 0, "late message opens no set");
+}
+
+void TestLateMessagesKeepPendingSets()
+{
+  /* One shard with room for two sets */
+  wrp::TCollectorJoinTable table(CollectorBatch(), 2, 1);
+  wrp::TCollectedBatch batch;
+  table.Add(Message(1, 3), 10, batch);
+  table.Add(Message(1, 4), 11, batch);
+  table.Add(Message(2, 3), 10, batch);
+  table.Add(Message(3, 3), 10, batch);
+  for (int i = 0; i < 5; ++i)
+  {
+    table.Add(Message(1, 3), 10, batch);
+  }
+  Check(table.EvictedCount() == 0, "late messages evict no pending set");
+  Check(table.Add(Message(2, 4), 11, batch) ==
+    wrp::ECollectorJoinStatus::Completed, "pending set is completed");
+}
+
+void TestDirectFromDistributor()
+{
+  wrp::TCollectorJoinTable table(CollectorBatch(), 16, 4);
+  wrp::TCollectedBatch batch;
+  wrp::TDataMessage direct(wrp::EMessageType::Data);
+  direct.id.lastModuleToken = wrp::TDataMessageToken(TModuleId(1, 0), 1);
+  direct.id.Forward(wrp::TDataMessageToken(TModuleId(Distributor, 0), 5));
+  table.Add(std::move(direct), 10, batch);
+  Check(table.Add(Message(5, 4), 11, batch) ==
+    wrp::ECollectorJoinStatus::Completed,
+    "message from distributor joins message from worker");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestCompleted();
+  TestLateMessagesKeepPendingSets();
+  TestDirectFromDistributor();
+  std::printf("Collector join table: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
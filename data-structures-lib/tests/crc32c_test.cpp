@@ -0,0 +1,128 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+#include "crc32c.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const char* what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what);
+    ++failureCount;
+  }
+}
+
+/* Bitwise reference implementation */
+std::uint32_t ReferenceCrc(const unsigned char* data, std::size_t size)
+{
+  std::uint32_t crc = 0xFFFFFFFF;
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    crc ^= data[i];
+    for (int bit = 0; bit < 8; ++bit)
+    {
+      crc = (crc >> 1) ^ (0x82F63B78 & (0 - (crc & 1)));
+    }
+  }
+  return crc ^ 0xFFFFFFFF;
+}
+
+void TestKnownAnswers()
+{
+  const char* check = "123456789";
+  Check(wrp::TCrc32c::Compute(check, std::strlen(check)) == 0xE3069283,
+    "CRC32C of \"123456789\"");
+  Check(wrp::TCrc32c::Compute(check, 0) == 0, "CRC32C of empty data");
+
+  /* RFC 3720, appendix B.4 */
+  unsigned char data[32];
+  std::memset(data, 0, sizeof(data));
+  Check(wrp::TCrc32c::Compute(data, sizeof(data)) == 0x8A9136AA,
+    "CRC32C of 32 zero bytes");
+  std::memset(data, 0xFF, sizeof(data));
+  Check(wrp::TCrc32c::Compute(data, sizeof(data)) == 0x62A8AB43,
+    "CRC32C of 32 0xFF bytes");
+  for (std::size_t i = 0; i < sizeof(data); ++i)
+  {
+    data[i] = static_cast<unsigned char>(i);
+  }
+  Check(wrp::TCrc32c::Compute(data, sizeof(data)) == 0x46DD794E,
+    "CRC32C of 32 incrementing bytes");
+  for (std::size_t i = 0; i < sizeof(data); ++i)
+  {
+    data[i] = static_cast<unsigned char>(31 - i);
+  }
+  Check(wrp::TCrc32c::Compute(data, sizeof(data)) == 0x113FDB5C,
+    "CRC32C of 32 decrementing bytes");
+}
+
+void TestReference()
+{
+  std::vector<unsigned char> data(4096 + 16);
+  std::uint32_t seed = 1;
+  for (std::size_t i = 0; i < data.size(); ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<unsigned char>(seed >> 16);
+  }
+  /* Unaligned starts and tails of every length class */
+  for (std::size_t offset = 0; offset < 16; ++offset)
+  {
+    for (std::size_t size = 0; size <= 4096; size += (size < 64) ? 1 : 61)
+    {
+      if (wrp::TCrc32c::Compute(&data[offset], size) !=
+        ReferenceCrc(&data[offset], size))
+      {
+        std::printf("offset %u, size %u: ", static_cast<unsigned>(offset),
+          static_cast<unsigned>(size));
+        Check(false, "CRC32C matches the bitwise implementation");
+        return;
+      }
+    }
+  }
+}
+
+void TestIncrementalAndCombine()
+{
+  std::vector<unsigned char> data(10000);
+  for (std::size_t i = 0; i < data.size(); ++i)
+  {
+    data[i] = static_cast<unsigned char>(i * 31 + 7);
+  }
+  std::uint32_t whole = wrp::TCrc32c::Compute(&data[0], data.size());
+  const std::size_t splits[] = { 0, 1, 7, 8, 63, 4096, 9999, 10000 };
+  for (std::size_t i = 0; i < sizeof(splits) / sizeof(splits[0]); ++i)
+  {
+    std::size_t split = splits[i];
+    std::uint32_t first = wrp::TCrc32c::Compute(&data[0], split);
+    std::uint32_t second = wrp::TCrc32c::Compute(&data[0] + split,
+      data.size() - split);
+    Check(wrp::TCrc32c::Compute(&data[0] + split, data.size() - split,
+      first) == whole, "CRC32C computed by parts");
+    Check(wrp::TCrc32c::Combine(first, second, data.size() - split) == whole,
+      "CRC32C of parts combined");
+  }
+}
+
+} // namespace
+
+
+int main()
+{
+  TestKnownAnswers();
+  TestReference();
+  TestIncrementalAndCombine();
+  std::printf("CRC32C (%s): %s\n",
+    wrp::TCrc32c::IsAccelerated() ? "hardware" : "table",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,172 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data_message.h"
+#include "data_message_pool.h"
+#include "payload_buffer.h"
+
+
+namespace
+{
+
+std::atomic<std::size_t> allocationCount(0);
+
+} // namespace
+
+
+/* Counting replacements of the global allocation functions */
+void* operator new(std::size_t size)
+{
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = std::malloc((size > 0) ? size : 1);
+  if (pointer == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+typedef std::chrono::steady_clock TClock;
+
+const std::size_t CycleCount = 1000000;
+
+/* Entrance ids longer than the small string buffer */
+const char* const FirstEntrance = "first-input-entrance-of-module";
+const char* const SecondEntrance = "second-input-entrance-of-module";
+
+void Fill(wrp::TDataMessage& message, const wrp::TPayloadSlice& data)
+{
+  message.entrances[0].entranceId = FirstEntrance;
+  message.entrances[0].SetFragment(data);
+  message.entrances[1].entranceId = SecondEntrance;
+  message.entrances[1].SetFragment(data);
+}
+
+void TestPooledChurn()
+{
+  wrp::TPayloadSlice data = wrp::TPayloadSlice::Copy("payload", 7);
+  wrp::TDataMessagePool pool;
+  for (int i = 0; i < 10; ++i)
+  {
+    wrp::TDataMessagePtr message = pool.Acquire(wrp::EMessageType::Data,
+      TModuleId(1, 0), TModuleId(2, 0), 2);
+    Fill(*message, data);
+  }
+
+  std::size_t before = allocationCount.load();
+  TClock::time_point start = TClock::now();
+  for (std::size_t i = 0; i < CycleCount; ++i)
+  {
+    wrp::TDataMessagePtr message = pool.Acquire(wrp::EMessageType::Data,
+      TModuleId(1, 0), TModuleId(2, 0), 2);
+    Fill(*message, data);
+  }
+  double seconds = std::chrono::duration<double>(TClock::now() - start).count();
+  std::size_t allocations = allocationCount.load() - before;
+  std::printf("Pooled churn: %zu allocations for %zu messages, %.0f ns "
+    "per message\n", allocations, CycleCount, seconds / CycleCount * 1e9);
+  Check(allocations == 0, "pooled churn doesn't allocate");
+}
+
+void TestPlainChurn()
+{
+  wrp::TPayloadSlice data = wrp::TPayloadSlice::Copy("payload", 7);
+  std::size_t before = allocationCount.load();
+  TClock::time_point start = TClock::now();
+  for (std::size_t i = 0; i < CycleCount; ++i)
+  {
+    wrp::TDataMessage* message = new wrp::TDataMessage(
+      wrp::EMessageType::Data, TModuleId(1, 0), TModuleId(2, 0));
+    message->entrances.resize(2);
+    Fill(*message, data);
+    delete message;
+  }
+  double seconds = std::chrono::duration<double>(TClock::now() - start).count();
+  std::size_t allocations = allocationCount.load() - before;
+  std::printf("Plain churn: %zu allocations for %zu messages, %.0f ns "
+    "per message\n", allocations, CycleCount, seconds / CycleCount * 1e9);
+}
+
+void TestForwardAllocates()
+{
+  /* Each hop adds one shared path node; the pool doesn't recycle nodes */
+  wrp::TDataMessagePool pool;
+  wrp::TDataMessagePtr message = pool.Acquire(wrp::EMessageType::Data);
+  message.reset();
+  std::size_t before = allocationCount.load();
+  message = pool.Acquire(wrp::EMessageType::Data);
+  message->id.Forward(wrp::TDataMessageToken(TModuleId(1, 0), 1));
+  message->id.Forward(wrp::TDataMessageToken(TModuleId(2, 0), 1));
+  std::size_t allocations = allocationCount.load() - before;
+  Check(allocations == 2,
+    "each forwarded token allocates one path node");
+}
+
+void Consume(std::vector<wrp::TDataMessagePtr>* messages)
+{
+  messages->clear();
+}
+
+void TestCrossThreadRelease()
+{
+  /* Messages released by a consumer thread return to the producer pool */
+  wrp::TDataMessagePool pool;
+  for (int round = 0; round < 100; ++round)
+  {
+    std::vector<wrp::TDataMessagePtr> messages;
+    for (int i = 0; i < 100; ++i)
+    {
+      messages.push_back(pool.Acquire(wrp::EMessageType::Data));
+    }
+    std::thread consumer(Consume, &messages);
+    consumer.join();
+  }
+  Check(pool.AllocatedCount() <= 200, "released messages are reused");
+  Check(pool.ReusedCount() >= 9800, "producer pool is refilled");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestPooledChurn();
+  TestPlainChurn();
+  TestForwardAllocates();
+  TestCrossThreadRelease();
+  std::printf("Data message pool: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,128 @@
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "file_transport.h"
+#include "payload_buffer.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+std::string TempPath(const char* name)
+{
+  const char* directory = std::getenv("TMPDIR");
+  return std::string((directory != NULL) ? directory : "/tmp") + "/" + name;
+}
+
+std::vector<char> TestData(std::size_t size)
+{
+  /* Repeated text with a counter, so compression has something to find */
+  std::vector<char> data(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    data[i] = static_cast<char>("fragment"[i % 8] + (i / 4096) % 3);
+  }
+  return data;
+}
+
+void TestRoundTrip(bool useIoUring, bool compression)
+{
+  std::string name = std::string(useIoUring ? "io_uring" : "synchronous") +
+    (compression ? ", compressed" : "");
+  std::string path = TempPath("wrp-file-transport-test.bin");
+  wrp::TFileTransportOptions options;
+  options.blockSize = 64 * 1024;
+  options.queueDepth = 4;
+  options.useIoUringForReading = useIoUring;
+  options.useIoUringForWriting = useIoUring;
+  options.compression = compression;
+
+  /* Large fragments out of order, then small sequential appends */
+  const std::size_t largeSize = 1024 * 1024 + 333;
+  const std::size_t fragmentSize = 100000;
+  std::vector<char> data = TestData(largeSize + 5000);
+  {
+    wrp::TFileWriter writer(path, options);
+    std::size_t count = (largeSize + fragmentSize - 1) / fragmentSize;
+    for (std::size_t i = count; i > 0; --i)
+    {
+      std::size_t offset = (i - 1) * fragmentSize;
+      std::size_t size = std::min(fragmentSize, largeSize - offset);
+      writer.WriteAt(offset, wrp::TPayloadSlice::Copy(&data[offset], size));
+    }
+    for (std::size_t offset = largeSize; offset < data.size(); offset += 100)
+    {
+      writer.Write(wrp::TPayloadSlice::Copy(&data[offset], 100));
+    }
+    writer.Close();
+  }
+
+  std::vector<char> read(data.size(), 0);
+  std::size_t readSize = 0;
+  {
+    wrp::TFileReader reader(path, options);
+    Check(reader.FileSize() == data.size(), name + ": file size");
+    wrp::TDataMessageEntranceInfo fragment;
+    while (reader.Read(fragment))
+    {
+      if (fragment.startOffset + fragment.data.Size() > read.size())
+      {
+        Check(false, name + ": fragment within file");
+        break;
+      }
+      std::memcpy(&read[fragment.startOffset], fragment.data.Data(),
+        fragment.data.Size());
+      readSize += fragment.data.Size();
+    }
+  }
+  Check((readSize == data.size()) && (read == data), name + ": round trip");
+  std::remove(path.c_str());
+}
+
+void TestMissingFile()
+{
+  bool thrown = false;
+  try
+  {
+    wrp::TFileReader reader(TempPath("wrp-file-transport-missing.bin"));
+  }
+  catch (const std::runtime_error&)
+  {
+    thrown = true;
+  }
+  Check(thrown, "missing file is rejected");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestRoundTrip(true, false);
+  TestRoundTrip(false, false);
+  TestRoundTrip(true, true);
+  TestRoundTrip(false, true);
+  TestMissingFile();
+  std::printf("File transport: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
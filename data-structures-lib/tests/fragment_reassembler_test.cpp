@@ -0,0 +1,180 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "crc32c.h"
+#include "data_message.h"
+#include "fragment_reassembler.h"
+#include "payload_buffer.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+typedef wrp::EReassemblyStatus::Type TStatus;
+
+wrp::TPayloadSlice Payload(std::size_t size, std::uint32_t seed)
+{
+  std::vector<char> data(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<char>(seed >> 16);
+  }
+  return wrp::TPayloadSlice::Copy(data.empty() ? NULL : &data[0], size);
+}
+
+wrp::TDataMessageTokens Id(wrp::TBatchInstanceId batchId)
+{
+  wrp::TDataMessageTokens id;
+  id.Forward(wrp::TDataMessageToken(TModuleId(1, 0), batchId));
+  return id;
+}
+
+wrp::TDataMessageEntranceInfo Fragment(const wrp::TPayloadSlice& payload,
+  std::size_t begin, std::size_t size)
+{
+  wrp::TDataMessageEntranceInfo fragment;
+  fragment.entranceId = "in";
+  fragment.startOffset = begin;
+  fragment.totalSize = payload.Size();
+  fragment.SetFragment(payload.Slice(begin, size));
+  fragment.ComputeChecksum();
+  return fragment;
+}
+
+bool SameData(const wrp::TDataMessageEntranceInfo& message,
+  const wrp::TPayloadSlice& payload)
+{
+  return (message.startOffset == 0) &&
+    (message.totalSize == payload.Size()) &&
+    (message.data.Size() == payload.Size()) &&
+    (std::memcmp(message.data.Data(), payload.Data(), payload.Size()) == 0);
+}
+
+void TestWholeMessage()
+{
+  wrp::TFragmentReassembler reassembler(1 << 20);
+  wrp::TPayloadSlice payload = Payload(1000, 1);
+  wrp::TDataMessageEntranceInfo message;
+  Check(reassembler.Add(Id(1), Fragment(payload, 0, 1000), message) ==
+    wrp::EReassemblyStatus::Completed, "whole message is completed");
+  Check(SameData(message, payload), "whole message data");
+  Check(message.data.buffer == payload.buffer,
+    "whole message is passed through without copying");
+  Check(reassembler.Add(Id(1), Fragment(payload, 0, 1000), message) ==
+    wrp::EReassemblyStatus::Duplicate, "repeated whole message is duplicate");
+  Check(reassembler.PendingCount() == 0, "no pending messages");
+}
+
+void TestOutOfOrder()
+{
+  wrp::TFragmentReassembler reassembler(1 << 20);
+  wrp::TPayloadSlice payload = Payload(4000, 2);
+  const std::size_t order[] = { 3, 1, 2, 0 };
+  wrp::TDataMessageEntranceInfo message;
+  for (std::size_t i = 0; i < 4; ++i)
+  {
+    TStatus status = reassembler.Add(Id(2),
+      Fragment(payload, order[i] * 1000, 1000), message);
+    Check(status == ((i < 3) ? wrp::EReassemblyStatus::Incomplete :
+      wrp::EReassemblyStatus::Completed),
+      "fragment " + std::to_string(i) + " status");
+    if ((i == 1) || (i == 2))
+    {
+      Check(reassembler.Add(Id(2), Fragment(payload, order[i] * 1000, 1000),
+        message) == wrp::EReassemblyStatus::Duplicate,
+        "repeated fragment is duplicate");
+    }
+  }
+  Check(SameData(message, payload), "out-of-order message data");
+  Check(message.hasChecksum &&
+    (message.checksum == wrp::TCrc32c::Compute(payload.Data(), 4000)),
+    "fragment checksums are merged");
+  Check(reassembler.Add(Id(2), Fragment(payload, 1000, 1000), message) ==
+    wrp::EReassemblyStatus::Duplicate, "late fragment is duplicate");
+  Check(reassembler.PendingCount() == 0, "late fragment is not pending");
+
+  wrp::TDataMessageEntranceInfo empty = Fragment(payload, 500, 0);
+  Check(reassembler.Add(Id(3), empty, message) ==
+    wrp::EReassemblyStatus::Duplicate, "empty fragment is dropped");
+  Check(reassembler.PendingCount() == 0, "empty fragment is not pending");
+}
+
+void TestOverlapping()
+{
+  wrp::TFragmentReassembler reassembler(1 << 20);
+  wrp::TPayloadSlice payload = Payload(1000, 3);
+  wrp::TDataMessageEntranceInfo message;
+  Check(reassembler.Add(Id(4), Fragment(payload, 0, 600), message) ==
+    wrp::EReassemblyStatus::Incomplete, "first overlapping fragment");
+  Check(reassembler.Add(Id(4), Fragment(payload, 100, 300), message) ==
+    wrp::EReassemblyStatus::Duplicate, "contained fragment is duplicate");
+  Check(reassembler.Add(Id(4), Fragment(payload, 400, 600), message) ==
+    wrp::EReassemblyStatus::Completed, "second overlapping fragment");
+  Check(SameData(message, payload), "overlapping message data");
+  Check(!message.hasChecksum || (message.checksum ==
+    wrp::TCrc32c::Compute(payload.Data(), 1000)),
+    "overlap does not produce a wrong checksum");
+}
+
+void TestChecksumMismatch()
+{
+  wrp::TFragmentReassembler reassembler(1 << 20);
+  wrp::TPayloadSlice payload = Payload(1000, 4);
+  wrp::TDataMessageEntranceInfo fragment = Fragment(payload, 0, 500);
+  fragment.checksum ^= 1;
+  wrp::TDataMessageEntranceInfo message;
+  bool thrown = false;
+  try
+  {
+    reassembler.Add(Id(5), fragment, message);
+  }
+  catch (const std::runtime_error&)
+  {
+    thrown = true;
+  }
+  Check(thrown, "corrupted fragment is rejected");
+}
+
+void TestMemoryBudget()
+{
+  wrp::TFragmentReassembler reassembler(1000);
+  wrp::TPayloadSlice first = Payload(600, 5);
+  wrp::TPayloadSlice second = Payload(600, 6);
+  wrp::TDataMessageEntranceInfo message;
+  reassembler.Add(Id(6), Fragment(first, 0, 100), message);
+  reassembler.Add(Id(7), Fragment(second, 0, 100), message);
+  Check(reassembler.EvictedCount() == 1, "oldest message is evicted");
+  Check(reassembler.PendingBytes() == 600, "budget is kept");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestWholeMessage();
+  TestOutOfOrder();
+  TestOverlapping();
+  TestChecksumMismatch();
+  TestMemoryBudget();
+  std::printf("Fragment reassembler: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "fragmenter.h"
+#include "module_info.h"
+#include "payload_buffer.h"
+#include "shared_memory_transport.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+/* Synthetic channel: a fixed cost per fragment plus the copy time. Past
+   the cache knee bandwidth halves, so throughput peaks at the knee */
+const double FixedCost = 20e-6;
+const double CachedBandwidth = 2e9;
+const double UncachedBandwidth = 1e9;
+const std::size_t CacheKnee = 256 * 1024;
+
+std::chrono::nanoseconds TransferTime(std::size_t size)
+{
+  double bandwidth = (size <= CacheKnee) ? CachedBandwidth :
+    UncachedBandwidth;
+  double seconds = FixedCost + size / bandwidth;
+  return std::chrono::nanoseconds(static_cast<long long>(seconds * 1e9));
+}
+
+/* Runs windowCount windows and counts windows per fragment size */
+std::map<std::size_t, std::size_t> Run(wrp::TFragmenter& fragmenter,
+  std::size_t windowCount)
+{
+  std::map<std::size_t, std::size_t> windows;
+  for (std::size_t i = 0; i < windowCount; ++i)
+  {
+    std::size_t size = fragmenter.FragmentSize();
+    ++windows[size];
+    for (std::size_t j = 0; j < fragmenter.Options().windowSize; ++j)
+    {
+      fragmenter.Observe(size, TransferTime(size));
+    }
+  }
+  return windows;
+}
+
+void TestConvergence()
+{
+  wrp::TFragmenter fragmenter;
+  std::map<std::size_t, std::size_t> first = Run(fragmenter, 2);
+  Check(fragmenter.FragmentSize() == CacheKnee,
+    "size reaches the throughput peak in two windows, got " +
+    std::to_string(fragmenter.FragmentSize()));
+  Check(first.size() == 2, "each window doubles the size on the way up");
+
+  const std::size_t windowCount = 1000;
+  std::map<std::size_t, std::size_t> windows = Run(fragmenter, windowCount);
+  std::printf("Convergence: %zu of %zu windows at %zu bytes\n",
+    windows[CacheKnee], windowCount, CacheKnee);
+  Check(windows[CacheKnee] >= windowCount * 95 / 100,
+    "size stays at the peak apart from occasional probes");
+  Check(windows.size() == 3, "probes go one step either side of the peak");
+}
+
+void TestLatencyCap()
+{
+  wrp::TFragmenterOptions options;
+  options.maxLatency = std::chrono::microseconds(50);
+  wrp::TFragmenter fragmenter(options);
+  Run(fragmenter, 10);
+
+  const std::size_t windowCount = 1000;
+  std::map<std::size_t, std::size_t> windows = Run(fragmenter, windowCount);
+  std::size_t overCap = 0;
+  for (std::map<std::size_t, std::size_t>::const_iterator it =
+    windows.begin(); it != windows.end(); ++it)
+  {
+    if (TransferTime(it->first) > options.maxLatency)
+    {
+      overCap += it->second;
+    }
+  }
+  std::printf("Latency cap: %zu of %zu windows over the cap, final size "
+    "%zu\n", overCap, windowCount, fragmenter.FragmentSize());
+  Check(TransferTime(32 * 1024) <= options.maxLatency &&
+    TransferTime(64 * 1024) > options.maxLatency, "model brackets the cap");
+  Check(windows[32 * 1024] >= windowCount * 95 / 100,
+    "size settles at the largest one within the cap");
+  Check(overCap <= windowCount * 2 / 100,
+    "only single probe windows exceed the cap");
+  Check(windows.rbegin()->first <= 64 * 1024,
+    "probes never go further than one step over the cap");
+}
+
+bool Rejected(std::size_t capacity)
+{
+  try
+  {
+    wrp::TFragmenterOptions::ForTransport(ETransportType::SharedMemory,
+      capacity);
+  }
+  catch (const std::runtime_error&)
+  {
+    return true;
+  }
+  return false;
+}
+
+void TestSharedMemoryLimits()
+{
+  const std::size_t capacities[] = {16 * 1024, 64 * 1024, 1024 * 1024,
+    wrp::TSharedMemoryRing::DefaultCapacity};
+  for (std::size_t i = 0; i < sizeof(capacities) / sizeof(capacities[0]);
+    ++i)
+  {
+    std::size_t capacity = capacities[i];
+    std::string name = std::to_string(capacity) + " byte ring";
+    wrp::TFragmenterOptions options =
+      wrp::TFragmenterOptions::ForTransport(ETransportType::SharedMemory,
+      capacity);
+    Check(options.maxSize > 0 && options.maxSize % options.alignment == 0,
+      name + ": max size is whole pages");
+    Check(options.maxSize + 4096 <= capacity / 2,
+      name + ": a fragment with its headers fits a half of the ring");
+    Check(options.minSize <= options.initialSize &&
+      options.initialSize <= options.maxSize,
+      name + ": initial size is within the range");
+
+    /* Fragments never outgrow the ring, however fast the channel is */
+    wrp::TFragmenter fragmenter(options);
+    for (std::size_t j = 0; j < 100 * options.windowSize; ++j)
+    {
+      fragmenter.Observe(fragmenter.FragmentSize(),
+        std::chrono::nanoseconds(1));
+    }
+    Check(fragmenter.FragmentSize() <= options.maxSize,
+      name + ": fragment size stays within the ring");
+
+    std::vector<char> data(3 * capacity);
+    std::vector<wrp::TDataMessageEntranceInfo> fragments;
+    fragmenter.Split(wrp::TPayloadSlice::Copy(data.data(), data.size()),
+      "input", fragments);
+    bool fits = true;
+    for (std::size_t j = 0; j < fragments.size(); ++j)
+    {
+      fits = fits && (fragments[j].data.Size() <= options.maxSize);
+    }
+    Check(fits, name + ": split fragments fit the ring");
+  }
+
+  Check(!Rejected(16 * 1024), "16 KiB ring is accepted");
+  Check(Rejected(16 * 1024 - 4096), "12 KiB ring is rejected");
+  Check(Rejected(8 * 1024), "8 KiB ring is rejected");
+  Check(Rejected(1), "tiny ring is rejected");
+}
+
+void TestOtherTransports()
+{
+  wrp::TFragmenterOptions pipe =
+    wrp::TFragmenterOptions::ForTransport(ETransportType::Pipe, 1024 * 1024);
+  Check(pipe.initialSize == 1024 * 1024 && pipe.maxSize == 4 * 1024 * 1024,
+    "pipe fragments start at the pipe capacity");
+  wrp::TFragmenterOptions file =
+    wrp::TFragmenterOptions::ForTransport(ETransportType::File, 256 * 1024);
+  Check(file.minSize == 64 * 1024 && file.initialSize == 256 * 1024 &&
+    file.maxSize == 16 * 256 * 1024, "file fragments follow the block size");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestConvergence();
+  TestLatencyCap();
+  TestSharedMemoryLimits();
+  TestOtherTransports();
+  std::printf("Fragmenter: %s\n", (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "data_message.h"
+#include "hop_latency.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+typedef wrp::TLatencyHistogram THistogram;
+
+/* Bound promised by the histogram: 1 / SubBucketCount of the value */
+const double MaxRelativeError = 1.0 / THistogram::SubBucketCount;
+
+void TestBuckets()
+{
+  bool contains = true;
+  bool ordered = true;
+  double worstError = 0;
+  std::size_t previous = 0;
+  std::uint64_t limit = std::uint64_t(1) << THistogram::MaxValueBits;
+  for (std::uint64_t value = 0; value < limit;
+    value = (value < 4096) ? value + 1 : value + value / 997)
+  {
+    std::size_t index = THistogram::BucketIndex(value);
+    std::uint64_t highest = THistogram::BucketHighestValue(index);
+    contains = contains && (index < THistogram::BucketCount) &&
+      (highest >= value) &&
+      ((index == 0) || (THistogram::BucketHighestValue(index - 1) < value));
+    ordered = ordered && (index >= previous);
+    previous = index;
+    if (value > 0)
+    {
+      worstError = std::max(worstError,
+        static_cast<double>(highest - value) / value);
+    }
+  }
+  std::printf("Bucket error: %.2f%%\n", worstError * 100);
+  Check(contains, "value lies in the bucket it is counted in");
+  Check(ordered, "bucket indexes grow with values");
+  Check(worstError <= MaxRelativeError, "bucket width is within 1/32");
+  Check(THistogram::BucketIndex(limit * 4) == THistogram::BucketCount - 1,
+    "values out of range go to the last bucket");
+}
+
+void TestPercentiles()
+{
+  /* Lognormal latencies around 50 us with a long tail */
+  std::mt19937_64 random(48);
+  std::lognormal_distribution<double> distribution(std::log(50000.0), 1.0);
+  THistogram histogram;
+  std::vector<std::uint64_t> values(1000000);
+  for (std::size_t i = 0; i < values.size(); ++i)
+  {
+    values[i] = static_cast<std::uint64_t>(distribution(random));
+    histogram.Record(values[i]);
+  }
+  std::sort(values.begin(), values.end());
+
+  const double fractions[] = {0.5, 0.9, 0.99, 0.999, 1.0};
+  double worstError = 0;
+  bool above = true;
+  for (std::size_t i = 0; i < sizeof(fractions) / sizeof(fractions[0]); ++i)
+  {
+    std::size_t rank = static_cast<std::size_t>(
+      std::ceil(fractions[i] * values.size()));
+    std::uint64_t exact = values[rank - 1];
+    std::uint64_t estimate = histogram.ValueAtFraction(fractions[i]);
+    above = above && (estimate >= exact);
+    worstError = std::max(worstError,
+      std::fabs(static_cast<double>(estimate) - exact) / exact);
+  }
+  std::printf("Percentile error: %.2f%%\n", worstError * 100);
+  Check(above, "percentiles are bucket upper bounds");
+  Check(worstError <= MaxRelativeError, "percentiles are within 1/32");
+  Check(histogram.Count() == values.size(), "every value is counted");
+  Check(histogram.Max() == values.back(), "maximum is exact");
+  Check(histogram.ValueAtFraction(1.0) == values.back(),
+    "last percentile is the maximum");
+}
+
+const std::size_t ThreadCount = 4;
+const std::size_t RecordsPerThread = 250000;
+
+void RecordValues(THistogram* histogram, std::size_t thread)
+{
+  for (std::size_t i = 0; i < RecordsPerThread; ++i)
+  {
+    histogram->Record(1000 * (thread + 1) + i % 1000);
+  }
+}
+
+void TestConcurrentRecords()
+{
+  THistogram histogram;
+  std::vector<std::thread> threads;
+  for (std::size_t i = 0; i < ThreadCount; ++i)
+  {
+    threads.push_back(std::thread(RecordValues, &histogram, i));
+  }
+  for (std::size_t i = 0; i < threads.size(); ++i)
+  {
+    threads[i].join();
+  }
+  Check(histogram.Count() == ThreadCount * RecordsPerThread,
+    "concurrent records aren't lost");
+  Check(histogram.Max() == 1000 * ThreadCount + 999,
+    "concurrent maximum is exact");
+  double mean = 0;
+  for (std::size_t i = 0; i < ThreadCount; ++i)
+  {
+    mean += 1000 * (i + 1) + 499.5;
+  }
+  mean /= ThreadCount;
+  Check(std::fabs(histogram.Mean() - mean) < 1e-6, "concurrent sum is exact");
+}
+
+void TestForwardStamps()
+{
+  wrp::TDataMessageTokens id;
+  std::uint64_t before = wrp::TDataMessageToken::Now();
+  id.Forward(wrp::TDataMessageToken(TModuleId(1, 0), 1));
+  std::uint64_t first = id.lastModuleToken.timestamp;
+  Check((first >= before) && (first <= wrp::THopLatencyTable::Now()),
+    "forwarded token is stamped with the current time");
+
+  wrp::TDataMessageToken stamped(TModuleId(2, 0), 1);
+  stamped.timestamp = 42;
+  id.Forward(stamped);
+  Check(id.lastModuleToken.timestamp == 42, "set timestamp is kept");
+  Check(id.tokens.Back().timestamp == first,
+    "previous module keeps its timestamp on the path");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestBuckets();
+  TestPercentiles();
+  TestConcurrentRecords();
+  TestForwardStamps();
+  std::printf("Hop latency: %s\n", (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,334 @@
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "message_codec.h"
+#include "payload_buffer.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+wrp::TPayloadSlice Payload(std::size_t size, std::uint32_t seed)
+{
+  std::vector<char> data(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    data[i] = static_cast<char>(seed >> 16);
+  }
+  return wrp::TPayloadSlice::Copy(data.empty() ? NULL : &data[0], size);
+}
+
+/* Message with tokenCount tokens and entranceCount entrances of dataSize */
+wrp::TDataMessage MakeMessage(std::size_t tokenCount,
+  std::size_t entranceCount, std::size_t dataSize)
+{
+  wrp::TDataMessage message(wrp::EMessageType::Data, TModuleId(3, 1),
+    TModuleId(300, 70000));
+  for (std::size_t i = 0; i < tokenCount; ++i)
+  {
+    wrp::TDataMessageToken token(TModuleId(i + 1, i % 3), i * 1000003);
+    token.timestamp = (i % 2 == 0) ? 0 : 1234567890123ULL + i;
+    /* As Forward, but unset timestamps stay unset */
+    message.id.Append(message.id.lastModuleToken);
+    message.id.lastModuleToken = token;
+  }
+  message.entrances.resize(entranceCount);
+  for (std::size_t i = 0; i < entranceCount; ++i)
+  {
+    wrp::TDataMessageEntranceInfo& entrance = message.entrances[i];
+    entrance.entranceId = "entrance" + std::to_string(i);
+    entrance.startOffset = i * 10;
+    entrance.totalSize = dataSize * 100 + i;
+    entrance.SetFragment(Payload(dataSize + i, static_cast<std::uint32_t>(i)));
+    if (i % 2 == 0)
+    {
+      entrance.ComputeChecksum();
+    }
+  }
+  return message;
+}
+
+bool SameMessage(const wrp::TDataMessage& left,
+  const wrp::TDataMessage& right)
+{
+  if ((left.type != right.type) || (left.source != right.source) ||
+    (left.destination != right.destination) || (left.id != right.id) ||
+    (left.entrances.size() != right.entrances.size()))
+  {
+    return false;
+  }
+  /* Timestamps don't take part in token comparison */
+  std::vector<wrp::TDataMessageToken> leftTokens = left.id.tokens.ToVector();
+  std::vector<wrp::TDataMessageToken> rightTokens =
+    right.id.tokens.ToVector();
+  for (std::size_t i = 0; i < leftTokens.size(); ++i)
+  {
+    if (leftTokens[i].timestamp != rightTokens[i].timestamp)
+    {
+      return false;
+    }
+  }
+  if (left.id.lastModuleToken.timestamp != right.id.lastModuleToken.timestamp)
+  {
+    return false;
+  }
+  for (std::size_t i = 0; i < left.entrances.size(); ++i)
+  {
+    const wrp::TDataMessageEntranceInfo& l = left.entrances[i];
+    const wrp::TDataMessageEntranceInfo& r = right.entrances[i];
+    if ((l.entranceId != r.entranceId) || (l.startOffset != r.startOffset) ||
+      (l.totalSize != r.totalSize) || (l.fragmentSize != r.fragmentSize) ||
+      (l.hasChecksum != r.hasChecksum) ||
+      (l.hasChecksum && (l.checksum != r.checksum)) ||
+      (l.data.Size() != r.data.Size()) || (!l.data.Empty() &&
+      (std::memcmp(l.data.Data(), r.data.Data(), l.data.Size()) != 0)))
+    {
+      return false;
+    }
+  }
+  return true;
+}
+
+/* Returns true if Decode rejects the input */
+bool Rejected(const wrp::TPayloadSlice& input)
+{
+  wrp::TDataMessage message(wrp::EMessageType::_undefined);
+  try
+  {
+    wrp::TDataMessageCodec::Decode(input, message);
+  }
+  catch (const std::runtime_error&)
+  {
+    return true;
+  }
+  return false;
+}
+
+wrp::TPayloadSlice Modified(const wrp::TPayloadSlice& encoded,
+  std::size_t offset, char value)
+{
+  wrp::TPayloadSlice copy =
+    wrp::TPayloadSlice::Copy(encoded.Data(), encoded.Size());
+  copy.buffer->Data()[offset] = value;
+  return copy;
+}
+
+void TestRoundTrip()
+{
+  const std::size_t shapes[][3] = { { 0, 0, 0 }, { 1, 1, 0 }, { 5, 3, 100 },
+    { 200, 2, 70000 }, { 2, 40, 1 } };
+  for (std::size_t i = 0; i < sizeof(shapes) / sizeof(shapes[0]); ++i)
+  {
+    std::string name = "message " + std::to_string(i);
+    wrp::TDataMessage message = MakeMessage(shapes[i][0], shapes[i][1],
+      shapes[i][2]);
+    wrp::TPayloadSlice encoded = wrp::TDataMessageCodec::Encode(message);
+    Check(encoded.Size() == wrp::TDataMessageCodec::EncodedSize(message),
+      name + ": encoded size");
+
+    wrp::TDataMessage decoded(wrp::EMessageType::_undefined);
+    std::size_t size = wrp::TDataMessageCodec::Decode(encoded, decoded);
+    Check(size == encoded.Size(), name + ": decoded size");
+    Check(SameMessage(message, decoded), name + ": round trip");
+    for (std::size_t j = 0; j < decoded.entrances.size(); ++j)
+    {
+      Check(decoded.entrances[j].data.buffer == encoded.buffer,
+        name + ": fragment data is not copied");
+    }
+
+    wrp::TPayloadSlice reencoded = wrp::TDataMessageCodec::Encode(decoded);
+    Check((reencoded.Size() == encoded.Size()) &&
+      (std::memcmp(reencoded.Data(), encoded.Data(), encoded.Size()) == 0),
+      name + ": encoding is stable");
+
+    std::size_t headSize = wrp::TDataMessageCodec::HeadSize(message);
+    std::vector<char> head(headSize);
+    Check((wrp::TDataMessageCodec::EncodeHead(message, &head[0], headSize) ==
+      headSize) && (std::memcmp(&head[0], encoded.Data(), headSize) == 0),
+      name + ": head matches message start");
+  }
+
+  /* Messages follow each other in one buffer */
+  wrp::TPayloadSlice first =
+    wrp::TDataMessageCodec::Encode(MakeMessage(3, 2, 10));
+  wrp::TPayloadSlice second =
+    wrp::TDataMessageCodec::Encode(MakeMessage(4, 1, 20));
+  std::string joined(first.Data(), first.Size());
+  joined.append(second.Data(), second.Size());
+  wrp::TPayloadSlice stream =
+    wrp::TPayloadSlice::Copy(joined.data(), joined.size());
+  wrp::TDataMessage decoded(wrp::EMessageType::_undefined);
+  std::size_t size = wrp::TDataMessageCodec::Decode(stream, decoded);
+  Check(size == first.Size(), "first message of stream");
+  wrp::TDataMessageCodec::Decode(stream.Slice(size, stream.Size() - size),
+    decoded);
+  Check(SameMessage(decoded, MakeMessage(4, 1, 20)),
+    "second message of stream");
+}
+
+void TestMalformed()
+{
+  wrp::TPayloadSlice encoded =
+    wrp::TDataMessageCodec::Encode(MakeMessage(6, 3, 50));
+
+  for (std::size_t size = 0; size < encoded.Size(); ++size)
+  {
+    if (!Rejected(wrp::TPayloadSlice::Copy(encoded.Data(), size)))
+    {
+      Check(false, "message truncated to " + std::to_string(size) +
+        " bytes is rejected");
+      break;
+    }
+  }
+  Check(Rejected(Modified(encoded, 0, 'X')), "wrong signature is rejected");
+  Check(Rejected(Modified(encoded, 4, 2)), "other version is rejected");
+  Check(Rejected(Modified(encoded, 8, static_cast<char>(0xFF))),
+    "metadata size beyond message is rejected");
+  Check(Rejected(Modified(encoded, 12, static_cast<char>(0x7F))),
+    "entrance count beyond metadata is rejected");
+
+  wrp::TDataMessage message(wrp::EMessageType::Data);
+  message.entrances.resize(1);
+  message.entrances[0].SetFragment(Payload(10, 1));
+  message.entrances[0].fragmentSize = 11;
+  bool thrown = false;
+  try
+  {
+    wrp::TDataMessageCodec::Encode(message);
+  }
+  catch (const std::runtime_error&)
+  {
+    thrown = true;
+  }
+  Check(thrown, "fragment size mismatch is not encoded");
+
+  /* Random byte changes in metadata must be rejected or decoded within
+     the input */
+  std::size_t metaEnd = wrp::TDataMessageCodec::HeadSize(MakeMessage(6, 3, 50));
+  std::uint32_t seed = 5;
+  for (int i = 0; i < 5000; ++i)
+  {
+    wrp::TPayloadSlice corrupted =
+      wrp::TPayloadSlice::Copy(encoded.Data(), encoded.Size());
+    for (int j = 0; j < 3; ++j)
+    {
+      seed = seed * 1103515245 + 12345;
+      corrupted.buffer->Data()[wrp::TWireHeader::Size +
+        (seed >> 8) % (metaEnd - wrp::TWireHeader::Size)] =
+        static_cast<char>(seed >> 24);
+    }
+    wrp::TDataMessage decoded(wrp::EMessageType::_undefined);
+    try
+    {
+      std::size_t size = wrp::TDataMessageCodec::Decode(corrupted, decoded);
+      std::size_t payloadSize = 0;
+      for (std::size_t k = 0; k < decoded.entrances.size(); ++k)
+      {
+        payloadSize += decoded.entrances[k].data.Size();
+      }
+      if ((size != corrupted.Size()) || (payloadSize > size))
+      {
+        Check(false, "corrupted message is decoded within input");
+        break;
+      }
+    }
+    catch (const std::runtime_error&)
+    {
+    }
+  }
+}
+
+void TestChecksum()
+{
+  /* Checksums travel with the fragments; payload damage is found after
+     decoding */
+  wrp::TDataMessage message = MakeMessage(2, 2, 1000);
+  message.entrances[1].ComputeChecksum();
+  wrp::TPayloadSlice encoded = wrp::TDataMessageCodec::Encode(message);
+  wrp::TDataMessage decoded(wrp::EMessageType::_undefined);
+  wrp::TDataMessageCodec::Decode(encoded, decoded);
+  Check(decoded.entrances[0].hasChecksum && decoded.entrances[1].hasChecksum,
+    "checksum flags are decoded");
+  Check(decoded.entrances[0].VerifyChecksum() &&
+    decoded.entrances[1].VerifyChecksum(), "decoded checksums match");
+
+  std::size_t last = encoded.Size() - 1;
+  wrp::TPayloadSlice damaged = Modified(encoded, last,
+    static_cast<char>(encoded.Data()[last] ^ 1));
+  wrp::TDataMessageCodec::Decode(damaged, decoded);
+  Check(decoded.entrances[0].VerifyChecksum() &&
+    !decoded.entrances[1].VerifyChecksum(),
+    "damaged fragment fails checksum");
+}
+
+void Benchmark()
+{
+  /* Encode copies fragment data, decode references it */
+  typedef std::chrono::steady_clock TClock;
+  const std::size_t sizes[] = { 256, 64 * 1024 };
+  for (std::size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); ++i)
+  {
+    wrp::TDataMessage message = MakeMessage(8, 2, sizes[i] / 2);
+    std::size_t encodedSize = wrp::TDataMessageCodec::EncodedSize(message);
+    std::vector<char> buffer(encodedSize);
+    std::size_t count = 64 * 1024 * 1024 / encodedSize + 1000;
+
+    TClock::time_point start = TClock::now();
+    for (std::size_t j = 0; j < count; ++j)
+    {
+      wrp::TDataMessageCodec::Encode(message, &buffer[0], buffer.size());
+    }
+    double encodeSeconds =
+      std::chrono::duration<double>(TClock::now() - start).count();
+
+    wrp::TPayloadSlice encoded =
+      wrp::TPayloadSlice::Copy(&buffer[0], buffer.size());
+    wrp::TDataMessage decoded(wrp::EMessageType::_undefined);
+    start = TClock::now();
+    for (std::size_t j = 0; j < count; ++j)
+    {
+      wrp::TDataMessageCodec::Decode(encoded, decoded);
+    }
+    double decodeSeconds =
+      std::chrono::duration<double>(TClock::now() - start).count();
+
+    double bytes = static_cast<double>(encodedSize) * count;
+    std::printf("%zu byte messages: encode %.2f GB/s (%.0f ns), "
+      "decode %.2f GB/s (%.0f ns)\n", encodedSize,
+      bytes / encodeSeconds / 1e9, encodeSeconds / count * 1e9,
+      bytes / decodeSeconds / 1e9, decodeSeconds / count * 1e9);
+  }
+}
+
+} // namespace
+
+
+int main()
+{
+  TestRoundTrip();
+  TestMalformed();
+  TestChecksum();
+  Benchmark();
+  std::printf("Message codec: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
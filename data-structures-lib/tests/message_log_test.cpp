@@ -0,0 +1,228 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "data_message.h"
+#include "message_codec.h"
+#include "message_log.h"
+#include "message_replayer.h"
+#include "payload_buffer.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+std::string TempPath(const char* name)
+{
+  const char* directory = std::getenv("TMPDIR");
+  return std::string((directory != NULL) ? directory : "/tmp") + "/" + name;
+}
+
+wrp::TDataMessage MakeMessage(std::size_t index)
+{
+  wrp::TDataMessage message(wrp::EMessageType::Data, TModuleId(1, index),
+    TModuleId(2, index));
+  for (std::size_t i = 0; i <= index % 3; ++i)
+  {
+    /* Fixed timestamps, so that Forward doesn't stamp the current time */
+    wrp::TDataMessageToken token(TModuleId(i + 3, 0), index + 1);
+    token.timestamp = 1000000 * index + i + 1;
+    message.id.Forward(token);
+  }
+  message.entrances.resize(1 + index % 2);
+  for (std::size_t i = 0; i < message.entrances.size(); ++i)
+  {
+    /* Empty, small and large fragments, larger than the initial file */
+    std::size_t size = (index % 4 == 0) ? 0 : (index % 4 == 3) ?
+      100 * 1024 + index : 17 * index + i;
+    std::vector<char> data(size);
+    for (std::size_t j = 0; j < size; ++j)
+    {
+      data[j] = static_cast<char>(index * 31 + j * 7 + i);
+    }
+    wrp::TDataMessageEntranceInfo& entrance = message.entrances[i];
+    entrance.entranceId = "entrance-" + std::to_string(i);
+    entrance.startOffset = index;
+    entrance.totalSize = index + size;
+    entrance.SetFragment(wrp::TPayloadSlice::Copy(data.data(), size));
+  }
+  return message;
+}
+
+bool SameBytes(const wrp::TDataMessage& left, const wrp::TDataMessage& right)
+{
+  wrp::TPayloadSlice l = wrp::TDataMessageCodec::Encode(left);
+  wrp::TPayloadSlice r = wrp::TDataMessageCodec::Encode(right);
+  return (l.Size() == r.Size()) &&
+    (std::memcmp(l.Data(), r.Data(), l.Size()) == 0);
+}
+
+const std::size_t MessageCount = 40;
+
+void Record(const std::string& path)
+{
+  wrp::TMessageRecorder recorder(path, 64 * 1024);
+  for (std::size_t i = 0; i < MessageCount; ++i)
+  {
+    recorder.Record(MakeMessage(i), 1000 * i);
+  }
+  Check(recorder.RecordCount() == MessageCount, "recorder counts records");
+  recorder.Close();
+}
+
+void TestRecordAndRead()
+{
+  std::string path = TempPath("wrp-message-log-test.log");
+  Record(path);
+
+  wrp::TMessageLog log(path);
+  Check(log.RecordCount() == MessageCount, "reopened log counts records");
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    std::string name = "pass " + std::to_string(pass) + ": ";
+    wrp::TDataMessage message(wrp::EMessageType::Data);
+    std::uint64_t timestamp = 0;
+    std::size_t count = 0;
+    bool same = true;
+    bool timestamps = true;
+    while (log.Next(message, timestamp))
+    {
+      same = same && SameBytes(message, MakeMessage(count));
+      timestamps = timestamps && (timestamp == 1000 * count);
+      ++count;
+    }
+    Check(count == MessageCount, name + "every record is read");
+    Check(same, name + "messages match byte for byte");
+    Check(timestamps, name + "timestamps are kept");
+    log.Rewind();
+  }
+  std::remove(path.c_str());
+}
+
+/* Keeps copies of the replayed messages */
+class TCaptureTarget : public wrp::TReplayTarget
+{
+public:
+  std::vector<wrp::TDataMessage> messages;
+
+  virtual void Send(const wrp::TDataMessage& message) override
+  {
+    messages.push_back(message);
+  }
+};
+
+void TestReplay()
+{
+  std::string path = TempPath("wrp-message-log-replay-test.log");
+  Record(path);
+
+  wrp::TMessageLog log(path);
+  TCaptureTarget target;
+  wrp::TReplayOptions options;
+  options.speed = 0;
+  options.passCount = 2;
+  wrp::TReplayReport report =
+    wrp::TMessageReplayer::Replay(log, target, options);
+  Check(report.messageCount == 2 * MessageCount, "replay counts messages");
+  Check(target.messages.size() == 2 * MessageCount,
+    "every pass replays the whole log");
+  bool same = true;
+  for (std::size_t i = 0; i < target.messages.size(); ++i)
+  {
+    same = same && SameBytes(target.messages[i],
+      MakeMessage(i % MessageCount));
+  }
+  Check(same, "replayed messages match byte for byte");
+  std::remove(path.c_str());
+}
+
+bool Rejected(const std::string& path)
+{
+  try
+  {
+    wrp::TMessageLog log(path);
+  }
+  catch (const std::runtime_error&)
+  {
+    return true;
+  }
+  return false;
+}
+
+void TestUnclosedLog()
+{
+  std::string path = TempPath("wrp-message-log-unclosed-test.log");
+  {
+    wrp::TMessageRecorder recorder(path, 64 * 1024);
+    for (std::size_t i = 0; i < 5; ++i)
+    {
+      recorder.Record(MakeMessage(i), i);
+    }
+    /* The header is written only by Close */
+    Check(Rejected(path), "log being recorded is rejected");
+  }
+  Check(!Rejected(path), "log closed by the destructor is accepted");
+
+  /* A log cut short keeps its header but loses records */
+  {
+    std::ifstream input(path.c_str(), std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(input)),
+      std::istreambuf_iterator<char>());
+    input.close();
+    std::ofstream output(path.c_str(), std::ios::binary | std::ios::trunc);
+    output.write(content.data(), content.size() / 2);
+  }
+  bool truncated = Rejected(path);
+  if (!truncated)
+  {
+    try
+    {
+      wrp::TMessageLog log(path);
+      wrp::TDataMessage message(wrp::EMessageType::Data);
+      std::uint64_t timestamp = 0;
+      while (log.Next(message, timestamp))
+      {
+      }
+    }
+    catch (const std::runtime_error&)
+    {
+      truncated = true;
+    }
+  }
+  Check(truncated, "truncated log is rejected");
+
+  std::ofstream(path.c_str(), std::ios::binary | std::ios::trunc);
+  Check(Rejected(path), "empty file is rejected");
+  std::remove(path.c_str());
+  Check(Rejected(path), "missing file is rejected");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestRecordAndRead();
+  TestReplay();
+  TestUnclosedLog();
+  std::printf("Message log: %s\n", (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,195 @@
+#include <atomic>
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <new>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "data_message.h"
+#include "module_info.h"
+#include "payload_buffer.h"
+
+
+namespace
+{
+
+std::atomic<std::size_t> allocationCount(0);
+
+} // namespace
+
+
+/* Counting replacements of the global allocation functions */
+void* operator new(std::size_t size)
+{
+  allocationCount.fetch_add(1, std::memory_order_relaxed);
+  void* pointer = std::malloc((size > 0) ? size : 1);
+  if (pointer == NULL)
+  {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+void operator delete(void* pointer) noexcept
+{
+  std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept
+{
+  std::free(pointer);
+}
+
+
+static_assert(std::is_nothrow_move_constructible<TModuleInfo>::value,
+  "TModuleInfo must be nothrow movable");
+static_assert(std::is_nothrow_move_assignable<TModuleInfo>::value,
+  "TModuleInfo must be nothrow move assignable");
+static_assert(
+  std::is_nothrow_move_constructible<wrp::TDataMessageEntranceInfo>::value,
+  "TDataMessageEntranceInfo must be nothrow movable");
+static_assert(std::is_nothrow_move_constructible<wrp::TDataMessage>::value,
+  "TDataMessage must be nothrow movable");
+static_assert(std::is_nothrow_move_constructible<wrp::TBatchSequence>::value,
+  "TBatchSequence must be nothrow movable");
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+TModuleInfo MakeModuleInfo(std::size_t index)
+{
+  TModuleInfo info;
+  info.name = "module-with-a-long-name-" + std::to_string(index);
+  info.executablePath = "/opt/workflow/bin/module-executable";
+  info.startCommandLineArgs.push_back("--configuration-file=module.conf");
+  info.stopCommandLine = "kill -TERM module-executable";
+  info.parameters.push_back(std::make_pair(
+    std::string("parameter-name-long"), std::string("parameter-value-long")));
+  info.environmentVariables["ENVIRONMENT_VARIABLE_NAME"] = "variable-value";
+  info.inputFileName = "/var/lib/workflow/module-input.dat";
+  info.outputFileName = "/var/lib/workflow/module-output.dat";
+  info.inputBatches.resize(2);
+  info.outputBatches.resize(1);
+  return info;
+}
+
+wrp::TDataMessage MakeMessage()
+{
+  wrp::TDataMessage message(wrp::EMessageType::Data);
+  message.id.Forward(wrp::TDataMessageToken(TModuleId(1, 0), 1));
+  message.entrances.resize(2);
+  message.entrances[0].entranceId = "first-input-entrance-of-module";
+  message.entrances[0].SetFragment(wrp::TPayloadSlice::Copy("payload", 7));
+  message.entrances[1].entranceId = "second-input-entrance-of-module";
+  return message;
+}
+
+wrp::TBatchSequence MakeSequence()
+{
+  wrp::TBatchSequence sequence;
+  sequence.tokens.resize(3);
+  sequence.sourceChannels.push_back("first-output-channel-name");
+  sequence.sourceChannels.push_back("second-output-channel-name");
+  return sequence;
+}
+
+/* Counts allocations made by copying and by moving a filled value */
+template<typename T>
+void CompareCopyAndMove(const T& original, const char* name)
+{
+  std::size_t before = allocationCount.load();
+  T copy(original);
+  std::size_t copyAllocations = allocationCount.load() - before;
+
+  before = allocationCount.load();
+  T moved(std::move(copy));
+  std::size_t moveAllocations = allocationCount.load() - before;
+
+  before = allocationCount.load();
+  copy = std::move(moved);
+  std::size_t assignAllocations = allocationCount.load() - before;
+
+  std::printf("%s: copy %zu allocations, move %zu, move assignment %zu\n",
+    name, copyAllocations, moveAllocations, assignAllocations);
+  bool copies = (copyAllocations > 0);
+  bool moves = (moveAllocations == 0) && (assignAllocations == 0);
+  Check(copies, std::string(name) + " copy allocates");
+  Check(moves, std::string(name) + " move doesn't allocate");
+}
+
+void TestModuleInfo()
+{
+  CompareCopyAndMove(MakeModuleInfo(0), "TModuleInfo");
+}
+
+void TestDataMessage()
+{
+  CompareCopyAndMove(MakeMessage(), "TDataMessage");
+}
+
+void TestBatchSequence()
+{
+  CompareCopyAndMove(MakeSequence(), "TBatchSequence");
+}
+
+void TestVectorGrowth()
+{
+  /* Reallocation moves elements: only the new storage is allocated */
+  std::vector<TModuleInfo> infos;
+  infos.reserve(4);
+  for (std::size_t i = 0; i < infos.capacity(); ++i)
+  {
+    infos.push_back(MakeModuleInfo(i));
+  }
+  TModuleInfo next = MakeModuleInfo(infos.size());
+  std::size_t before = allocationCount.load();
+  infos.push_back(std::move(next));
+  std::size_t allocations = allocationCount.load() - before;
+  std::printf("std::vector<TModuleInfo> growth: %zu allocations\n",
+    allocations);
+  Check(allocations == 1, "vector growth moves module infos");
+}
+
+void TestMapEmplace()
+{
+  /* Emplacing by move allocates only the map node */
+  std::map<TModuleId::TWorkflowId, TModuleInfo> infos;
+  TModuleInfo info = MakeModuleInfo(0);
+  std::size_t before = allocationCount.load();
+  infos.emplace(info.id.workflowId, std::move(info));
+  std::size_t allocations = allocationCount.load() - before;
+  std::printf("std::map<TModuleInfo> emplace: %zu allocations\n",
+    allocations);
+  Check(allocations == 1, "map emplace moves the module info");
+}
+
+} // namespace
+
+
+int main()
+{
+  TestModuleInfo();
+  TestDataMessage();
+  TestBatchSequence();
+  TestVectorGrowth();
+  TestMapEmplace();
+  std::printf("Move semantics: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
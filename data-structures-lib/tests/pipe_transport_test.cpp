@@ -0,0 +1,165 @@
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "data_message.h"
+#include "payload_buffer.h"
+#include "pipe_transport.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+const std::size_t FragmentSize = 4096;
+const std::size_t MessageCount = 256;
+
+wrp::TDataMessage MakeMessage(std::size_t index)
+{
+  std::vector<char> data(FragmentSize, static_cast<char>('a' + index % 26));
+  wrp::TDataMessage message(wrp::EMessageType::Data, TModuleId(1, 0),
+    TModuleId(2, 0));
+  message.entrances.resize(1);
+  message.entrances[0].entranceId = "input";
+  message.entrances[0].SetFragment(
+    wrp::TPayloadSlice::Copy(data.data(), data.size()));
+  return message;
+}
+
+struct TReceiver
+{
+  int fd;
+  std::atomic<bool> start;
+  std::atomic<std::size_t> receivedCount;
+  std::atomic<bool> intact;
+};
+
+void Receive(TReceiver* receiver)
+{
+  while (!receiver->start.load())
+  {
+    std::this_thread::yield();
+  }
+  wrp::TPipeReader reader(receiver->fd);
+  wrp::TDataMessage message(wrp::EMessageType::Data);
+  for (std::size_t i = 0; i < MessageCount; ++i)
+  {
+    if (!reader.Receive(message))
+    {
+      receiver->intact.store(false);
+      return;
+    }
+    const wrp::TPayloadSlice& data = message.entrances[0].data;
+    if ((data.Size() != FragmentSize) ||
+      (data.Data()[FragmentSize - 1] != static_cast<char>('a' + i % 26)))
+    {
+      receiver->intact.store(false);
+    }
+    receiver->receivedCount.store(i + 1);
+  }
+}
+
+void TestBurstThenIdle()
+{
+  /* Messages queued while the pipe is full leave without further calls */
+  int fds[2];
+  Check(pipe(fds) == 0, "pipe is created");
+  wrp::TPipeTransportOptions options;
+  options.pipeSize = 64 * 1024;
+  TReceiver receiver;
+  receiver.fd = fds[0];
+  receiver.start.store(false);
+  receiver.receivedCount.store(0);
+  receiver.intact.store(true);
+  std::thread thread(Receive, &receiver);
+  {
+    wrp::TPipeWriter writer(fds[1], options);
+    for (std::size_t i = 0; i < MessageCount; ++i)
+    {
+      writer.Send(MakeMessage(i));
+    }
+    Check(writer.PendingSize() > 0, "burst overfills the pipe");
+    receiver.start.store(true);
+
+    std::chrono::steady_clock::time_point deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while ((receiver.receivedCount.load() < MessageCount) &&
+      (std::chrono::steady_clock::now() < deadline))
+    {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    Check(receiver.receivedCount.load() == MessageCount,
+      "queued messages are written while the writer is idle");
+    Check(writer.PendingSize() == 0, "nothing is left queued");
+    writer.Close();
+  }
+  close(fds[1]);
+  thread.join();
+  Check(receiver.intact.load(), "messages arrive intact and in order");
+  close(fds[0]);
+}
+
+void TestSendRetriesWritablePipe()
+{
+  /* Without the flusher the next Send writes the backlog once the pipe
+     has room, however small the new message is */
+  int fds[2];
+  Check(pipe(fds) == 0, "pipe is created");
+  fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+  wrp::TPipeTransportOptions options;
+  options.pipeSize = 64 * 1024;
+  options.autoFlush = false;
+  {
+    wrp::TPipeWriter writer(fds[1], options);
+    for (std::size_t i = 0; i < 64; ++i)
+    {
+      writer.Send(MakeMessage(i));
+    }
+    std::size_t backlog = writer.PendingSize();
+    Check(backlog > 0, "burst overfills the pipe");
+
+    std::vector<char> buffer(1024 * 1024);
+    std::size_t drained = 0;
+    ssize_t count = 0;
+    while ((count = read(fds[0], buffer.data(), buffer.size())) > 0)
+    {
+      drained += static_cast<std::size_t>(count);
+    }
+    Check(drained > 0, "reader drains the pipe");
+
+    wrp::TDataMessage small(wrp::EMessageType::Data);
+    writer.Send(small);
+    Check(writer.PendingSize() < backlog, "small Send writes the backlog");
+  }
+  close(fds[1]);
+  close(fds[0]);
+}
+
+} // namespace
+
+
+int main()
+{
+  TestBurstThenIdle();
+  TestSendRetriesWritablePipe();
+  std::printf("Pipe transport: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}
@@ -0,0 +1,138 @@
+#include <cstddef>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "payload_buffer.h"
+#include "spill_manager.h"
+
+
+namespace
+{
+
+int failureCount = 0;
+
+void Check(bool condition, const std::string& what)
+{
+  if (!condition)
+  {
+    std::printf("FAILED: %s\n", what.c_str());
+    ++failureCount;
+  }
+}
+
+const std::size_t KiB = 1024;
+const std::size_t MiB = 1024 * 1024;
+
+std::string TempDirectory()
+{
+  const char* directory = std::getenv("TMPDIR");
+  return (directory != NULL) ? directory : "/tmp";
+}
+
+wrp::TPayloadBufferPtr MakeBuffer(std::size_t size, char seed)
+{
+  wrp::TPayloadBufferPtr buffer = std::make_shared<wrp::TPayloadBuffer>(size);
+  for (std::size_t i = 0; i < size; ++i)
+  {
+    buffer->Data()[i] = static_cast<char>(seed + i * 7);
+  }
+  return buffer;
+}
+
+bool SameData(const wrp::TPayloadSlice& left, const wrp::TPayloadSlice& right)
+{
+  return (left.Size() == right.Size()) &&
+    (std::memcmp(left.Data(), right.Data(), left.Size()) == 0);
+}
+
+void TestSharedBuffer()
+{
+  /* Fragments of one payload are budgeted once and spilled together */
+  wrp::TSpillManager manager(TempDirectory(),
+    wrp::TSpillOptions(4 * MiB, 64 * KiB));
+  std::vector<wrp::TSpillManager::TTicket> tickets;
+  std::vector<wrp::TPayloadSlice> expected;
+  {
+    wrp::TPayloadBufferPtr buffer = MakeBuffer(MiB, 1);
+    for (std::size_t i = 0; i < 16; ++i)
+    {
+      wrp::TPayloadSlice slice(buffer, i * 64 * KiB, 64 * KiB);
+      expected.push_back(wrp::TPayloadSlice::Copy(slice.Data(),
+        slice.Size()));
+      tickets.push_back(manager.Put(slice));
+    }
+  }
+  Check(manager.MemorySize() == MiB, "shared buffer is budgeted once");
+  Check(manager.SpillCount() == 0, "data within budget is not spilled");
+
+  /* Buffers held by the caller can't be spilled */
+  std::vector<wrp::TPayloadBufferPtr> held;
+  for (int i = 0; i < 4; ++i)
+  {
+    held.push_back(MakeBuffer(MiB, 2));
+    manager.Put(wrp::TPayloadSlice(held.back()));
+  }
+  Check(manager.SpillCount() == 1, "cold shared buffer is spilled once");
+  Check(manager.MemorySize() == 4 * MiB, "memory is within budget");
+  Check(manager.SpilledSize() == 16 * 64 * KiB,
+    "all fragments are spilled");
+
+  for (std::size_t i = 0; i < tickets.size(); ++i)
+  {
+    Check(SameData(manager.Get(tickets[i]), expected[i]),
+      "spilled fragment " + std::to_string(i) + " round trip");
+  }
+  for (std::size_t i = 0; i < tickets.size(); ++i)
+  {
+    manager.Remove(tickets[i]);
+  }
+  Check(manager.SpilledSize() == 0, "removed data is released");
+}
+
+void TestOverBudget()
+{
+  wrp::TSpillManager manager(TempDirectory(),
+    wrp::TSpillOptions(2 * MiB, 64 * KiB));
+  std::vector<wrp::TSpillManager::TTicket> tickets;
+  std::vector<wrp::TPayloadSlice> expected;
+  for (int i = 0; i < 20; ++i)
+  {
+    wrp::TPayloadSlice data(MakeBuffer(256 * KiB + i, static_cast<char>(i)));
+    expected.push_back(wrp::TPayloadSlice::Copy(data.Data(), data.Size()));
+    tickets.push_back(manager.Put(data));
+  }
+  /* Small data stays in memory */
+  wrp::TSpillManager::TTicket small =
+    manager.Put(wrp::TPayloadSlice::Copy("small", 5));
+  Check(manager.MemorySize() <= 2 * MiB, "memory stays within budget");
+  Check(manager.SpillCount() > 0, "data over budget is spilled");
+  Check(SameData(manager.Get(small), wrp::TPayloadSlice::Copy("small", 5)),
+    "small data round trip");
+
+  for (std::size_t i = 0; i < tickets.size(); ++i)
+  {
+    Check(SameData(manager.Get(tickets[i]), expected[i]),
+      "data " + std::to_string(i) + " round trip");
+    manager.Remove(tickets[i]);
+  }
+  Check(manager.SpilledSize() == 0, "spilled data is released");
+  Check(manager.MemorySize() == 5, "only small data is left in memory");
+}
+
+} // namespace
+
+
+int main()
+{
+#if defined(__linux__)
+  TestSharedBuffer();
+  TestOverBudget();
+#endif
+  std::printf("Spill manager: %s\n",
+    (failureCount == 0) ? "passed" : "FAILED");
+  return (failureCount == 0) ? 0 : 1;
+}